@@ -0,0 +1,330 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpl_string.h"
+#include "ogrsf_frmts.h"
+
+#include "alllayers.h"
+#include "deferredindex.h"
+#include "statscollector.h"
+#include "threaderrors.h"
+
+extern OGRErr CopyFeature(OGRLayer *poDstLayer, const OGRFeature *poSrcFeature, const OGRGeometry *poGeometry);
+
+struct layer_job_t
+{
+    CPLString osName;
+    GIntBig nFeatures;
+    std::atomic<double> dfComplete;
+    std::atomic<bool> *pbCancelled;
+    EliminateStats sStats;
+    bool bFailed = false;
+};
+
+static int CPL_STDCALL LayerProgress(double dfComplete, const char * /*pszMessage*/, void *pProgressData)
+{
+    layer_job_t *psJob = static_cast<layer_job_t *>(pProgressData);
+    psJob->dfComplete = dfComplete;
+    return !psJob->pbCancelled->load();
+}
+
+static GDALDriver *GetStageDriver()
+{
+    GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("Memory");
+    if (poDriver == nullptr)
+    {
+        poDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+    }
+    if (poDriver == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "No in-memory vector driver to stage layers in.");
+    }
+    return poDriver;
+}
+
+// Creates the destination layer like the staged one and copies every
+// feature across. Must be called with the destination locked.
+//
+static OGRErr CopyStagedLayer(OGRLayer *poStageLayer, GDALDataset *poDstDS, bool bClustered, CSLConstList papszLayerCreationOptions)
+{
+    char **papszLayerOptions = CSLDuplicate(papszLayerCreationOptions);
+    if (bClustered)
+    {
+        // The deferred index has to win, or building it at the end fails.
+        char **papszDeferredOptions = DeferredIndexLayerOptions(poDstDS);
+        papszLayerOptions = CSLMerge(papszLayerOptions, papszDeferredOptions);
+        CSLDestroy(papszDeferredOptions);
+    }
+    OGRLayer *poDstLayer = poDstDS->CreateLayer(poStageLayer->GetName(), poStageLayer->GetSpatialRef(), poStageLayer->GetGeomType(), papszLayerOptions);
+    CSLDestroy(papszLayerOptions);
+
+    if (poDstLayer == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    OGRFeatureDefn *poStageLayerDefn = poStageLayer->GetLayerDefn();
+    for (int iField = 0, nCount = poStageLayerDefn->GetFieldCount(); iField < nCount; iField++)
+    {
+        poDstLayer->CreateField(poStageLayerDefn->GetFieldDefn(iField));
+    }
+
+    if (poDstLayer->GetLayerDefn()->GetGeomFieldCount() == 0 && poStageLayerDefn->GetGeomFieldCount() > 0)
+    {
+        poDstLayer->CreateGeomField(poStageLayerDefn->GetGeomFieldDefn(0));
+    }
+
+    // The staged layer is already in the order it is to be written.
+    for (auto &poFeature : poStageLayer)
+    {
+        OGRErr eErr = CopyFeature(poDstLayer, poFeature.get(), poFeature->GetGeometryRef());
+        if (eErr != OGRERR_NONE)
+        {
+            return eErr;
+        }
+    }
+
+    return bClustered ? BuildDeferredIndex(poDstDS, poDstLayer) : OGRERR_NONE;
+}
+
+// Layers that only say they have some geometry may still hold polygons.
+//
+static bool IsPolygonLayer(OGRLayer *poLayer)
+{
+    OGRwkbGeometryType eType = wkbFlatten(poLayer->GetGeomType());
+    return eType == wkbPolygon || eType == wkbMultiPolygon || eType == wkbUnknown;
+}
+
+OGRErr RunAllLayers(const char *pszSrcFilename, GDALDatasetH hDstDS, int nJobs, bool bClustered, bool bPolygonsOnly, const WriteProfile &oProfile, const LayerJobFunc &fnLayer, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
+    GDALDriver *poStageDriver = GetStageDriver();
+    if (poStageDriver == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    const int nFlags = GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR;
+
+    std::atomic<bool> bCancelled(false);
+    std::vector<std::unique_ptr<layer_job_t>> vecpsJobs;
+    GIntBig nTotalFeatures = 0;
+    {
+        GDALDatasetUniquePtr poSrcDS(GDALDataset::Open(pszSrcFilename, nFlags));
+        if (poSrcDS == nullptr)
+        {
+            return OGRERR_FAILURE;
+        }
+
+        for (int iLayer = 0, nLayers = poSrcDS->GetLayerCount(); iLayer < nLayers; iLayer++)
+        {
+            OGRLayer *poLayer = poSrcDS->GetLayer(iLayer);
+            if (poLayer->GetLayerDefn()->GetGeomFieldCount() == 0)
+            {
+                CPLDebug("ELIMINATE", "Skipping layer %s, which has no geometry column.", poLayer->GetName());
+                continue;
+            }
+            if (bPolygonsOnly && !IsPolygonLayer(poLayer))
+            {
+                CPLDebug("ELIMINATE", "Skipping layer %s, which has %s geometries.", poLayer->GetName(), OGRGeometryTypeToName(poLayer->GetGeomType()));
+                continue;
+            }
+            vecpsJobs.emplace_back(new layer_job_t());
+            layer_job_t *psJob = vecpsJobs.back().get();
+            psJob->osName = poLayer->GetName();
+            psJob->nFeatures = std::max<GIntBig>(1, poLayer->GetFeatureCount(TRUE));
+            psJob->dfComplete = 0.0;
+            psJob->pbCancelled = &bCancelled;
+            nTotalFeatures += psJob->nFeatures;
+        }
+    }
+
+    if (vecpsJobs.empty())
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, bPolygonsOnly ? "Source has no polygon layers." : "Source has no layers with a geometry column.");
+        return OGRERR_FAILURE;
+    }
+
+    // Starting the largest layers first keeps a big one from being left to
+    // run on its own at the end.
+    std::stable_sort(vecpsJobs.begin(), vecpsJobs.end(), [](const std::unique_ptr<layer_job_t> &psA, const std::unique_ptr<layer_job_t> &psB) {
+        return psA->nFeatures > psB->nFeatures;
+    });
+
+    StatsCollector oStats(psStats != nullptr);
+    GDALDataset *poDstDS = GDALDataset::FromHandle(hDstDS);
+    std::mutex oDstMutex;
+    std::atomic<size_t> nNextJob(0);
+    std::atomic<int> nWorkersDone(0);
+    std::atomic<bool> bFailed(false);
+
+    nJobs = std::max(1, std::min(nJobs, static_cast<int>(vecpsJobs.size())));
+    std::vector<ThreadErrors> aoErrors(nJobs);
+    std::vector<std::thread> vecThreads;
+
+    for (int iWorker = 0; iWorker < nJobs; iWorker++)
+    {
+        vecThreads.emplace_back([&, iWorker]() {
+            ThreadErrors::Scope oErrorScope(aoErrors[iWorker]);
+            WriteProfile::ConfigScope oConfigScope(oProfile);
+
+            GDALDatasetUniquePtr poSrcDS(GDALDataset::Open(pszSrcFilename, nFlags));
+            while (poSrcDS != nullptr && !bCancelled)
+            {
+                size_t iJob = nNextJob++;
+                if (iJob >= vecpsJobs.size())
+                {
+                    break;
+                }
+                layer_job_t *psJob = vecpsJobs[iJob].get();
+
+                GDALDatasetUniquePtr poStageDS(poStageDriver->Create("", 0, 0, 0, GDT_Unknown, nullptr));
+                OGRErr eErr = poStageDS != nullptr ? OGRERR_NONE : OGRERR_FAILURE;
+                if (eErr == OGRERR_NONE)
+                {
+                    eErr = fnLayer(GDALDataset::ToHandle(poSrcDS.get()), psJob->osName, GDALDataset::ToHandle(poStageDS.get()),
+                                   psStats != nullptr ? &psJob->sStats : nullptr, LayerProgress, psJob);
+                }
+
+                OGRLayer *poStageLayer = eErr == OGRERR_NONE ? poStageDS->GetLayerByName(psJob->osName) : nullptr;
+                if (poStageLayer != nullptr)
+                {
+                    std::lock_guard<std::mutex> oLock(oDstMutex);
+                    StatsCollector oCopyStats(psStats != nullptr);
+                    {
+                        StatsCollector::Scope oScope(oCopyStats, ELIMINATE_PHASE_WRITE);
+                        eErr = CopyStagedLayer(poStageLayer, poDstDS, bClustered, oProfile.layerOptions());
+                    }
+                    psJob->sStats.asPhases[ELIMINATE_PHASE_WRITE].dfWallSeconds += oCopyStats.stats().asPhases[ELIMINATE_PHASE_WRITE].dfWallSeconds;
+                    psJob->sStats.asPhases[ELIMINATE_PHASE_WRITE].dfCPUSeconds += oCopyStats.stats().asPhases[ELIMINATE_PHASE_WRITE].dfCPUSeconds;
+                }
+                else if (eErr == OGRERR_NONE)
+                {
+                    eErr = OGRERR_FAILURE;
+                }
+
+                // The other layers carry on; the run fails at the end.
+                if (eErr != OGRERR_NONE)
+                {
+                    CPLError(CE_Failure, CPLE_AppDefined, "Layer %s failed.", psJob->osName.c_str());
+                    psJob->bFailed = true;
+                    bFailed = true;
+                }
+                psJob->dfComplete = 1.0;
+            }
+
+            // Its layers are left to the other workers.
+            if (poSrcDS == nullptr)
+            {
+                bFailed = true;
+            }
+            nWorkersDone++;
+        });
+    }
+
+    // Only this thread reports progress, weighting each layer by its
+    // feature count.
+    //
+    bool bUserCancelled = false;
+    while (nWorkersDone < nJobs)
+    {
+        double dfComplete = 0.0;
+        for (const auto &psJob : vecpsJobs)
+        {
+            dfComplete += psJob->dfComplete * psJob->nFeatures / nTotalFeatures;
+        }
+        if (!bUserCancelled && !pfnProgress(std::min(1.0, dfComplete), nullptr, pProgressData))
+        {
+            bUserCancelled = true;
+            bCancelled = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    for (auto &oThread : vecThreads)
+    {
+        oThread.join();
+    }
+    for (auto &oErrors : aoErrors)
+    {
+        oErrors.replay();
+    }
+
+    // Every worker failing to open the source leaves layers that never ran.
+    CPLString osFailed;
+    int nFailedLayers = 0;
+    for (const auto &psJob : vecpsJobs)
+    {
+        if (psJob->bFailed || (!bUserCancelled && psJob->dfComplete < 1.0))
+        {
+            osFailed += nFailedLayers++ > 0 ? ", " : "";
+            osFailed += psJob->osName;
+        }
+    }
+
+    if (bUserCancelled)
+    {
+        CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+    }
+    else if (nFailedLayers > 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "%d of %d layer(s) failed: %s.", nFailedLayers, static_cast<int>(vecpsJobs.size()), osFailed.c_str());
+        bFailed = true;
+    }
+    else if (!bFailed)
+    {
+        pfnProgress(1.0, nullptr, pProgressData);
+    }
+
+    // Stats cover the layers that ran even if the run was cut short.
+    if (oStats.enabled())
+    {
+        for (const auto &psJob : vecpsJobs)
+        {
+            StatsCollector oLayerStats(true);
+            oLayerStats.stats() = psJob->sStats;
+            oStats.merge(oLayerStats);
+            for (int iStage = 0; iStage < ELIMINATE_STAGE_COUNT; iStage++)
+            {
+                oStats.stats().adfStageSeconds[iStage] += psJob->sStats.adfStageSeconds[iStage];
+            }
+        }
+        oStats.stats().nThreads = nJobs;
+        oStats.finish(psStats);
+    }
+
+    return bUserCancelled || bFailed ? OGRERR_FAILURE : OGRERR_NONE;
+}
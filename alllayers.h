@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+
+#ifndef ALLLAYERS_H_INCLUDED
+#define ALLLAYERS_H_INCLUDED
+
+#include <functional>
+
+#include "gdal.h"
+
+#include "stats.h"
+#include "writeprofile.h"
+
+// Runs a single layer tool on every layer of a source dataset that has a
+// geometry column, or every polygon layer, each into a destination layer of
+// the same name.
+//
+// The layers are processed concurrently on a pool of nJobs threads, the
+// largest first, so the run takes about as long as its largest layer. Each
+// thread opens the source for itself. A layer is first written to an
+// in-memory dataset, and then copied into the destination, one layer at a
+// time, since a dataset may only be written from one thread at once. The
+// profile's configuration options are set on every thread, and its layer
+// creation options used for every destination layer.
+
+// Runs the tool on one layer, writing a layer of the same name into
+// hStageDS. Called from the worker threads.
+typedef std::function<OGRErr(GDALDatasetH hSrcDS, const char *pszLayerName, GDALDatasetH hStageDS, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)> LayerJobFunc;
+
+// bClustered is as for CLUSTERED_OUTPUT. bPolygonsOnly skips layers whose
+// geometry type is known not to be a polygon or multipolygon. The stats, if
+// requested, are the sum over the layers. A layer that fails is reported
+// and the rest still run; the run then fails, naming the failed layers.
+OGRErr RunAllLayers(const char *pszSrcFilename, GDALDatasetH hDstDS, int nJobs, bool bClustered, bool bPolygonsOnly, const WriteProfile &oProfile, const LayerJobFunc &fnLayer, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+
+#endif // ALLLAYERS_H_INCLUDED
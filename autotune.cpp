@@ -0,0 +1,384 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "gdal.h"
+#include "gdal_priv.h"
+#include "cpl_string.h"
+#include "ogrsf_frmts.h"
+
+#include "autotune.h"
+
+// Fewer features than this and the timings are mostly noise.
+static constexpr GIntBig MIN_SAMPLE_FEATURES = 500;
+
+// Each setting is timed this many times and the best kept.
+static constexpr int ROUNDS = 2;
+
+// A candidate must beat the default by this much to be chosen, so that
+// noise doesn't pick settings that are no better.
+static constexpr double MIN_IMPROVEMENT = 0.05;
+
+static int CountVertices(const OGRGeometry *poGeometry)
+{
+    int nVertices = 0;
+    switch (wkbFlatten(poGeometry->getGeometryType()))
+    {
+        case wkbPolygon:
+            for (const auto *poRing : *poGeometry->toPolygon())
+            {
+                nVertices += poRing->getNumPoints();
+            }
+            break;
+
+        case wkbMultiPolygon:
+        case wkbGeometryCollection:
+            for (const auto *poPart : *poGeometry->toGeometryCollection())
+            {
+                nVertices += CountVertices(poPart);
+            }
+            break;
+
+        default:
+            break;
+    }
+    return nVertices;
+}
+
+// Copies the features in a window around the middle of the extent, growing
+// it until there are enough of them. A window rather than every n-th
+// feature keeps the neighbors of the sampled features in the sample.
+static GDALDatasetUniquePtr CreateSample(OGRLayer *poSrcLayer, double dfSampleFraction)
+{
+    GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("Memory");
+    if (poDriver == nullptr)
+    {
+        poDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+    }
+    if (poDriver == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "No in-memory vector driver to sample into.");
+        return nullptr;
+    }
+
+    OGREnvelope sExtent;
+    if (poSrcLayer->GetExtent(&sExtent, TRUE) != OGRERR_NONE)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unable to get the extent of the source layer.");
+        return nullptr;
+    }
+
+    double dfFraction = std::min(1.0, std::max(dfSampleFraction, 1e-6));
+    while (true)
+    {
+        GDALDatasetUniquePtr poDS(poDriver->Create("", 0, 0, 0, GDT_Unknown, nullptr));
+        OGRLayer *poLayer = poDS != nullptr ? poDS->CreateLayer(poSrcLayer->GetName(), poSrcLayer->GetSpatialRef(), wkbPolygon, nullptr) : nullptr;
+        if (poLayer == nullptr)
+        {
+            return nullptr;
+        }
+        OGRFeatureDefn *poSrcLayerDefn = poSrcLayer->GetLayerDefn();
+        for (int iField = 0, nCount = poSrcLayerDefn->GetFieldCount(); iField < nCount; iField++)
+        {
+            poLayer->CreateField(poSrcLayerDefn->GetFieldDefn(iField));
+        }
+
+        double dfScale = std::sqrt(dfFraction) / 2.0;
+        double dfCenterX = (sExtent.MinX + sExtent.MaxX) / 2.0;
+        double dfCenterY = (sExtent.MinY + sExtent.MaxY) / 2.0;
+        double dfHalfWidth = (sExtent.MaxX - sExtent.MinX) * dfScale;
+        double dfHalfHeight = (sExtent.MaxY - sExtent.MinY) * dfScale;
+        poSrcLayer->SetSpatialFilterRect(dfCenterX - dfHalfWidth, dfCenterY - dfHalfHeight, dfCenterX + dfHalfWidth, dfCenterY + dfHalfHeight);
+
+        GIntBig nFeatures = 0;
+        for (auto &poFeature : poSrcLayer)
+        {
+            if (poLayer->CreateFeature(poFeature.get()) == OGRERR_NONE)
+            {
+                nFeatures++;
+            }
+        }
+        poSrcLayer->SetSpatialFilter(nullptr);
+
+        if (nFeatures >= MIN_SAMPLE_FEATURES || dfFraction >= 1.0)
+        {
+            return poDS;
+        }
+        dfFraction = std::min(1.0, dfFraction * 4.0);
+    }
+}
+
+// Describes the sample, so the chosen settings can be read against the kind
+// of input they were chosen for.
+static void ProfileSample(OGRLayer *poLayer, const char *pszWhere, FILE *fpReport)
+{
+    std::vector<int> anVertices;
+    GIntBig nInvalid = 0;
+    double dfTotalArea = 0.0;
+    OGRMultiPolygon oAll;
+
+    for (auto &poFeature : poLayer)
+    {
+        const OGRGeometry *poGeometry = poFeature->GetGeometryRef();
+        if (poGeometry == nullptr)
+        {
+            continue;
+        }
+        anVertices.push_back(CountVertices(poGeometry));
+        if (!poGeometry->IsValid())
+        {
+            nInvalid++;
+            continue;
+        }
+        OGRwkbGeometryType eType = wkbFlatten(poGeometry->getGeometryType());
+        if (eType == wkbPolygon)
+        {
+            dfTotalArea += poGeometry->toPolygon()->get_Area();
+            oAll.addGeometry(poGeometry);
+        }
+        else if (eType == wkbMultiPolygon)
+        {
+            for (const auto *poPart : *poGeometry->toMultiPolygon())
+            {
+                dfTotalArea += poPart->get_Area();
+                oAll.addGeometry(poPart);
+            }
+        }
+    }
+
+    if (anVertices.empty())
+    {
+        return;
+    }
+
+    // In a clean coverage the parts only share edges, so their union has
+    // the same area as their sum; the difference is overlap.
+    double dfOverlap = 0.0;
+    OGRGeometryUniquePtr poUnion(oAll.UnionCascaded());
+    if (poUnion != nullptr && dfTotalArea > 0.0)
+    {
+        double dfUnionArea = 0.0;
+        if (wkbFlatten(poUnion->getGeometryType()) == wkbPolygon)
+        {
+            dfUnionArea = poUnion->toPolygon()->get_Area();
+        }
+        else if (wkbFlatten(poUnion->getGeometryType()) == wkbMultiPolygon)
+        {
+            dfUnionArea = poUnion->toMultiPolygon()->get_Area();
+        }
+        dfOverlap = std::max(0.0, (dfTotalArea - dfUnionArea) / dfTotalArea);
+    }
+
+    GIntBig nSlivers = 0;
+    if (pszWhere != nullptr && poLayer->SetAttributeFilter(pszWhere) == OGRERR_NONE)
+    {
+        nSlivers = poLayer->GetFeatureCount(TRUE);
+        poLayer->SetAttributeFilter(nullptr);
+    }
+
+    std::sort(anVertices.begin(), anVertices.end());
+    size_t nCount = anVertices.size();
+    fprintf(fpReport, "Sample: %d features, vertices median %d, p99 %d, max %d\n",
+            static_cast<int>(nCount), anVertices[nCount / 2], anVertices[std::min(nCount - 1, nCount * 99 / 100)], anVertices.back());
+    fprintf(fpReport, "        %.2f%% invalid, %.4f%% overlapping area, %.2f%% to eliminate\n",
+            100.0 * nInvalid / nCount, 100.0 * dfOverlap, 100.0 * nSlivers / nCount);
+}
+
+// Eliminates the whole sample into a fresh in-memory dataset, returning the
+// best time in seconds, or a negative value if the run failed.
+static double TimeRun(GDALDatasetH hSampleDS, GDALDriverH hDriver, const char *pszExtension, EliminateMergeType eMergeType,
+                      const char *pszWhere, CSLConstList papszOptions)
+{
+    double dfBest = -1.0;
+    for (int iRound = 0; iRound < ROUNDS; iRound++)
+    {
+        CPLString osFilename = CPLSPrintf("/vsimem/eliminate_auto_%p.%s", hSampleDS, pszExtension);
+        GDALDatasetH hDstDS = GDALCreate(hDriver, osFilename, 0, 0, 0, GDT_Unknown, nullptr);
+        if (hDstDS == nullptr)
+        {
+            return -1.0;
+        }
+
+        std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+        CPLPushErrorHandler(CPLQuietErrorHandler);
+        OGRErr eErr = EliminatePolygonsEx(hSampleDS, nullptr, hDstDS, nullptr, eMergeType, pszWhere, papszOptions, nullptr, nullptr, nullptr, nullptr);
+        GDALClose(hDstDS);
+        CPLPopErrorHandler();
+        std::chrono::duration<double> dfElapsed = std::chrono::steady_clock::now() - tStart;
+
+        GDALDeleteDataset(hDriver, osFilename);
+
+        if (eErr != OGRERR_NONE)
+        {
+            return -1.0;
+        }
+        if (dfBest < 0.0 || dfElapsed.count() < dfBest)
+        {
+            dfBest = dfElapsed.count();
+        }
+    }
+    return dfBest;
+}
+
+OGRErr EliminateAutoTune(GDALDatasetH hSrcDS, const char *pszSrcLayerName, const char *pszFormat, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, double dfSampleFraction, char ***ppapszOptions, FILE *fpReport)
+{
+    GDALDataset *poSrcDS = GDALDataset::FromHandle(hSrcDS);
+    OGRLayer *poSrcLayer = pszSrcLayerName != nullptr ? poSrcDS->GetLayerByName(pszSrcLayerName) :
+                           poSrcDS->GetLayerCount() == 1 ? poSrcDS->GetLayer(0) : nullptr;
+    if (poSrcLayer == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Source layer must be specified and exist.");
+        return OGRERR_FAILURE;
+    }
+
+    GDALDriverH hDriver = GDALGetDriverByName(pszFormat);
+    if (hDriver == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unable to find format driver named %s.", pszFormat);
+        return OGRERR_FAILURE;
+    }
+    const char *pszExtension = GDALGetMetadataItem(hDriver, GDAL_DMD_EXTENSION, nullptr);
+    if (pszExtension == nullptr)
+    {
+        pszExtension = "dat";
+    }
+
+    GDALDatasetUniquePtr poSampleDS = CreateSample(poSrcLayer, dfSampleFraction);
+    if (poSampleDS == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
+    GDALDatasetH hSampleDS = GDALDataset::ToHandle(poSampleDS.get());
+
+    if (fpReport != nullptr)
+    {
+        ProfileSample(poSampleDS->GetLayer(0), pszWhere, fpReport);
+    }
+
+    // Each setting is tuned in turn with the others held at the best found
+    // so far. They barely interact, so one pass is enough.
+    struct setting_t
+    {
+        const char *pszKey;
+        const char *pszFlag;
+        std::vector<CPLString> aosValues;
+    };
+    std::vector<setting_t> asSettings = {
+        {"NUM_THREADS", "-threads", {"1"}},
+        {"INDEX_NODE_CAPACITY", "-index-capacity", {"10", "4", "32"}},
+        {"UNION_METHOD", "-union", {"GEOS", "OGR"}},
+        {"SPATIAL_ORDER", "-order", {"SOURCE", "HILBERT"}},
+    };
+    int nCPUs = CPLGetNumCPUs();
+    for (int nThreads = 2; nThreads <= nCPUs; nThreads *= 2)
+    {
+        asSettings[0].aosValues.push_back(CPLSPrintf("%d", nThreads));
+    }
+    if (nCPUs > 1 && (nCPUs & (nCPUs - 1)) != 0)
+    {
+        asSettings[0].aosValues.push_back(CPLSPrintf("%d", nCPUs));
+    }
+
+    // Settings the caller gave hold from the first run on.
+    CPLStringList aosTuned;
+    for (const setting_t &sSetting : asSettings)
+    {
+        const char *pszGiven = CSLFetchNameValue(papszOptions, sSetting.pszKey);
+        aosTuned.SetNameValue(sSetting.pszKey, pszGiven != nullptr ? pszGiven : sSetting.aosValues.front().c_str());
+    }
+
+    double dfBaseline = TimeRun(hSampleDS, hDriver, pszExtension, eMergeType, pszWhere, aosTuned.List());
+    if (dfBaseline < 0.0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unable to eliminate the sample with the default settings.");
+        return OGRERR_FAILURE;
+    }
+    if (fpReport != nullptr)
+    {
+        fprintf(fpReport, "Default settings: %.3f s\n", dfBaseline);
+    }
+
+    for (const setting_t &sSetting : asSettings)
+    {
+        if (CSLFetchNameValue(papszOptions, sSetting.pszKey) != nullptr)
+        {
+            continue;
+        }
+
+        CPLString osBest = aosTuned.FetchNameValue(sSetting.pszKey);
+        double dfBest = dfBaseline;
+        for (const CPLString &osValue : sSetting.aosValues)
+        {
+            if (osValue == osBest)
+            {
+                continue;
+            }
+            CPLStringList aosCandidate(aosTuned);
+            aosCandidate.SetNameValue(sSetting.pszKey, osValue);
+            double dfSeconds = TimeRun(hSampleDS, hDriver, pszExtension, eMergeType, pszWhere, aosCandidate.List());
+            if (fpReport != nullptr)
+            {
+                fprintf(fpReport, "%s %s: %s\n", sSetting.pszFlag, osValue.c_str(),
+                        dfSeconds < 0.0 ? "failed" : CPLSPrintf("%.3f s", dfSeconds));
+            }
+            if (dfSeconds >= 0.0 && dfSeconds < dfBest * (1.0 - MIN_IMPROVEMENT))
+            {
+                dfBest = dfSeconds;
+                osBest = osValue;
+            }
+        }
+        aosTuned.SetNameValue(sSetting.pszKey, osBest);
+        dfBaseline = dfBest;
+    }
+
+    if (fpReport != nullptr)
+    {
+        CPLString osFlags;
+        for (const setting_t &sSetting : asSettings)
+        {
+            CPLString osValue = aosTuned.FetchNameValue(sSetting.pszKey);
+            osFlags += CPLSPrintf("%s%s %s", osFlags.empty() ? "" : " ", sSetting.pszFlag, osValue.tolower().c_str());
+        }
+        fprintf(fpReport, "Chosen configuration: %s\n", osFlags.c_str());
+    }
+
+    // The settings given by the caller are in aosTuned unchanged, and
+    // papszOptions may be *ppapszOptions, so don't look at it from here on.
+    for (int i = 0; i < aosTuned.size(); i++)
+    {
+        char *pszKey = nullptr;
+        const char *pszValue = CPLParseNameValue(aosTuned[i], &pszKey);
+        if (pszKey != nullptr)
+        {
+            *ppapszOptions = CSLSetNameValue(*ppapszOptions, pszKey, pszValue);
+        }
+        CPLFree(pszKey);
+    }
+
+    return OGRERR_NONE;
+}
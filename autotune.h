@@ -0,0 +1,49 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef AUTOTUNE_H_INCLUDED
+#define AUTOTUNE_H_INCLUDED
+
+#include <stdio.h>
+
+#include "gdal.h"
+#include "eliminate.h"
+
+CPL_C_START
+
+/* Picks NUM_THREADS, INDEX_NODE_CAPACITY, UNION_METHOD and SPATIAL_ORDER
+ * for a source by eliminating a spatially contiguous sample of about
+ * dfSampleFraction of its features with each candidate setting, writing to
+ * pszFormat in memory. A profile of the sample (vertex counts, validity, overlaps and the share of
+ * slivers) and the timings are printed to fpReport, which may be null.
+ *
+ * Settings already present in papszOptions are left alone. All of them are
+ * then set in *ppapszOptions, which may be papszOptions itself, and which
+ * the caller must free with CSLDestroy.
+ */
+OGRErr EliminateAutoTune(GDALDatasetH hSrcDS, const char *pszSrcLayerName, const char *pszFormat, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, double dfSampleFraction, char ***ppapszOptions, FILE *fpReport);
+
+CPL_C_END
+
+#endif // AUTOTUNE_H_INCLUDED
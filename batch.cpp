@@ -0,0 +1,308 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "batch.h"
+
+
+struct batch_job_t
+{
+    int nLine = 0;
+    CPLString osLine;
+    bool bOK = false;
+    CPLString osError;
+    double dfSeconds = 0.0;
+};
+
+// Keeps the last failure reported on this thread, which is the one that
+// explains why the job failed.
+static void CPL_STDCALL BatchErrorHandler(CPLErr eErrClass, CPLErrorNum /*nErrorNum*/, const char *pszMessage)
+{
+    if (eErrClass >= CE_Failure)
+    {
+        *static_cast<CPLString *>(CPLGetErrorHandlerUserData()) = pszMessage;
+    }
+}
+
+static bool ReadManifest(const char *pszManifest, std::vector<batch_job_t> &vecJobs)
+{
+    VSILFILE *fp = VSIFOpenL(pszManifest, "rb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot open %s.", pszManifest);
+        return false;
+    }
+
+    int nLine = 0;
+    while (const char *pszLine = CPLReadLineL(fp))
+    {
+        nLine++;
+        CPLString osLine(pszLine);
+        osLine.Trim();
+        if (osLine.empty() || osLine[0] == '#')
+        {
+            continue;
+        }
+        batch_job_t sJob;
+        sJob.nLine = nLine;
+        sJob.osLine = osLine;
+        vecJobs.push_back(sJob);
+    }
+
+    VSIFCloseL(fp);
+    return true;
+}
+
+static void RunJob(const char *pszProgram, batch_job_t &sJob, const BatchJobFunc &fnJob)
+{
+    auto tStart = std::chrono::steady_clock::now();
+
+    CPLStringList aosArgs;
+    aosArgs.AddString(pszProgram);
+    char **papszTokens = CSLTokenizeString2(sJob.osLine, " \t", CSLT_HONOURSTRINGS);
+    for (char **papszIter = papszTokens; papszIter != nullptr && *papszIter != nullptr; ++papszIter)
+    {
+        aosArgs.AddString(*papszIter);
+    }
+    CSLDestroy(papszTokens);
+
+    CPLString osError;
+    sJob.bOK = RunCapturedJob(fnJob, aosArgs.size(), aosArgs.List(), osError);
+
+    if (!sJob.bOK)
+    {
+        sJob.osError = osError.empty() ? CPLString("Failed.") : osError;
+    }
+
+    sJob.dfSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+static thread_local bool bInCapturedJob = false;
+
+bool InCapturedJob()
+{
+    return bInCapturedJob;
+}
+
+bool RunCapturedJob(const BatchJobFunc &fnJob, int nArgc, char **papszArgv, CPLString &osError)
+{
+    bool bOK = false;
+    const bool bWasInCapturedJob = bInCapturedJob;
+    bInCapturedJob = true;
+    CPLPushErrorHandlerEx(BatchErrorHandler, &osError);
+    try
+    {
+        bOK = fnJob(nArgc, papszArgv) == OGRERR_NONE;
+    }
+    catch (const std::exception &e)
+    {
+        osError = e.what();
+    }
+    CPLPopErrorHandler();
+    CPLErrorReset();
+    bInCapturedJob = bWasInCapturedJob;
+    return bOK;
+}
+
+static bool WriteReport(const char *pszReportFilename, const std::vector<batch_job_t> &vecJobs, int nFailed, double dfSeconds)
+{
+    VSILFILE *fp = VSIFOpenL(pszReportFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszReportFilename);
+        return false;
+    }
+
+    bool bOK = VSIFPrintfL(fp,
+                           "{\n"
+                           "  \"jobs\": %d,\n"
+                           "  \"failed\": %d,\n"
+                           "  \"wall_seconds\": %.6f,\n"
+                           "  \"results\": [",
+                           static_cast<int>(vecJobs.size()), nFailed, dfSeconds) > 0;
+
+    for (size_t i = 0; i < vecJobs.size(); i++)
+    {
+        const batch_job_t &sJob = vecJobs[i];
+        char *pszArgs = CPLEscapeString(sJob.osLine, -1, CPLES_BackslashQuotable);
+        char *pszError = CPLEscapeString(sJob.osError, -1, CPLES_BackslashQuotable);
+        bOK &= VSIFPrintfL(fp, "%s\n    {\"line\": %d, \"args\": \"%s\", \"ok\": %s, \"seconds\": %.6f, \"error\": %s%s%s}",
+                           i > 0 ? "," : "", sJob.nLine, pszArgs, sJob.bOK ? "true" : "false", sJob.dfSeconds,
+                           sJob.bOK ? "" : "\"", sJob.bOK ? "null" : pszError, sJob.bOK ? "" : "\"") > 0;
+        CPLFree(pszArgs);
+        CPLFree(pszError);
+    }
+
+    bOK &= VSIFPrintfL(fp, "\n  ]\n}\n") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszReportFilename);
+        return false;
+    }
+
+    return true;
+}
+
+OGRErr RunBatch(const char *pszProgram, const char *pszManifest, int nJobs, const BatchJobFunc &fnJob, const char *pszReportFilename, FILE *fpSummary)
+{
+    std::vector<batch_job_t> vecJobs;
+    if (!ReadManifest(pszManifest, vecJobs))
+    {
+        return OGRERR_FAILURE;
+    }
+
+    auto tStart = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> nNextJob(0);
+    std::mutex oSummaryMutex;
+
+    auto worker = [&]()
+    {
+        for (size_t i = nNextJob++; i < vecJobs.size(); i = nNextJob++)
+        {
+            batch_job_t &sJob = vecJobs[i];
+            RunJob(pszProgram, sJob, fnJob);
+
+            std::lock_guard<std::mutex> oLock(oSummaryMutex);
+            fprintf(fpSummary, "line %d: %s (%.3f s)%s%s\n", sJob.nLine, sJob.bOK ? "ok" : "FAILED", sJob.dfSeconds,
+                    sJob.bOK ? "" : ": ", sJob.osError.c_str());
+            fflush(fpSummary);
+        }
+    };
+
+    nJobs = std::max(1, std::min(nJobs, static_cast<int>(vecJobs.size())));
+    std::vector<std::thread> vecThreads;
+    for (int i = 1; i < nJobs; i++)
+    {
+        vecThreads.emplace_back(worker);
+    }
+    worker();
+    for (auto &oThread : vecThreads)
+    {
+        oThread.join();
+    }
+
+    double dfSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+    int nFailed = 0;
+    for (const batch_job_t &sJob : vecJobs)
+    {
+        if (!sJob.bOK)
+        {
+            nFailed++;
+        }
+    }
+
+    fprintf(fpSummary, "%d job(s), %d succeeded, %d failed, in %.3f s on %d thread(s).\n",
+            static_cast<int>(vecJobs.size()), static_cast<int>(vecJobs.size()) - nFailed, nFailed, dfSeconds, nJobs);
+
+    if (pszReportFilename != nullptr && !WriteReport(pszReportFilename, vecJobs, nFailed, dfSeconds))
+    {
+        return OGRERR_FAILURE;
+    }
+
+    return nFailed == 0 ? OGRERR_NONE : OGRERR_FAILURE;
+}
+
+bool ParseBatchCommand(int nArgc, char **papszArgv, const char *pszCommand, bool bAllowReport, bool bAllowQueue, batch_command_t &sCommand)
+{
+    sCommand.nJobs = CPLGetNumCPUs();
+
+    for (int i = 1; i < nArgc; i++)
+    {
+        const bool bCommand = EQUAL(papszArgv[i], pszCommand);
+        const bool bJobs = EQUAL(papszArgv[i], "-jobs");
+        const bool bReport = bAllowReport && EQUAL(papszArgv[i], "-report");
+        const bool bQueue = bAllowQueue && EQUAL(papszArgv[i], "-queue");
+        if (!bCommand && !bJobs && !bReport && !bQueue)
+        {
+            CPLError(CE_Failure, CPLE_IllegalArg, "Unexpected argument '%s' with '%s'.", papszArgv[i], pszCommand);
+            return false;
+        }
+        if (i + 1 >= nArgc)
+        {
+            CPLError(CE_Failure, CPLE_IllegalArg, "%s option requires 1 argument(s)", papszArgv[i]);
+            return false;
+        }
+
+        const char *pszValue = papszArgv[++i];
+        if (bCommand)
+        {
+            sCommand.pszTarget = pszValue;
+        }
+        else if (bJobs)
+        {
+            sCommand.nJobs = atoi(pszValue);
+            if (sCommand.nJobs <= 0)
+            {
+                CPLError(CE_Failure, CPLE_IllegalArg, "Invalid value for -jobs: %s", pszValue);
+                return false;
+            }
+        }
+        else if (bQueue)
+        {
+            sCommand.nMaxQueued = atoi(pszValue);
+            if (sCommand.nMaxQueued <= 0)
+            {
+                CPLError(CE_Failure, CPLE_IllegalArg, "Invalid value for -queue: %s", pszValue);
+                return false;
+            }
+        }
+        else
+        {
+            sCommand.pszReportFilename = pszValue;
+        }
+    }
+
+    if (sCommand.pszTarget == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_IllegalArg, "%s option requires 1 argument(s)", pszCommand);
+        return false;
+    }
+
+    return true;
+}
+
+OGRErr RunBatchCommand(int nArgc, char **papszArgv, const BatchJobFunc &fnJob)
+{
+    batch_command_t sCommand;
+    if (!ParseBatchCommand(nArgc, papszArgv, "-batch", true, false, sCommand))
+    {
+        return OGRERR_FAILURE;
+    }
+    return RunBatch(papszArgv[0], sCommand.pszTarget, sCommand.nJobs, fnJob, sCommand.pszReportFilename, stdout);
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <cstdio>
+#include <functional>
+
+#include "cpl_port.h"
+#include "cpl_string.h"
+#include "ogr_core.h"
+
+// Runs many small jobs in one process, so that driver registration and
+// start-up are paid once rather than per job.
+//
+// Each line of the manifest that is not blank and does not start with '#'
+// is one job, written as the arguments of the tool would be on its command
+// line (without the program name), with double quotes around arguments
+// that contain spaces. Relative paths are relative to the current
+// directory.
+//
+// The jobs run concurrently on a pool of nJobs threads. Each job's errors
+// are captured on its own thread and reported against its line, and a
+// failing job does not stop the others.
+
+// Runs one job. papszArgv[0] is the program name, as for main().
+typedef std::function<OGRErr(int nArgc, char **papszArgv)> BatchJobFunc;
+
+// Runs one job with its errors captured on the calling thread rather than
+// printed. On failure osError holds the last one reported.
+bool RunCapturedJob(const BatchJobFunc &fnJob, int nArgc, char **papszArgv, CPLString &osError);
+
+// True on a thread while it runs a job for RunCapturedJob(). The tools then
+// raise their argument errors with CPLError(), so that they are captured
+// with the job, rather than printing them with their usage.
+bool InCapturedJob();
+
+// The options that go with -batch and -serve: the command's own argument,
+// -jobs <n> (every CPU by default), for -batch only -report <filename>, and
+// for -serve only -queue <n>.
+struct batch_command_t
+{
+    const char *pszTarget = nullptr;
+    int nJobs = 0;
+    const char *pszReportFilename = nullptr;
+    int nMaxQueued = 64;
+};
+
+// Parses a tool's command line whose mode is pszCommand. Fails, with the
+// error reported, on a missing or unexpected argument.
+bool ParseBatchCommand(int nArgc, char **papszArgv, const char *pszCommand, bool bAllowReport, bool bAllowQueue, batch_command_t &sCommand);
+
+// Runs "<tool> -batch <manifest> [-jobs <n>] [-report <filename>]", with
+// the summary printed to stdout.
+OGRErr RunBatchCommand(int nArgc, char **papszArgv, const BatchJobFunc &fnJob);
+
+// Prints a summary to fpSummary and, if pszReportFilename is not null,
+// writes every job's outcome to it as JSON. Succeeds only if every job
+// did.
+OGRErr RunBatch(const char *pszProgram, const char *pszManifest, int nJobs, const BatchJobFunc &fnJob, const char *pszReportFilename, FILE *fpSummary);
+
+#endif // BATCH_H_INCLUDED
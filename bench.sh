@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# End-to-end benchmark. Generates synthetic coverages, runs explode and
+# eliminate with every merge type over each, and appends one JSON line per
+# run to $BENCH_DIR/results.jsonl with the time, peak memory and a checksum
+# of the output. Run through 'make bench'; the knobs below can be set in
+# the environment.
+
+set -e
+
+BENCH_DIR=${BENCH_DIR:-bench}
+BENCH_FEATURES=${BENCH_FEATURES:-100000}
+BENCH_SLIVERS=${BENCH_SLIVERS:-0.1}
+BENCH_VERTICES=${BENCH_VERTICES:-32}
+BENCH_GIANTS=${BENCH_GIANTS:-4}
+BENCH_SEED=${BENCH_SEED:-1}
+# Cells are about 100 x 100, so this catches the slivers and little else.
+BENCH_MIN_AREA=${BENCH_MIN_AREA:-1000}
+
+RESULTS="$BENCH_DIR/results.jsonl"
+
+mkdir -p "$BENCH_DIR"
+
+# json_value <file> <key>: the first numeric value of the key.
+json_value()
+{
+    sed -n "s/.*\"$2\": \([-0-9.e]*\).*/\1/p" "$1" | head -n 1
+}
+
+# checksum <file>: a checksum of the features, independent of the format.
+checksum()
+{
+    ogr2ogr -f CSV /vsistdout/ "$1" -lco GEOMETRY=AS_WKT | cksum | cut -d ' ' -f 1
+}
+
+# record <coverage> <tool> <merge> <stats> <output>
+record()
+{
+    echo "{\"coverage\": \"$1\", \"tool\": \"$2\", \"merge\": $3, \"features\": $BENCH_FEATURES," \
+         "\"wall_seconds\": $(json_value "$4" wall_seconds), \"cpu_seconds\": $(json_value "$4" cpu_seconds)," \
+         "\"peak_rss_bytes\": $(json_value "$4" peak_rss_bytes), \"checksum\": \"$(checksum "$5")\"}" >> "$RESULTS"
+}
+
+for COVERAGE in voronoi raster
+do
+    # Named by every knob it was generated with, so changing one generates
+    # a new coverage rather than reusing a stale one.
+    SRC="$BENCH_DIR/$COVERAGE-n$BENCH_FEATURES-s$BENCH_SLIVERS-v$BENCH_VERTICES-g$BENCH_GIANTS-r$BENCH_SEED.gpkg"
+    if [ ! -f "$SRC" ]
+    then
+        ./gencoverage -type $COVERAGE -n "$BENCH_FEATURES" -slivers "$BENCH_SLIVERS" \
+            -vertices "$BENCH_VERTICES" -giants "$BENCH_GIANTS" -seed "$BENCH_SEED" "$SRC"
+    fi
+
+    DST="$BENCH_DIR/$COVERAGE-explode.gpkg"
+    rm -f "$DST"
+    ./explode -stats "$BENCH_DIR/stats.json" "$SRC" "$DST"
+    record $COVERAGE explode null "$BENCH_DIR/stats.json" "$DST"
+
+    for MERGE in largest smallest longest
+    do
+        DST="$BENCH_DIR/$COVERAGE-$MERGE.gpkg"
+        rm -f "$DST"
+        ./eliminate -min "$BENCH_MIN_AREA" -merge $MERGE -stats "$BENCH_DIR/stats.json" "$SRC" "$DST"
+        record $COVERAGE eliminate "\"$MERGE\"" "$BENCH_DIR/stats.json" "$DST"
+    done
+done
+
+rm -f "$BENCH_DIR/stats.json"
+echo "Results appended to $RESULTS"
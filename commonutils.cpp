@@ -160,6 +160,40 @@ CPLString GetOutputDriverForRaster(const char *pszDestFilename)
     return osFormat;
 }
 
+/* -------------------------------------------------------------------- */
+/*                          TimeoutProgress()                           */
+/* -------------------------------------------------------------------- */
+
+TimeoutProgressData::TimeoutProgressData(GDALProgressFunc pfnProgressIn,
+                                         void *pProgressDataIn,
+                                         double dfTimeoutIn)
+    : pfnProgress(pfnProgressIn), pProgressData(pProgressDataIn),
+      dfTimeout(dfTimeoutIn),
+      tDeadline(std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(dfTimeoutIn)))
+{
+}
+
+int CPL_STDCALL TimeoutProgress(double dfComplete, const char *pszMessage,
+                                void *pProgressArg)
+{
+    TimeoutProgressData *psData =
+        static_cast<TimeoutProgressData *>(pProgressArg);
+    if (std::chrono::steady_clock::now() > psData->tDeadline)
+    {
+        CPLError(CE_Failure, CPLE_UserInterrupt,
+                 "Timeout of %.1f seconds exceeded.", psData->dfTimeout);
+        return FALSE;
+    }
+    if (psData->pfnProgress != nullptr)
+    {
+        return psData->pfnProgress(dfComplete, pszMessage,
+                                   psData->pProgressData);
+    }
+    return TRUE;
+}
+
 /* -------------------------------------------------------------------- */
 /*                        EarlySetConfigOptions()                       */
 /* -------------------------------------------------------------------- */
@@ -90,13 +90,31 @@ CPL_C_END
 
 #ifdef __cplusplus
 
+#include "cpl_progress.h"
 #include "cpl_string.h"
+#include <chrono>
 #include <vector>
 
 std::vector<CPLString> CPL_DLL GetOutputDriversFor(const char *pszDestFilename,
                                                    int nFlagRasterVector);
 CPLString CPL_DLL GetOutputDriverForRaster(const char *pszDestFilename);
 
+// Progress callback that forwards to another one (which may be null) and
+// cancels the operation once the deadline has passed.
+struct TimeoutProgressData
+{
+    GDALProgressFunc pfnProgress;
+    void *pProgressData;
+    double dfTimeout;
+    std::chrono::steady_clock::time_point tDeadline;
+
+    TimeoutProgressData(GDALProgressFunc pfnProgressIn, void *pProgressDataIn,
+                        double dfTimeoutIn);
+};
+
+int CPL_STDCALL TimeoutProgress(double dfComplete, const char *pszMessage,
+                                void *pProgressArg);
+
 #endif /* __cplusplus */
 
 #endif /* COMMONUTILS_H_INCLUDED */
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "deferredindex.h"
+
+// The SQL that builds the index for each driver whose index can be deferred.
+// %s are the layer and geometry column names, quoted for SQL. The SQLite
+// driver only has a spatial index, and the function to build it, when the
+// database is SpatiaLite.
+static const struct
+{
+    const char *pszDriver;
+    const char *pszSQL;
+    bool bSpatiaLite;
+} asIndexBuilders[] = {
+    {"GPKG", "SELECT gpkgAddSpatialIndex('%s', '%s')", false},
+    {"SQLite", "SELECT CreateSpatialIndex('%s', '%s')", true},
+};
+
+static bool IsSpatiaLite(GDALDataset *poDstDS)
+{
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    OGRLayer *poResult = poDstDS->ExecuteSQL("SELECT spatialite_version()", nullptr, nullptr);
+    CPLPopErrorHandler();
+    CPLErrorReset();
+    if (poResult == nullptr)
+    {
+        return false;
+    }
+    poDstDS->ReleaseResultSet(poResult);
+    return true;
+}
+
+static const char *IndexBuilderSQL(GDALDataset *poDstDS)
+{
+    const char *pszDriver = poDstDS->GetDriverName();
+    for (const auto &sBuilder : asIndexBuilders)
+    {
+        if (EQUAL(pszDriver, sBuilder.pszDriver))
+        {
+            if (sBuilder.bSpatiaLite && !IsSpatiaLite(poDstDS))
+            {
+                return nullptr;
+            }
+            return sBuilder.pszSQL;
+        }
+    }
+    return nullptr;
+}
+
+static CPLString QuoteSQLString(const char *pszValue)
+{
+    CPLString osValue = pszValue;
+    osValue.replaceAll("'", "''");
+    return osValue;
+}
+
+char **DeferredIndexLayerOptions(GDALDataset *poDstDS)
+{
+    if (IndexBuilderSQL(poDstDS) == nullptr)
+    {
+        return nullptr;
+    }
+    return CSLSetNameValue(nullptr, "SPATIAL_INDEX", "NO");
+}
+
+OGRErr BuildDeferredIndex(GDALDataset *poDstDS, OGRLayer *poDstLayer)
+{
+    const char *pszSQL = IndexBuilderSQL(poDstDS);
+    if (pszSQL == nullptr)
+    {
+        return OGRERR_NONE;
+    }
+
+    CPLString osSQL;
+    osSQL.Printf(pszSQL, QuoteSQLString(poDstLayer->GetName()).c_str(), QuoteSQLString(poDstLayer->GetGeometryColumn()).c_str());
+
+    CPLErrorReset();
+    OGRLayer *poResult = poDstDS->ExecuteSQL(osSQL, nullptr, nullptr);
+    if (poResult != nullptr)
+    {
+        poDstDS->ReleaseResultSet(poResult);
+    }
+
+    if (CPLGetLastErrorType() == CE_Failure)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unable to build the spatial index of %s.", poDstLayer->GetName());
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef DEFERREDINDEX_H_INCLUDED
+#define DEFERREDINDEX_H_INCLUDED
+
+#include "cpl_port.h"
+#include "ogr_core.h"
+
+class GDALDataset;
+class OGRLayer;
+
+// Some drivers keep their spatial index up to date on every insert (GPKG
+// and SpatiaLite with RTree triggers). When writing many features it is
+// cheaper to create the layer without one and build it once at the end.
+// Drivers that already build their index at the end, or have none, are
+// left as they are.
+
+// Layer creation options that leave out the spatial index, or null if the
+// driver has nothing to defer. The caller frees the list with CSLDestroy.
+char **DeferredIndexLayerOptions(GDALDataset *poDstDS);
+
+// Builds the index left out by DeferredIndexLayerOptions().
+OGRErr BuildDeferredIndex(GDALDataset *poDstDS, OGRLayer *poDstLayer);
+
+#endif // DEFERREDINDEX_H_INCLUDED
@@ -0,0 +1,147 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <algorithm>
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "diagnostics.h"
+
+
+static const struct
+{
+    const char *pszName;
+    const char *pszDescription;
+} asCategories[Diagnostics::CATEGORY_COUNT] = {
+    {"no_geometry", "No geometry"},
+    {"geos_export_failed", "Failed conversion to GEOS geometry"},
+    {"geos_prepare_failed", "Failed to prepare GEOS geometry"},
+    {"area_failed", "Failed area calculation"},
+    {"length_failed", "Failed length calculation on shared boundary"},
+    {"no_neighbors", "No neighbors"},
+    {"no_touching_neighbors", "No touching neighbors"},
+    {"write_failed", "Failed to create feature in destination layer"},
+    {"fid_not_found", "Selected feature not found in source layer"},
+    {"union_failed", "Failed to merge group, written unmerged"},
+};
+
+Diagnostics::Diagnostics()
+{
+    for (auto &sBucket : m_asBuckets)
+    {
+        sBucket.nCount.store(0, std::memory_order_relaxed);
+    }
+}
+
+const char *Diagnostics::describe(Category eCategory)
+{
+    return asCategories[eCategory].pszDescription;
+}
+
+bool Diagnostics::empty() const
+{
+    for (int i = 0; i < CATEGORY_COUNT; i++)
+    {
+        if (count(static_cast<Category>(i)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Diagnostics::report() const
+{
+    for (int i = 0; i < CATEGORY_COUNT; i++)
+    {
+        const bucket_t &sBucket = m_asBuckets[i];
+        GIntBig nCount = count(static_cast<Category>(i));
+        if (nCount == 0)
+        {
+            continue;
+        }
+
+        CPLString osFIDs;
+        int nSamples = static_cast<int>(std::min<GIntBig>(nCount, MAX_SAMPLES));
+        for (int j = 0; j < nSamples; j++)
+        {
+            if (j > 0)
+            {
+                osFIDs += ", ";
+            }
+            osFIDs += CPLSPrintf(CPL_FRMT_GIB, sBucket.anSampleFIDs[j]);
+        }
+        if (nCount > nSamples)
+        {
+            osFIDs += ", ...";
+        }
+
+        CPLError(CE_Warning, CPLE_AppDefined, "%s: " CPL_FRMT_GIB " feature(s) (FID %s).",
+                 asCategories[i].pszDescription, nCount, osFIDs.c_str());
+    }
+}
+
+bool Diagnostics::write(const char *pszFilename) const
+{
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return false;
+    }
+
+    bool bOK = VSIFPrintfL(fp, "{\n") > 0;
+    bool bFirst = true;
+    for (int i = 0; i < CATEGORY_COUNT; i++)
+    {
+        const bucket_t &sBucket = m_asBuckets[i];
+        GIntBig nCount = count(static_cast<Category>(i));
+        if (nCount == 0)
+        {
+            continue;
+        }
+
+        bOK &= VSIFPrintfL(fp, "%s  \"%s\": {\"count\": " CPL_FRMT_GIB ", \"sample_fids\": [",
+                           bFirst ? "" : ",\n", asCategories[i].pszName, nCount) > 0;
+        bFirst = false;
+
+        int nSamples = static_cast<int>(std::min<GIntBig>(nCount, MAX_SAMPLES));
+        for (int j = 0; j < nSamples; j++)
+        {
+            bOK &= VSIFPrintfL(fp, "%s" CPL_FRMT_GIB, j > 0 ? ", " : "", sBucket.anSampleFIDs[j]) > 0;
+        }
+        bOK &= VSIFPrintfL(fp, "]}") > 0;
+    }
+    bOK &= VSIFPrintfL(fp, "%s}\n", bFirst ? "" : "\n") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef DIAGNOSTICS_H_INCLUDED
+#define DIAGNOSTICS_H_INCLUDED
+
+#include <atomic>
+
+#include "cpl_port.h"
+
+// Per-feature problems are counted here instead of being reported through
+// CPLError as they happen, and are summarized once at the end of a run. Any
+// thread may record; nothing here takes a lock.
+//
+class Diagnostics
+{
+public:
+    enum Category
+    {
+        NO_GEOMETRY = 0,
+        GEOS_EXPORT_FAILED,
+        GEOS_PREPARE_FAILED,
+        AREA_FAILED,
+        LENGTH_FAILED,
+        NO_NEIGHBORS,
+        NO_TOUCHING_NEIGHBORS,
+        WRITE_FAILED,
+        FID_NOT_FOUND,
+        UNION_FAILED,
+        CATEGORY_COUNT
+    };
+
+    static constexpr int MAX_SAMPLES = 16;
+
+private:
+    // Each category lives on its own cache line so that threads recording
+    // different problems don't contend. The sample slot is claimed by the
+    // counter increment, so each slot is written by exactly one thread.
+    //
+    struct alignas(64) bucket_t
+    {
+        std::atomic<GIntBig> nCount;
+        GIntBig anSampleFIDs[MAX_SAMPLES];
+    };
+
+    bucket_t m_asBuckets[CATEGORY_COUNT];
+
+public:
+    Diagnostics();
+
+    Diagnostics(const Diagnostics &) = delete;
+    Diagnostics &operator=(const Diagnostics &) = delete;
+
+    void record(Category eCategory, GIntBig nFID)
+    {
+        bucket_t &sBucket = m_asBuckets[eCategory];
+        GIntBig nIndex = sBucket.nCount.fetch_add(1, std::memory_order_relaxed);
+        if (nIndex < MAX_SAMPLES)
+        {
+            sBucket.anSampleFIDs[nIndex] = nFID;
+        }
+    }
+
+    GIntBig count(Category eCategory) const
+    {
+        return m_asBuckets[eCategory].nCount.load(std::memory_order_relaxed);
+    }
+
+    // The remaining methods must only be called once all recording threads
+    // have finished.
+
+    bool empty() const;
+    void report() const;
+    bool write(const char *pszFilename) const;
+
+    static const char *describe(Category eCategory);
+};
+
+#endif // DIAGNOSTICS_H_INCLUDED
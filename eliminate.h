@@ -25,6 +25,7 @@
 #define ELIMINATE_H_INCLUDED
 
 #include "gdal.h"
+#include "stats.h"
 
 CPL_C_START
 
@@ -44,8 +45,91 @@ typedef struct
     char *pszFormat;
     char *pszWhere;
     EliminateMergeType eMergeType;
+    char *pszStatsFilename;
+    char **papszOptions;
+    /* Passed to the destination driver, over the write profile's. */
+    char **papszDatasetCreationOptions;
+    char **papszLayerCreationOptions;
+    /* "fast" or "default" (the same as null); see writeprofile.h. */
+    char *pszWriteProfile;
+    /* Process every layer with a geometry column, each into a layer of the
+     * same name, on nLayerJobs threads (0 for one per CPU); see
+     * alllayers.h. The layer names must then be null.
+     */
+    int bAllLayers;
+    int nLayerJobs;
+    EliminateStats *psStats;
+    GDALProgressFunc pfnProgress;
+    void *pProgressData;
 } EliminateOptions;
 
+/* Keys recognized in papszOptions:
+ *
+ *   DIAGNOSTICS_FILE=<filename>  Also write the per-feature problem summary
+ *                                to this file as JSON.
+ *   TRACE_FILE=<filename>        Write a timeline of the run to this file in
+ *                                Chrome trace event format.
+ *   NUM_THREADS=<n>|ALL_CPUS     Search for neighbors on this many threads.
+ *                                Defaults to 1. The output does not depend
+ *                                on it.
+ *   SPATIAL_ORDER=SOURCE|HILBERT Process, and write, the features in the
+ *                                order they are read (the default) or along
+ *                                a Hilbert curve of their envelope centers.
+ *   CLUSTERED_OUTPUT=YES         Write in Hilbert curve order (implies
+ *                                SPATIAL_ORDER=HILBERT), with the
+ *                                destination's spatial index built at the
+ *                                end rather than on every insert.
+ *   INDEX_NODE_CAPACITY=<n>      Node capacity of the spatial index.
+ *                                Defaults to 10.
+ *   PARTITION_BY=<field>         Only merge features with the same value
+ *                                of this field, running one elimination per
+ *                                value, NUM_THREADS (default ALL_CPUS) at a
+ *                                time. Features from different values are
+ *                                interleaved in the output. Null values
+ *                                are a partition of their own. Each
+ *                                partition's reports go to files suffixed
+ *                                part_<value>.
+ *   UNION_METHOD=GEOS|OGR        Merge each group with one GEOS unary union
+ *                                (the default) or pairwise OGR unions.
+ *   PERF_COUNTERS=YES            Sample hardware counters around each stage,
+ *                                worker threads included, into the stats
+ *                                (Linux only).
+ *   SLOW_FEATURES_FILE=<filename>
+ *                                Write the slowest neighbor searches and
+ *                                merge groups, with FID, vertex and neighbor
+ *                                counts, to this file as JSON.
+ *   SLOW_FEATURES_COUNT=<n>      How many to keep. Defaults to 20.
+ *   REPRO_DIR=<directory>        Dump the inputs of any GEOS touches,
+ *                                intersection or union that fails or is slow
+ *                                into this directory, for later replay.
+ *                                With PARTITION_BY or every layer, each
+ *                                partition or layer gets a subdirectory.
+ *   REPRO_THRESHOLD=<seconds>    What counts as slow. Defaults to 1.
+ *   REPRO_MAX=<n>                Stop capturing after this many. Defaults
+ *                                to 100.
+ *   VERIFY=YES                   Check neighbors, boundary lengths, merge
+ *                                targets and merged geometries against the
+ *                                reference GEOS computation, and fail if
+ *                                any differ.
+ *   VERIFY_SAMPLE=<n>            Only check about this many candidates and
+ *                                merge groups. Defaults to all.
+ *   VERIFY_TOLERANCE=<distance>  Defaults to 1e-6.
+ *   VERIFY_FILE=<filename>       Write the discrepancies, by FID, to this
+ *                                file as JSON.
+ *   FID_OFFSETS_FILE=<filename>  With a set of source files, write each
+ *                                file and the offset added to its FIDs to
+ *                                this file as JSON.
+ */
+
+/* These functions, and Explode(), may be called concurrently from several
+ * threads: each call has its own GEOS contexts and keeps no state between
+ * calls, and configuration options are only ever set on the calling
+ * thread. GDALAllRegister() must have been called first. Errors are
+ * reported through CPLError() on the calling thread, including those from
+ * the call's own worker threads (see NUM_THREADS), so a handler pushed with
+ * CPLPushErrorHandlerEx() around a call sees only that call's errors.
+ */
+
 EliminateOptions *EliminateOptionsNew();
 void EliminateOptionsFree(EliminateOptions *psOptions);
 
@@ -55,6 +139,64 @@ OGRErr EliminatePolygonsByQuery(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, Elimin
 OGRErr EliminatePolygonsByFIDStrList(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, char **papszEliminateFIDs);
 OGRErr EliminatePolygonsByFID(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, GIntBig *panEliminateFIDs, int nCount);
 
+/* The same, taking the options above, filling in *psStats if psStats is
+ * non-null, and reporting progress. EliminatePolygonsEx() also creates the
+ * destination layer with papszLayerCreationOptions. The functions without
+ * the suffix call these with none of them.
+ */
+OGRErr EliminatePolygonsEx(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+OGRErr EliminatePolygonsByQueryEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+OGRErr EliminatePolygonsByFIDStrListEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, char **papszEliminateFIDs, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+OGRErr EliminatePolygonsByFIDEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, GIntBig *panEliminateFIDs, int nCount, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+
+/* As EliminatePolygonsEx(), reading one layer from each of a set of files as if they were
+ * one layer, so features touch across files: pszSource is @<list file>, a
+ * directory or a wildcard pattern (see sources.h). Every file must have
+ * the same fields. Each file's FIDs are shifted past those of the file
+ * before; FID_OFFSETS_FILE records by how much. EliminatePolygonsWithOptions()
+ * does this when its source is one of those.
+ */
+OGRErr EliminatePolygonsMultiSource(const char *pszSource, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+
+/* One feature that is kept, for EliminateWKB(). pabyWKB is null, and
+ * nWKBSize zero, if nothing was merged into it, in which case its geometry
+ * is unchanged; otherwise it is the merged geometry, as ISO WKB in little
+ * endian byte order.
+ */
+typedef struct
+{
+    GIntBig nFID;
+    int nMerged;
+    GIntBig *panMergedFIDs;
+    GByte *pabyWKB;
+    size_t nWKBSize;
+} EliminateGroup;
+
+/* Eliminates polygons held in memory, without a dataset: geometry i is the
+ * WKB papabyWKB[i] of panWKBSizes[i] bytes, with FID panFIDs[i] (or i if
+ * panFIDs is null), and is a candidate if pabCandidates[i] is non-zero.
+ * Takes the same papszOptions as the functions above, and returns every
+ * feature that is kept, in *ppasGroups, to be freed with
+ * EliminateGroupsFree(). WKB that cannot be parsed is counted as a feature
+ * with no geometry, and left out.
+ */
+OGRErr EliminateWKB(const GByte *const *papabyWKB, const size_t *panWKBSizes, const GIntBig *panFIDs, const int *pabCandidates, int nCount, EliminateMergeType eMergeType, CSLConstList papszOptions, EliminateStats *psStats, EliminateGroup **ppasGroups, int *pnGroups, GDALProgressFunc pfnProgress, void *pProgressData);
+void EliminateGroupsFree(EliminateGroup *pasGroups, int nGroups);
+
+/* A read-only layer of the result of eliminating the features of hSrcLayer
+ * that match pszWhere, merged on demand as it is read; see
+ * eliminatedlayer.h. hSrcDS, which may be null, is the dataset hSrcLayer
+ * belongs to, for the where clause. Null on failure. hSrcLayer may be
+ * closed once this returns.
+ */
+OGRLayerH EliminatedLayerCreate(GDALDatasetH hSrcDS, OGRLayerH hSrcLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+/* Writes the reports and completes the stats, returning the error that
+ * would otherwise be lost when the layer is destroyed: discrepancies found
+ * by VERIFY, or a report that can't be written. Optional.
+ */
+OGRErr EliminatedLayerFinish(OGRLayerH hLayer);
+void EliminatedLayerDestroy(OGRLayerH hLayer);
+
 CPL_C_END
 
 #endif // ELIMINATE_H_INCLUDED
@@ -23,16 +23,35 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 
 #include "gdal.h"
 #include "commonutils.h"
+#include "autotune.h"
+#include "batch.h"
 #include "eliminate.h"
+#include "repro.h"
+#include "server.h"
+#include "sources.h"
 
 
 static void PrintUsage(const char *pszErrorMessage = nullptr)
 {
-    std::cerr << "eliminate [-min <min_area> | -where <filter>] [-f <formatname>] <src_filename> [-l <src_layer>] <dst_filename> [-l <dst_layer>]" << std::endl;
+    // A job's errors are captured with it, and its usage is no help there.
+    if (InCapturedJob())
+    {
+        if (pszErrorMessage != nullptr)
+        {
+            CPLError(CE_Failure, CPLE_IllegalArg, "%s", pszErrorMessage);
+        }
+        return;
+    }
+
+    std::cerr << "eliminate -replay [-iterations <n>] <repro_filename>..." << std::endl;
+    std::cerr << "eliminate -batch <manifest> [-jobs <n>] [-report <report_filename>]" << std::endl;
+    std::cerr << "eliminate -serve <socket_path> [-jobs <n>] [-queue <n>]" << std::endl;
+    std::cerr << "eliminate [-min <min_area> | -where <filter>] [-merge largest|smallest|longest] [-f <formatname>] [-diag <diag_filename>] [-stats <stats_filename>] [-trace <trace_filename>] [-slow <slow_filename> [-slow-count <n>]] [-repro <directory> [-repro-threshold <seconds>]] [-verify [-verify-sample <n>] [-verify-tolerance <distance>] [-verify-file <filename>]] [-auto [-auto-sample <fraction>]] [-threads <n>|ALL_CPUS] [-index-capacity <n>] [-order source|hilbert] [-clustered] [-dsco <NAME=VALUE>]... [-lco <NAME=VALUE>]... [-write-profile fast|default] [-all-layers [-layer-jobs <n>]] [-partition-by <field>] [-union geos|ogr] [-scaling [-max-threads <n>]] [-perf] [-mem] [-progress] [-timeout <seconds>] [-fid-offsets <filename>] <src_filename>|<src_directory>|<src_pattern>|@<src_list> [-l <src_layer>] <dst_filename> [-l <dst_layer>]" << std::endl;
     if (pszErrorMessage != nullptr)
     {
         std::cerr << "FAILURE: " << pszErrorMessage << std::endl;
@@ -52,7 +71,7 @@ static bool HasEnoughAdditionalArgs(char **papszArgv, int i, int nArgc, int nExt
     }
 }
 
-static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, EliminateOptions *psOptions)
+static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, EliminateOptions *psOptions, double *pdfTimeout, bool *pbMemoryReport, int *pnScalingThreads, double *pdfAutoSample)
 {
     const char *pszSrcFilename = nullptr;
     const char *pszSrcLayerName = nullptr;
@@ -61,6 +80,15 @@ static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, Eli
     const char *pszFormat = nullptr;
     const char *pszWhere = nullptr;
     const char *pszMin = nullptr;
+    const char *pszDiagnosticsFilename = nullptr;
+    const char *pszStatsFilename = nullptr;
+    const char *pszTraceFilename = nullptr;
+    const char *pszTimeout = nullptr;
+    const char *pszMaxThreads = nullptr;
+    bool bProgress = false;
+    bool bScaling = false;
+    bool bAuto = false;
+    const char *pszAutoSample = nullptr;
 
     for (int i = 1; i < nArgc; ++i)
     {
@@ -88,6 +116,266 @@ static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, Eli
             }
             pszMin = papszArgv[++i];
         }
+        else if (EQUAL(papszArgv[i], "-merge"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszMergeType = papszArgv[++i];
+            if (EQUAL(pszMergeType, "largest"))
+            {
+                psOptions->eMergeType = ELIMINATE_MERGE_LARGEST_AREA;
+            }
+            else if (EQUAL(pszMergeType, "smallest"))
+            {
+                psOptions->eMergeType = ELIMINATE_MERGE_SMALLEST_AREA;
+            }
+            else if (EQUAL(pszMergeType, "longest"))
+            {
+                psOptions->eMergeType = ELIMINATE_MERGE_LONGEST_BOUNDARY;
+            }
+            else
+            {
+                PrintUsage(CPLSPrintf("Unknown merge type '%s'.", pszMergeType));
+                return OGRERR_FAILURE;
+            }
+        }
+        else if (EQUAL(papszArgv[i], "-diag"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszDiagnosticsFilename = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-stats"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszStatsFilename = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-trace"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszTraceFilename = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-slow"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "SLOW_FEATURES_FILE", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-slow-count"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "SLOW_FEATURES_COUNT", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-repro"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "REPRO_DIR", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-repro-threshold"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "REPRO_THRESHOLD", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-verify"))
+        {
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "VERIFY", "YES");
+        }
+        else if (EQUAL(papszArgv[i], "-verify-sample"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "VERIFY_SAMPLE", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-verify-tolerance"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "VERIFY_TOLERANCE", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-fid-offsets"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "FID_OFFSETS_FILE", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-verify-file"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "VERIFY_FILE", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-threads"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "NUM_THREADS", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-index-capacity"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "INDEX_NODE_CAPACITY", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-order"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszOrder = papszArgv[++i];
+            if (!EQUAL(pszOrder, "source") && !EQUAL(pszOrder, "hilbert"))
+            {
+                PrintUsage(CPLSPrintf("Unknown order '%s'.", pszOrder));
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "SPATIAL_ORDER", CPLString(pszOrder).toupper());
+        }
+        else if (EQUAL(papszArgv[i], "-union"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszUnionMethod = papszArgv[++i];
+            if (!EQUAL(pszUnionMethod, "geos") && !EQUAL(pszUnionMethod, "ogr"))
+            {
+                PrintUsage(CPLSPrintf("Unknown union method '%s'.", pszUnionMethod));
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "UNION_METHOD", CPLString(pszUnionMethod).toupper());
+        }
+        else if (EQUAL(papszArgv[i], "-auto"))
+        {
+            bAuto = true;
+        }
+        else if (EQUAL(papszArgv[i], "-auto-sample"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszAutoSample = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-scaling"))
+        {
+            bScaling = true;
+        }
+        else if (EQUAL(papszArgv[i], "-max-threads"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszMaxThreads = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-clustered"))
+        {
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "CLUSTERED_OUTPUT", "YES");
+        }
+        else if (EQUAL(papszArgv[i], "-dsco"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszDatasetCreationOptions = CSLAddString(psOptions->papszDatasetCreationOptions, papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-lco"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszLayerCreationOptions = CSLAddString(psOptions->papszLayerCreationOptions, papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-write-profile"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszWriteProfile = papszArgv[++i];
+            if (!EQUAL(pszWriteProfile, "fast") && !EQUAL(pszWriteProfile, "default"))
+            {
+                PrintUsage(CPLSPrintf("Unknown write profile '%s'.", pszWriteProfile));
+                return OGRERR_FAILURE;
+            }
+            CPLFree(psOptions->pszWriteProfile);
+            psOptions->pszWriteProfile = CPLStrdup(pszWriteProfile);
+        }
+        else if (EQUAL(papszArgv[i], "-partition-by"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "PARTITION_BY", papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-all-layers"))
+        {
+            psOptions->bAllLayers = TRUE;
+        }
+        else if (EQUAL(papszArgv[i], "-layer-jobs"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nLayerJobs = std::max(1, atoi(papszArgv[++i]));
+        }
+        else if (EQUAL(papszArgv[i], "-perf"))
+        {
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "PERF_COUNTERS", "YES");
+        }
+        else if (EQUAL(papszArgv[i], "-mem"))
+        {
+            *pbMemoryReport = true;
+        }
+        else if (EQUAL(papszArgv[i], "-progress"))
+        {
+            bProgress = true;
+        }
+        else if (EQUAL(papszArgv[i], "-timeout"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszTimeout = papszArgv[++i];
+        }
         else if (EQUAL(papszArgv[i], "-l") || EQUAL(papszArgv[i], "-layer"))
         {
             if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
@@ -159,6 +447,18 @@ static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, Eli
         return OGRERR_FAILURE;
     }
 
+    if (psOptions->bAllLayers && (pszSrcLayerName != nullptr || pszDstLayerName != nullptr))
+    {
+        PrintUsage("-all-layers cannot be combined with -l.");
+        return OGRERR_FAILURE;
+    }
+
+    if (psOptions->bAllLayers && (bScaling || bAuto))
+    {
+        PrintUsage("-all-layers cannot be combined with -scaling or -auto.");
+        return OGRERR_FAILURE;
+    }
+
     if (pszSrcLayerName != nullptr)
     {
         psOptions->pszSrcLayerName = CPLStrdup(pszSrcLayerName);
@@ -169,6 +469,66 @@ static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, Eli
         psOptions->pszDstLayerName = CPLStrdup(pszDstLayerName);
     }
 
+    if (pszDiagnosticsFilename != nullptr)
+    {
+        psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "DIAGNOSTICS_FILE", pszDiagnosticsFilename);
+    }
+
+    if (pszTraceFilename != nullptr)
+    {
+        psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "TRACE_FILE", pszTraceFilename);
+    }
+
+    if (pszStatsFilename != nullptr)
+    {
+        psOptions->pszStatsFilename = CPLStrdup(pszStatsFilename);
+    }
+
+    if (bProgress)
+    {
+        psOptions->pfnProgress = GDALTermProgress;
+    }
+
+    if (pszTimeout != nullptr)
+    {
+        *pdfTimeout = CPLAtofM(pszTimeout);
+        if (*pdfTimeout <= 0.0)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Invalid value for -timeout: %s", pszTimeout);
+            return OGRERR_FAILURE;
+        }
+    }
+
+    if (bAuto)
+    {
+        *pdfAutoSample = pszAutoSample != nullptr ? CPLAtofM(pszAutoSample) : 0.01;
+        if (*pdfAutoSample <= 0.0 || *pdfAutoSample > 1.0)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Invalid value for -auto-sample: %s", pszAutoSample);
+            return OGRERR_FAILURE;
+        }
+    }
+    else if (pszAutoSample != nullptr)
+    {
+        PrintUsage("'-auto-sample' requires '-auto'.");
+        return OGRERR_FAILURE;
+    }
+
+    if (bScaling)
+    {
+        *pnScalingThreads = pszMaxThreads != nullptr ? atoi(pszMaxThreads) : CPLGetNumCPUs();
+        if (*pnScalingThreads <= 0)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Invalid value for -max-threads: %s", pszMaxThreads);
+            return OGRERR_FAILURE;
+        }
+    }
+    else if (pszMaxThreads != nullptr)
+    {
+        PrintUsage("'-max-threads' requires '-scaling'.");
+        return OGRERR_FAILURE;
+    }
+
     if (pszWhere != nullptr && pszMin != nullptr)
     {
         PrintUsage("Cannot use '-min' with '-where'.");
@@ -224,6 +584,212 @@ static OGRErr EliminatePolygonsCmdLineProcessor(int nArgc, char **papszArgv, Eli
     return OGRERR_NONE;
 }
 
+// Replays captured GEOS operations and reports their timings, so that each
+// hotspot can be profiled on its own.
+//
+static int ReplayReproducers(int nArgc, char **papszArgv)
+{
+    int nIterations = 10;
+    std::vector<const char *> apszFilenames;
+
+    for (int i = 1; i < nArgc; i++)
+    {
+        if (EQUAL(papszArgv[i], "-replay"))
+        {
+            continue;
+        }
+        else if (EQUAL(papszArgv[i], "-iterations"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return EXIT_FAILURE;
+            }
+            nIterations = atoi(papszArgv[++i]);
+            if (nIterations <= 0)
+            {
+                CPLError(CE_Failure, CPLE_AppDefined, "Invalid value for -iterations: %s", papszArgv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            apszFilenames.push_back(papszArgv[i]);
+        }
+    }
+
+    if (apszFilenames.empty())
+    {
+        PrintUsage("Missing reproducer filename.");
+        return EXIT_FAILURE;
+    }
+
+    int nExitStatus = EXIT_SUCCESS;
+    for (const char *pszFilename : apszFilenames)
+    {
+        std::string osOperation;
+        std::vector<double> adfSeconds;
+        if (!ReplayReproducer(pszFilename, nIterations, osOperation, adfSeconds))
+        {
+            nExitStatus = EXIT_FAILURE;
+            continue;
+        }
+
+        std::sort(adfSeconds.begin(), adfSeconds.end());
+        std::cout << pszFilename << ": " << osOperation << " x" << adfSeconds.size()
+                  << CPLSPrintf(" min %.3f ms, median %.3f ms, max %.3f ms",
+                                adfSeconds.front() * 1000.0, adfSeconds[adfSeconds.size() / 2] * 1000.0,
+                                adfSeconds.back() * 1000.0)
+                  << std::endl;
+    }
+
+    return nExitStatus;
+}
+
+// Runs the same elimination with 1, 2, 4... threads up to nMaxThreads and
+// prints the speedup of each stage, so that the stages which stay serial
+// stand out.
+//
+static OGRErr RunScalingBenchmark(EliminateOptions *psOptions, int nMaxThreads)
+{
+    std::vector<int> anThreads;
+    for (int nThreads = 1; nThreads < nMaxThreads; nThreads *= 2)
+    {
+        anThreads.push_back(nThreads);
+    }
+    anThreads.push_back(nMaxThreads);
+
+    std::vector<EliminateStats> asStats(anThreads.size());
+    char **papszBaseOptions = CSLDuplicate(psOptions->papszOptions);
+    OGRErr eErr = OGRERR_NONE;
+
+    for (size_t i = 0; eErr == OGRERR_NONE && i < anThreads.size(); i++)
+    {
+        VSIStatBufL sStat;
+        if (VSIStatL(psOptions->pszDstFilename, &sStat) == 0)
+        {
+            OGRSFDriverH hDriver = OGRGetDriverByName(psOptions->pszFormat);
+            if (hDriver == nullptr || OGR_Dr_DeleteDataSource(hDriver, psOptions->pszDstFilename) != OGRERR_NONE)
+            {
+                CPLError(CE_Failure, CPLE_AppDefined, "Unable to delete %s between runs.", psOptions->pszDstFilename);
+                eErr = OGRERR_FAILURE;
+                break;
+            }
+        }
+
+        CSLDestroy(psOptions->papszOptions);
+        psOptions->papszOptions = CSLSetNameValue(CSLDuplicate(papszBaseOptions), "NUM_THREADS", CPLSPrintf("%d", anThreads[i]));
+        psOptions->psStats = &asStats[i];
+        eErr = EliminatePolygonsWithOptions(psOptions);
+    }
+
+    psOptions->psStats = nullptr;
+    CSLDestroy(papszBaseOptions);
+
+    if (eErr != OGRERR_NONE)
+    {
+        return eErr;
+    }
+
+    const EliminateStats &sBase = asStats.front();
+    std::cout << CPLSPrintf("%7s %9s %7s %6s", "threads", "wall (s)", "speedup", "eff.");
+    for (int iStage = 0; iStage < ELIMINATE_STAGE_COUNT; iStage++)
+    {
+        std::cout << CPLSPrintf(" %17s", EliminateStageName(static_cast<EliminateStage>(iStage)));
+    }
+    std::cout << std::endl;
+
+    for (size_t i = 0; i < asStats.size(); i++)
+    {
+        const EliminateStats &sStats = asStats[i];
+        double dfSpeedup = sStats.dfWallSeconds > 0.0 ? sBase.dfWallSeconds / sStats.dfWallSeconds : 0.0;
+        std::cout << CPLSPrintf("%7d %9.3f %6.2fx %5.0f%%", anThreads[i], sStats.dfWallSeconds, dfSpeedup,
+                                100.0 * dfSpeedup / anThreads[i]);
+        for (int iStage = 0; iStage < ELIMINATE_STAGE_COUNT; iStage++)
+        {
+            double dfSeconds = sStats.adfStageSeconds[iStage];
+            double dfStageSpeedup = dfSeconds > 0.0 ? sBase.adfStageSeconds[iStage] / dfSeconds : 0.0;
+            std::cout << CPLSPrintf(" %9.3f (%5.2fx)", dfSeconds, dfStageSpeedup);
+        }
+        std::cout << std::endl;
+    }
+
+    // A stage that has not got meaningfully faster by the last run is
+    // effectively serial, and bounds the overall speedup.
+    const EliminateStats &sLast = asStats.back();
+    if (anThreads.back() > 1)
+    {
+        for (int iStage = 0; iStage < ELIMINATE_STAGE_COUNT; iStage++)
+        {
+            double dfSeconds = sLast.adfStageSeconds[iStage];
+            if (dfSeconds > 0.0 && sBase.adfStageSeconds[iStage] / dfSeconds < 1.2)
+            {
+                std::cout << "Serial stage: " << EliminateStageName(static_cast<EliminateStage>(iStage))
+                          << CPLSPrintf(" (%.0f%% of wall time at %d threads)",
+                                        sLast.dfWallSeconds > 0.0 ? 100.0 * dfSeconds / sLast.dfWallSeconds : 0.0,
+                                        anThreads.back())
+                          << std::endl;
+            }
+        }
+    }
+
+    return OGRERR_NONE;
+}
+
+// Tunes the engine settings not given on the command line on a sample of
+// the source, and adds them to the options.
+//
+static OGRErr AutoTune(EliminateOptions *psOptions, double dfSampleFraction)
+{
+    if (IsMultiSource(psOptions->pszSrcFilename))
+    {
+        CPLError(CE_Failure, CPLE_NotSupported, "'-auto' needs a single source dataset, not a set of files.");
+        return OGRERR_FAILURE;
+    }
+
+    GDALDatasetH hSrcDS = GDALOpenEx(psOptions->pszSrcFilename, GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR, nullptr, nullptr, nullptr);
+    if (hSrcDS == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    OGRErr eErr = EliminateAutoTune(hSrcDS, psOptions->pszSrcLayerName, psOptions->pszFormat, psOptions->eMergeType, psOptions->pszWhere,
+                                    psOptions->papszOptions, dfSampleFraction, &psOptions->papszOptions, stdout);
+    GDALClose(hSrcDS);
+    return eErr;
+}
+
+// Runs one eliminate job per manifest line, each parsed as its own command
+// line. Modes that run several eliminations, or print their own report,
+// don't mix with the rest of the batch's output and are refused.
+//
+static OGRErr RunBatchJob(int nArgc, char **papszArgv)
+{
+    EliminateOptions *psOptions = EliminateOptionsNew();
+    double dfTimeout = 0.0;
+    bool bMemoryReport = false;
+    int nScalingThreads = 0;
+    double dfAutoSample = 0.0;
+    OGRErr eErr = EliminatePolygonsCmdLineProcessor(nArgc, papszArgv, psOptions, &dfTimeout, &bMemoryReport, &nScalingThreads, &dfAutoSample);
+    if (eErr == OGRERR_NONE && (bMemoryReport || nScalingThreads > 0 || dfAutoSample > 0.0))
+    {
+        CPLError(CE_Failure, CPLE_NotSupported, "'-mem', '-scaling' and '-auto' are not supported in a batch.");
+        eErr = OGRERR_FAILURE;
+    }
+    if (eErr == OGRERR_NONE)
+    {
+        psOptions->pfnProgress = nullptr;
+        TimeoutProgressData sTimeout(nullptr, nullptr, dfTimeout);
+        if (dfTimeout > 0.0)
+        {
+            psOptions->pfnProgress = TimeoutProgress;
+            psOptions->pProgressData = &sTimeout;
+        }
+        eErr = EliminatePolygonsWithOptions(psOptions);
+    }
+    EliminateOptionsFree(psOptions);
+    return eErr;
+}
+
 MAIN_START(argc, argv)
 {
     GDALAllRegister();
@@ -237,15 +803,57 @@ MAIN_START(argc, argv)
     {
         PrintUsage();
     }
+    else if (nArgc > 1 && EQUAL(papszArgv[1], "-replay"))
+    {
+        nExitStatus = ReplayReproducers(nArgc, papszArgv);
+    }
+    else if (nArgc > 1 && EQUAL(papszArgv[1], "-batch"))
+    {
+        nExitStatus = RunBatchCommand(nArgc, papszArgv, RunBatchJob) == OGRERR_NONE ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (nArgc > 1 && EQUAL(papszArgv[1], "-serve"))
+    {
+        nExitStatus = RunServerCommand("eliminate", nArgc, papszArgv, RunBatchJob) == OGRERR_NONE ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     else
     {
         EliminateOptions *psOptions = EliminateOptionsNew();
-        OGRErr eErr = EliminatePolygonsCmdLineProcessor(nArgc, papszArgv, psOptions);
-        if (eErr == OGRERR_NONE)
+        double dfTimeout = 0.0;
+        bool bMemoryReport = false;
+        int nScalingThreads = 0;
+        double dfAutoSample = 0.0;
+        EliminateStats sStats;
+        OGRErr eErr = EliminatePolygonsCmdLineProcessor(nArgc, papszArgv, psOptions, &dfTimeout, &bMemoryReport, &nScalingThreads, &dfAutoSample);
+        if (eErr == OGRERR_NONE && dfAutoSample > 0.0)
+        {
+            eErr = AutoTune(psOptions, dfAutoSample);
+        }
+        if (eErr == OGRERR_NONE && nScalingThreads > 0)
+        {
+            if (RunScalingBenchmark(psOptions, nScalingThreads) == OGRERR_NONE)
+            {
+                nExitStatus = EXIT_SUCCESS;
+            }
+        }
+        else if (eErr == OGRERR_NONE)
         {
+            if (bMemoryReport)
+            {
+                psOptions->psStats = &sStats;
+            }
+            TimeoutProgressData sTimeout(psOptions->pfnProgress, psOptions->pProgressData, dfTimeout);
+            if (dfTimeout > 0.0)
+            {
+                psOptions->pfnProgress = TimeoutProgress;
+                psOptions->pProgressData = &sTimeout;
+            }
             eErr = EliminatePolygonsWithOptions(psOptions);
             if (eErr == OGRERR_NONE)
             {
+                if (bMemoryReport)
+                {
+                    EliminateStatsPrintMemory(&sStats, stdout);
+                }
                 nExitStatus = EXIT_SUCCESS;
             }
         }
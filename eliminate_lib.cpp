@@ -24,260 +24,473 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <memory>
 #include <unordered_set>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
 
 #include "gdal.h"
+#include "cpl_string.h"
 #include "ogrsf_frmts.h"
 
 #include "geos_c.h"
 
 #include "eliminate.h"
+#include "alllayers.h"
+#include "deferredindex.h"
+#include "eliminator.h"
+#include "sources.h"
+#include "threaderrors.h"
+#include "writeprofile.h"
 
 
 extern OGRErr CopyFeature(OGRLayer *poDstLayer, const OGRFeature *poSrcFeature, const OGRGeometry *poGeometry);
 
-class FeatureCreature
+
+EliminateOptions *EliminateOptionsNew()
+{
+    EliminateOptions *psOptions = new EliminateOptions;
+    psOptions->pszSrcFilename = nullptr;
+    psOptions->pszSrcLayerName = nullptr;
+    psOptions->pszDstFilename = nullptr;
+    psOptions->pszDstLayerName = nullptr;
+    psOptions->pszFormat = nullptr;
+    psOptions->pszWhere = nullptr;
+    psOptions->eMergeType = ELIMINATE_MERGE_LARGEST_AREA;
+    psOptions->pszStatsFilename = nullptr;
+    psOptions->papszOptions = nullptr;
+    psOptions->papszDatasetCreationOptions = nullptr;
+    psOptions->papszLayerCreationOptions = nullptr;
+    psOptions->pszWriteProfile = nullptr;
+    psOptions->bAllLayers = FALSE;
+    psOptions->nLayerJobs = 0;
+    psOptions->psStats = nullptr;
+    psOptions->pfnProgress = nullptr;
+    psOptions->pProgressData = nullptr;
+    return psOptions;
+}
+
+void EliminateOptionsFree(EliminateOptions *psOptions)
+{
+    if (psOptions != nullptr)
+    {
+        CPLFree(psOptions->pszSrcFilename);
+        CPLFree(psOptions->pszSrcLayerName);
+        CPLFree(psOptions->pszDstFilename);
+        CPLFree(psOptions->pszDstLayerName);
+        CPLFree(psOptions->pszFormat);
+        CPLFree(psOptions->pszWhere);
+        CPLFree(psOptions->pszStatsFilename);
+        CSLDestroy(psOptions->papszOptions);
+        CSLDestroy(psOptions->papszDatasetCreationOptions);
+        CSLDestroy(psOptions->papszLayerCreationOptions);
+        CPLFree(psOptions->pszWriteProfile);
+        delete psOptions;
+    }
+}
+
+// Because zero is a valid FID, we can't trust CPLAtoGIntBig, since it uses
+// atoll, which returns zero for all failures, nor CPLAtoGIntBigEx, since it
+// only checks for overflow, and not whether the source string was parsable.
+//
+static GIntBig CPLAtoFID(const char *pszString)
 {
-public:
-    struct neighbor_t
+    if (pszString == nullptr || *pszString == '\0')
+    {
+        return OGRNullFID;
+    }
+    char *pszFailure = nullptr;
+    errno = 0;
+    GIntBig nFID = strtoll(pszString, &pszFailure, 10);
+    if (errno == ERANGE || nFID < 0 || (pszFailure != nullptr && *pszFailure != '\0'))
+    {
+        return OGRNullFID;
+    }
+    return nFID;
+}
+
+// Layers and partitions run at the same time, so each writes its reports to
+// its own files, named with a suffix: diag.json becomes diag_<suffix>.json.
+// Reproducers are numbered per run, so each run captures them into its own
+// subdirectory of REPRO_DIR, named with the suffix.
+//
+static char **ReportOptionsWithSuffix(CSLConstList papszOptions, const char *pszSuffix)
+{
+    static const char *const apszReportKeys[] = {"DIAGNOSTICS_FILE", "TRACE_FILE", "SLOW_FEATURES_FILE", "VERIFY_FILE"};
+
+    char **papszLayerOptions = CSLDuplicate(papszOptions);
+    for (const char *pszKey : apszReportKeys)
     {
-        FeatureCreature *poCreature;
-        double dfBoundaryLength;
-        void addCreatureToMerge(FeatureCreature *poCreatureToMerge)
+        const char *pszFilename = CSLFetchNameValue(papszOptions, pszKey);
+        if (pszFilename != nullptr)
         {
-            poCreature->addCreatureToMerge(poCreatureToMerge);
+            CPLString osBasename = CPLSPrintf("%s_%s", CPLGetBasename(pszFilename), pszSuffix);
+            CPLString osPath = CPLGetPath(pszFilename);
+            CPLString osExtension = CPLGetExtension(pszFilename);
+            papszLayerOptions = CSLSetNameValue(papszLayerOptions, pszKey, CPLFormFilename(osPath, osBasename, osExtension));
         }
-        static bool larger(const neighbor_t &a, const neighbor_t &b) { return a.poCreature->area() >= b.poCreature->area(); };
-        static bool smaller(const neighbor_t &a, const neighbor_t &b) { return a.poCreature->area() < b.poCreature->area(); };
-        static bool longer(const neighbor_t &a, const neighbor_t &b) { return a.dfBoundaryLength >= b.dfBoundaryLength; };
-        typedef bool (*comp_t)(const neighbor_t &, const neighbor_t &);
-    };
+    }
 
-private:
-    OGRFeatureUniquePtr m_poFeature;
-    GEOSContextHandle_t m_hGEOSContext;
-    GEOSGeometry* m_poGEOSGeometry;
-    const GEOSPreparedGeometry *m_poGEOSPreparedGeometry;
-    double m_dfArea;
-    std::list<neighbor_t> m_lstNeighbors;
-    std::list<FeatureCreature *> m_lstpoCreaturesToMerge;
+    const char *pszReproDir = CSLFetchNameValue(papszOptions, "REPRO_DIR");
+    if (pszReproDir != nullptr)
+    {
+        papszLayerOptions = CSLSetNameValue(papszLayerOptions, "REPRO_DIR", CPLFormFilename(pszReproDir, pszSuffix, nullptr));
+    }
 
-public:
-    FeatureCreature(OGRFeatureUniquePtr poFeature, GEOSContextHandle_t hGEOSCtxt) :
-        m_poFeature(std::move(poFeature)), m_hGEOSContext(hGEOSCtxt),
-        m_poGEOSGeometry(nullptr), m_poGEOSPreparedGeometry(nullptr),
-        m_dfArea(-1.0)
+    return papszLayerOptions;
+}
+
+// Creates the destination layer with the source's fields.
+//
+static OGRLayer *CreateDstLayer(GDALDataset *poDstDS, const char *pszDstLayerName, OGRFeatureDefn *poSrcLayerDefn, const OGRSpatialReference *poSRS, CSLConstList papszLayerCreationOptions, bool bClustered)
+{
+    char **papszLayerOptions = CSLDuplicate(papszLayerCreationOptions);
+    if (bClustered)
     {
+        // The deferred index has to win, or building it at the end fails.
+        char **papszDeferredOptions = DeferredIndexLayerOptions(poDstDS);
+        papszLayerOptions = CSLMerge(papszLayerOptions, papszDeferredOptions);
+        CSLDestroy(papszDeferredOptions);
     }
+    OGRLayer *poDstLayer = poDstDS->CreateLayer(pszDstLayerName, poSRS, wkbPolygon, papszLayerOptions);
+    CSLDestroy(papszLayerOptions);
 
-    virtual ~FeatureCreature()
+    if (poDstLayer == nullptr)
     {
-        if (m_poGEOSPreparedGeometry != nullptr)
-        {
-            GEOSPreparedGeom_destroy_r(m_hGEOSContext ,m_poGEOSPreparedGeometry);
-        }
-        if (m_poGEOSGeometry != nullptr)
-        {
-            GEOSGeom_destroy_r(m_hGEOSContext, m_poGEOSGeometry);
-        }
+        return nullptr;
     }
 
-    const OGRFeature *feature() const
+    for (int iField = 0, nCount = poSrcLayerDefn->GetFieldCount(); iField < nCount; iField++)
     {
-        return m_poFeature.get();
+        OGRFieldDefn *poSrcFieldDefn = poSrcLayerDefn->GetFieldDefn(iField);
+        poDstLayer->CreateField(poSrcFieldDefn);
     }
 
-    OGRErr initGeometry()
+    if (poDstLayer->GetLayerDefn()->GetGeomFieldCount() == 0)
     {
-        if (m_poGEOSGeometry != nullptr)
+        for (int iField = 0, nCount = poSrcLayerDefn->GetGeomFieldCount(); iField < nCount; iField++)
         {
-            return OGRERR_NONE;
+            OGRGeomFieldDefn *poSrcFieldDefn = poSrcLayerDefn->GetGeomFieldDefn(iField);
+            poDstLayer->CreateGeomField(poSrcFieldDefn);
         }
+    }
 
-        OGRGeometry *poGeom = m_poFeature->GetGeometryRef();
-        if (poGeom == nullptr)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "No geometry?");
-            return OGRERR_FAILURE;
-        }
+    return poDstLayer;
+}
 
-        m_poGEOSGeometry = poGeom->exportToGEOS(m_hGEOSContext);
-        if (m_poGEOSGeometry == nullptr)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "That shouldn't happen. (1)");
-            return OGRERR_FAILURE;
-        }
+struct partition_t
+{
+    CPLString osValue;
+    bool bNull;
+    // Suffix of this partition's report files.
+    CPLString osSuffix;
+    std::vector<OGRFeatureUniquePtr> apoFeatures;
+    size_t nFeatures;
+    std::unordered_set<GIntBig> setFIDsToEliminate;
+    std::atomic<double> dfComplete;
+    std::atomic<bool> *pbCancelled;
+    EliminateStats sStats;
+    OGRErr eErr;
 
-        return OGRERR_NONE;
+    partition_t() : bNull(false), nFeatures(0), dfComplete(0.0), pbCancelled(nullptr), sStats(), eErr(OGRERR_NONE)
+    {
     }
+};
 
-    GEOSGeometry *geometry()
+static int CPL_STDCALL PartitionProgress(double dfComplete, const char * /*pszMessage*/, void *pProgressData)
+{
+    partition_t *psPartition = static_cast<partition_t *>(pProgressData);
+    psPartition->dfComplete = dfComplete;
+    return !psPartition->pbCancelled->load();
+}
+
+// Report files are named after the partition's value, keeping only the
+// characters that are safe in a filename, and numbered should two values
+// come out the same. Unset and null values use "null", empty ones "empty".
+//
+static CPLString PartitionSuffix(const partition_t *psPartition, std::set<CPLString> &setUsed)
+{
+    CPLString osBase("part_");
+    if (psPartition->bNull)
+    {
+        osBase += "null";
+    }
+    else if (psPartition->osValue.empty())
+    {
+        osBase += "empty";
+    }
+    else
     {
-        if (m_poGEOSGeometry == nullptr)
+        for (size_t i = 0; i < psPartition->osValue.size() && i < 64; i++)
         {
-            initGeometry();
+            char ch = psPartition->osValue[i];
+            osBase += (isalnum(static_cast<unsigned char>(ch)) || ch == '-') ? ch : '_';
         }
-        return m_poGEOSGeometry;
     }
 
-    OGRErr initPreparedGeometry()
+    CPLString osSuffix(osBase);
+    for (int i = 2; !setUsed.insert(osSuffix).second; i++)
     {
-        if (m_poGEOSPreparedGeometry != nullptr)
-        {
-            return OGRERR_NONE;
-        }
+        osSuffix.Printf("%s_%d", osBase.c_str(), i);
+    }
+    return osSuffix;
+}
 
-        OGRErr eErr = initGeometry();
-        if (eErr != OGRERR_NONE)
-        {
-            return eErr;
-        }
+// Runs one elimination per distinct value of the partition field, so that
+// features only ever merge with others of the same value. Each partition
+// has its own index and GEOS context, and they run on a pool of NUM_THREADS
+// threads (every CPU by default), each searching for neighbors on one
+// thread. Writes to the destination are serialized, so features from
+// different partitions are interleaved in the output.
+//
+static OGRErr EliminatePartitioned(OGRLayer *poSrcLayer, OGRLayer *poDstLayer, EliminateMergeType eMergeType, const char *pszWhere, const char *pszPartitionField, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    int nMajor, nMinor, nPatch;
+    if (!OGRGetGEOSVersion(&nMajor, &nMinor, &nPatch))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Installed GDAL library does not support GEOS.");
+        return OGRERR_UNSUPPORTED_OPERATION;
+    }
 
-        m_poGEOSPreparedGeometry = GEOSPrepare_r(m_hGEOSContext, m_poGEOSGeometry);
-        if (m_poGEOSPreparedGeometry == nullptr)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "That shouldn't happen. (2)");
-            return OGRERR_FAILURE;
-        }
+    int iPartitionField = poSrcLayer->GetLayerDefn()->GetFieldIndex(pszPartitionField);
+    if (iPartitionField < 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Partition field '%s' not found.", pszPartitionField);
+        return OGRERR_FAILURE;
+    }
 
-        return OGRERR_NONE;
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
     }
 
-    const GEOSPreparedGeometry *preparedGeometry()
+    OGRErr eErr = SetWhereFilter(poSrcLayer, pszWhere);
+    if (eErr != OGRERR_NONE)
     {
-        if (m_poGEOSPreparedGeometry == nullptr)
-        {
-            initPreparedGeometry();
-        }
-        return m_poGEOSPreparedGeometry;
+        return eErr;
     }
 
-    double area()
+    std::unordered_set<GIntBig> setFIDsToEliminate;
+    for (auto &poFeature : poSrcLayer)
     {
-        if (m_dfArea < 0.0)
-        {
-            if (1 != GEOSArea_r(m_hGEOSContext, geometry(), &m_dfArea))
-            {
-                CPLError(CE_Warning, CPLE_AppDefined, "Failed area calculation?");
-                m_dfArea = 0.0;
-            }
-        }
-        return m_dfArea;
+        setFIDsToEliminate.insert(poFeature->GetFID());
     }
 
-    void addNeighborIfTouching(FeatureCreature* poNeighbor)
+    eErr = poSrcLayer->SetAttributeFilter(nullptr);
+    if (eErr != OGRERR_NONE)
     {
-        // TODO: Can simply perform the intersection to determine if they touch, but is it more expensive?
+        return eErr;
+    }
 
-        if (1 == GEOSPreparedTouches_r(m_hGEOSContext, preparedGeometry(), poNeighbor->geometry()))
-        {
-            GEOSGeometry *poIntersection = GEOSIntersection_r(m_hGEOSContext, geometry(),  poNeighbor->geometry());
+    StatsCollector oStats(psStats != nullptr);
+    std::atomic<bool> bCancelled(false);
 
-            double dfLength = 0.0;
-            if (1 == GEOSLength_r(m_hGEOSContext, poIntersection, &dfLength))
-            {
-                m_lstNeighbors.push_back({poNeighbor, dfLength});
-            }
-            else
-            {
-                char *type = GEOSGeomType_r(m_hGEOSContext, poIntersection);
-                CPLError(CE_Warning, CPLE_AppDefined, "Failed length calculation on boundary of type %s.", type);
-                GEOSFree_r(m_hGEOSContext, type);
-                m_lstNeighbors.push_back({poNeighbor, 0.0});
-            }
+    // Selecting and reading get 20% of the progress, and the partitions the
+    // rest, each weighted by its feature count.
+    //
+    std::vector<std::unique_ptr<partition_t>> vecpsPartitions;
+    // Keyed by whether the value is null, then the value, so that null and
+    // empty values are kept apart.
+    std::map<std::pair<bool, CPLString>, partition_t *> mapPartitions;
+    std::set<CPLString> setSuffixes;
+    GIntBig nFeatureCount = poSrcLayer->GetFeatureCount(FALSE);
+    GIntBig nFeaturesRead = 0;
+
+    poSrcLayer->ResetReading();
+    while (true)
+    {
+        double dfComplete = nFeatureCount > 0 ? std::min(1.0, static_cast<double>(nFeaturesRead) / nFeatureCount) : 0.0;
+        if (!pfnProgress(0.2 * dfComplete, nullptr, pProgressData))
+        {
+            CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+            oStats.finish(psStats);
+            return OGRERR_FAILURE;
+        }
+
+        OGRFeatureUniquePtr poFeature;
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_READ);
+            poFeature.reset(poSrcLayer->GetNextFeature());
+        }
+        if (poFeature == nullptr)
+        {
+            break;
+        }
+        nFeaturesRead++;
+
+        // Unset and null values make a partition of their own.
+        bool bNull = !poFeature->IsFieldSetAndNotNull(iPartitionField);
+        CPLString osValue = bNull ? "" : poFeature->GetFieldAsString(iPartitionField);
+        partition_t *&psPartition = mapPartitions[std::make_pair(bNull, osValue)];
+        if (psPartition == nullptr)
+        {
+            vecpsPartitions.emplace_back(new partition_t());
+            psPartition = vecpsPartitions.back().get();
+            psPartition->osValue = osValue;
+            psPartition->bNull = bNull;
+            psPartition->osSuffix = PartitionSuffix(psPartition, setSuffixes);
+            psPartition->pbCancelled = &bCancelled;
+            CPLDebug("ELIMINATE", "Partition %s%s%s reports to files suffixed %s.", bNull ? "" : "'", bNull ? "NULL" : osValue.c_str(), bNull ? "" : "'", psPartition->osSuffix.c_str());
+        }
 
-            GEOSGeom_destroy(poIntersection);
+        GIntBig nFID = poFeature->GetFID();
+        if (setFIDsToEliminate.count(nFID) > 0)
+        {
+            psPartition->setFIDsToEliminate.insert(nFID);
         }
+        psPartition->apoFeatures.push_back(std::move(poFeature));
+        psPartition->nFeatures++;
     }
 
-    neighbor_t *findNeighbor(neighbor_t::comp_t comp)
+    if (vecpsPartitions.empty())
     {
-        auto itr = std::min_element(m_lstNeighbors.begin(), m_lstNeighbors.end(), comp);
-        return itr != m_lstNeighbors.end() ? &*itr : nullptr;
+        pfnProgress(1.0, nullptr, pProgressData);
+        oStats.finish(psStats);
+        return OGRERR_NONE;
     }
 
-    neighbor_t *findNeighbor(EliminateMergeType eMergeType)
-    {
-        neighbor_t::comp_t comp;
-        switch (eMergeType)
-        {
-            default:
-            case ELIMINATE_MERGE_LARGEST_AREA:
-                comp = neighbor_t::larger;
+    // Starting the largest partitions first keeps a big one from being
+    // left to run on its own at the end.
+    std::stable_sort(vecpsPartitions.begin(), vecpsPartitions.end(), [](const std::unique_ptr<partition_t> &psA, const std::unique_ptr<partition_t> &psB) {
+        return psA->nFeatures > psB->nFeatures;
+    });
 
-            case ELIMINATE_MERGE_SMALLEST_AREA:
-                comp = neighbor_t::smaller;
+    const char *pszThreads = CSLFetchNameValueDef(papszOptions, "NUM_THREADS", "ALL_CPUS");
+    int nJobs = EQUAL(pszThreads, "ALL_CPUS") ? CPLGetNumCPUs() : atoi(pszThreads);
+    nJobs = std::max(1, std::min(nJobs, static_cast<int>(vecpsPartitions.size())));
 
-            case ELIMINATE_MERGE_LONGEST_BOUNDARY:
-                comp = neighbor_t::longer;
-        }
-        return findNeighbor(comp);
-    }
+    std::mutex oDstMutex;
+    std::atomic<size_t> nNextPartition(0);
+    std::atomic<int> nWorkersDone(0);
+    std::atomic<bool> bInterruptReported(false);
+    std::vector<ThreadErrors> aoErrors(nJobs);
+    std::vector<std::thread> vecThreads;
 
-    void addCreatureToMerge(FeatureCreature *poCreature)
+    for (int iWorker = 0; iWorker < nJobs; iWorker++)
     {
-        m_lstpoCreaturesToMerge.push_back(poCreature);
+        vecThreads.emplace_back([&, iWorker]() {
+            ThreadErrors::Scope oErrorScope(aoErrors[iWorker]);
+            while (!bCancelled)
+            {
+                size_t iPartition = nNextPartition++;
+                if (iPartition >= vecpsPartitions.size())
+                {
+                    break;
+                }
+                partition_t *psPartition = vecpsPartitions[iPartition].get();
+
+                CPLStringList aosPartitionOptions(ReportOptionsWithSuffix(papszOptions, psPartition->osSuffix), TRUE);
+                aosPartitionOptions.SetNameValue("NUM_THREADS", "1");
+
+                Eliminator oEliminator(eMergeType, aosPartitionOptions.List(), psStats != nullptr ? &psPartition->sStats : nullptr);
+                for (auto &poFeature : psPartition->apoFeatures)
+                {
+                    oEliminator.add(std::move(poFeature));
+                }
+                psPartition->apoFeatures.clear();
+
+                void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.7, PartitionProgress, psPartition);
+                bool bContinue = oEliminator.plan(std::move(psPartition->setFIDsToEliminate), GDALScaledProgress, pScaledProgress);
+                GDALDestroyScaledProgress(pScaledProgress);
+
+                Eliminator::output_t sOutput;
+                for (size_t i = 0; bContinue && i < oEliminator.outputCount(); i++)
+                {
+                    if (!PartitionProgress(0.7 + 0.3 * i / oEliminator.outputCount(), nullptr, psPartition))
+                    {
+                        bContinue = false;
+                        break;
+                    }
+
+                    oEliminator.output(i, sOutput);
+
+                    OGRErr eWriteErr;
+                    {
+                        StatsCollector::Scope oScope(oEliminator.stats(), ELIMINATE_PHASE_WRITE);
+                        std::lock_guard<std::mutex> oLock(oDstMutex);
+                        eWriteErr = CopyFeature(poDstLayer, sOutput.poFeature, sOutput.poGeometry);
+                    }
+
+                    oEliminator.written(i, eWriteErr);
+                }
+
+                // A partition that fails does not stop the others; only the
+                // user can do that.
+                psPartition->eErr = oEliminator.finish(bContinue);
+                psPartition->dfComplete = 1.0;
+                if (!bContinue)
+                {
+                    bInterruptReported = true;
+                }
+            }
+            nWorkersDone++;
+        });
     }
 
-    std::list<FeatureCreature *> allCreaturesToMerge() const
+    bool bUserCancelled = false;
+    while (nWorkersDone < nJobs)
     {
-        std::list<FeatureCreature *> lstpoAllCreaturesToMerge;
-        for (auto poCreature : m_lstpoCreaturesToMerge)
+        double dfComplete = 0.0;
+        for (const auto &psPartition : vecpsPartitions)
+        {
+            dfComplete += psPartition->dfComplete * psPartition->nFeatures / std::max<GIntBig>(1, nFeaturesRead);
+        }
+        if (!bUserCancelled && !pfnProgress(0.2 + 0.8 * std::min(1.0, dfComplete), nullptr, pProgressData))
         {
-            lstpoAllCreaturesToMerge.push_back(poCreature);
-            std::list<FeatureCreature *> lstpoCreaturesCreatures = poCreature->allCreaturesToMerge();
-            lstpoAllCreaturesToMerge.insert(lstpoAllCreaturesToMerge.end(), lstpoCreaturesCreatures.begin(), lstpoCreaturesCreatures.end());
+            bUserCancelled = true;
+            bCancelled = true;
         }
-        return lstpoAllCreaturesToMerge;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
-};
 
-EliminateOptions *EliminateOptionsNew()
-{
-    EliminateOptions *psOptions = new EliminateOptions;
-    psOptions->pszSrcFilename = nullptr;
-    psOptions->pszSrcLayerName = nullptr;
-    psOptions->pszDstFilename = nullptr;
-    psOptions->pszDstLayerName = nullptr;
-    psOptions->pszFormat = nullptr;
-    psOptions->pszWhere = nullptr;
-    psOptions->eMergeType = ELIMINATE_MERGE_LARGEST_AREA;
-    return psOptions;
-}
+    for (auto &oThread : vecThreads)
+    {
+        oThread.join();
+    }
+    for (auto &oErrors : aoErrors)
+    {
+        oErrors.replay();
+    }
 
-void EliminateOptionsFree(EliminateOptions *psOptions)
-{
-    if (psOptions != nullptr)
+    for (const auto &psPartition : vecpsPartitions)
     {
-        CPLFree(psOptions->pszSrcFilename);
-        CPLFree(psOptions->pszSrcLayerName);
-        CPLFree(psOptions->pszDstFilename);
-        CPLFree(psOptions->pszDstLayerName);
-        CPLFree(psOptions->pszFormat);
-        CPLFree(psOptions->pszWhere);
-        delete psOptions;
+        StatsCollector oPartitionStats(oStats.enabled());
+        oPartitionStats.stats() = psPartition->sStats;
+        oStats.merge(oPartitionStats);
+        for (int iStage = 0; iStage < ELIMINATE_STAGE_COUNT; iStage++)
+        {
+            oStats.stats().adfStageSeconds[iStage] += psPartition->sStats.adfStageSeconds[iStage];
+        }
+        if (psPartition->eErr != OGRERR_NONE)
+        {
+            eErr = psPartition->eErr;
+        }
     }
-}
+    oStats.stats().nThreads = nJobs;
+    oStats.finish(psStats);
 
-// Because zero is a valid FID, we can't trust CPLAtoGIntBig, since it uses
-// atoll, which returns zero for all failures, nor CPLAtoGIntBigEx, since it
-// only checks for overflow, and not whether the source string was parsable.
-//
-static GIntBig CPLAtoFID(const char *pszString)
-{
-    if (pszString == nullptr || *pszString == '\0')
+    if (bUserCancelled)
     {
-        return OGRNullFID;
+        // Unless a partition that was running has already said so.
+        if (!bInterruptReported)
+        {
+            CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+        }
+        return OGRERR_FAILURE;
     }
-    char *pszFailure = nullptr;
-    errno = 0;
-    GIntBig nFID = strtoll(pszString, &pszFailure, 10);
-    if (errno == ERANGE || nFID < 0 || (pszFailure != nullptr && *pszFailure != '\0'))
+
+    if (eErr == OGRERR_NONE)
     {
-        return OGRNullFID;
+        pfnProgress(1.0, nullptr, pProgressData);
     }
-    return nFID;
+
+    return eErr;
 }
 
 OGRErr EliminatePolygonsWithOptions(EliminateOptions *psOptions)
@@ -291,23 +504,101 @@ OGRErr EliminatePolygonsWithOptions(EliminateOptions *psOptions)
 
     OGRErr eErr = OGRERR_FAILURE;
 
+    EliminateStats sStats{};
+    EliminateStats *psStats = psOptions->psStats;
+    if (psStats == nullptr && psOptions->pszStatsFilename != nullptr)
+    {
+        psStats = &sStats;
+    }
+
+    // A cancelled or timed out run still writes its stats.
+    InterruptWatch oWatch(psOptions->pfnProgress, psOptions->pProgressData);
+    GDALProgressFunc pfnProgress = InterruptWatch::Progress;
+    void *pProgressData = &oWatch;
+
+    WriteProfile oProfile;
+    if (!oProfile.load(psOptions->pszWriteProfile, psOptions->pszFormat))
+    {
+        return OGRERR_FAILURE;
+    }
+    oProfile.addDatasetOptions(psOptions->papszDatasetCreationOptions);
+    oProfile.addLayerOptions(psOptions->papszLayerCreationOptions);
+
+    const bool bMultiSource = IsMultiSource(psOptions->pszSrcFilename);
+    if (bMultiSource && psOptions->bAllLayers)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "All layers can only be processed from a single source dataset.");
+        return OGRERR_FAILURE;
+    }
+
+    // A set of files is opened file by file as it is read.
     int nFlags = GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR;
-    GDALDatasetH hSrcDS = GDALOpenEx(psOptions->pszSrcFilename, nFlags, nullptr, nullptr, nullptr);
-    if (hSrcDS != nullptr)
+    GDALDatasetH hSrcDS = bMultiSource ? nullptr : GDALOpenEx(psOptions->pszSrcFilename, nFlags, nullptr, nullptr, nullptr);
+    if (bMultiSource || hSrcDS != nullptr)
     {
-        GDALDatasetH hDstDS = reinterpret_cast<GDALDatasetH>(OGR_Dr_CreateDataSource(hDriver, psOptions->pszDstFilename, nullptr));
+        // Held until the destination is closed, which is when some drivers
+        // do most of their writing.
+        WriteProfile::ConfigScope oConfigScope(oProfile);
+        GDALDatasetH hDstDS = reinterpret_cast<GDALDatasetH>(OGR_Dr_CreateDataSource(hDriver, psOptions->pszDstFilename, const_cast<char **>(oProfile.datasetOptions())));
         if (hDstDS != nullptr)
         {
-            eErr = EliminatePolygons(hSrcDS, psOptions->pszSrcLayerName, hDstDS,  psOptions->pszDstLayerName, psOptions->eMergeType, psOptions->pszWhere);
+            oProfile.begin(hDstDS);
+            if (psOptions->bAllLayers)
+            {
+                // Each layer is staged in memory and copied into the
+                // destination, where the profile's layer options apply.
+                auto fnLayer = [psOptions](GDALDatasetH hLayerSrcDS, const char *pszLayerName, GDALDatasetH hStageDS, EliminateStats *psLayerStats, GDALProgressFunc pfnLayerProgress, void *pLayerProgressData) {
+                    CPLStringList aosLayerOptions(ReportOptionsWithSuffix(psOptions->papszOptions, pszLayerName));
+                    return EliminatePolygonsEx(hLayerSrcDS, pszLayerName, hStageDS, pszLayerName, psOptions->eMergeType, psOptions->pszWhere, aosLayerOptions.List(), nullptr, psLayerStats, pfnLayerProgress, pLayerProgressData);
+                };
+                int nJobs = psOptions->nLayerJobs > 0 ? psOptions->nLayerJobs : CPLGetNumCPUs();
+                bool bClustered = CPLFetchBool(psOptions->papszOptions, "CLUSTERED_OUTPUT", false);
+
+                eErr = RunAllLayers(psOptions->pszSrcFilename, hDstDS, nJobs, bClustered, true, oProfile, fnLayer, psStats, pfnProgress, pProgressData);
+            }
+            else if (bMultiSource)
+            {
+                eErr = EliminatePolygonsMultiSource(psOptions->pszSrcFilename, psOptions->pszSrcLayerName, hDstDS, psOptions->pszDstLayerName, psOptions->eMergeType, psOptions->pszWhere, psOptions->papszOptions, oProfile.layerOptions(), psStats, pfnProgress, pProgressData);
+            }
+            else
+            {
+                eErr = EliminatePolygonsEx(hSrcDS, psOptions->pszSrcLayerName, hDstDS,  psOptions->pszDstLayerName, psOptions->eMergeType, psOptions->pszWhere, psOptions->papszOptions, oProfile.layerOptions(), psStats, pfnProgress, pProgressData);
+            }
+            OGRErr eEndErr = oProfile.end(hDstDS);
+            if (eErr == OGRERR_NONE)
+            {
+                eErr = eEndErr;
+            }
             GDALClose(hDstDS);
         }
-        GDALClose(hSrcDS);
+        if (hSrcDS != nullptr)
+        {
+            GDALClose(hSrcDS);
+        }
+    }
+
+    if (psStats != nullptr)
+    {
+        psStats->bInterrupted = oWatch.interrupted();
+    }
+    if ((eErr == OGRERR_NONE || oWatch.interrupted()) && psOptions->pszStatsFilename != nullptr)
+    {
+        OGRErr eStatsErr = EliminateStatsWriteJSONEx(psStats, psOptions->pszStatsFilename, oProfile.settings().List());
+        if (eErr == OGRERR_NONE)
+        {
+            eErr = eStatsErr;
+        }
     }
 
     return eErr;
 }
 
 OGRErr EliminatePolygons(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, EliminateMergeType eMergeType, const char *pszWhere)
+{
+    return EliminatePolygonsEx(hSrcDS, pszSrcLayerName, hDstDS, pszDstLayerName, eMergeType, pszWhere, nullptr, nullptr, nullptr, nullptr, nullptr);
+}
+
+OGRErr EliminatePolygonsEx(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
 {
     GDALDataset *poSrcDS = GDALDataset::FromHandle(hSrcDS);
     GDALDataset *poDstDS = GDALDataset::FromHandle(hDstDS);
@@ -358,50 +649,51 @@ OGRErr EliminatePolygons(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALD
 
     // TODO: Ownership of layer?
 
-    OGRLayer *poDstLayer = poDstDS->CreateLayer(pszDstLayerName, poSrcLayer->GetSpatialRef(), wkbPolygon);
-
-    for (int iField = 0, nCount = poSrcLayerDefn->GetFieldCount(); iField < nCount; iField++)
+    const bool bClustered = CPLFetchBool(papszOptions, "CLUSTERED_OUTPUT", false);
+    OGRLayer *poDstLayer = CreateDstLayer(poDstDS, pszDstLayerName, poSrcLayerDefn, poSrcLayer->GetSpatialRef(), papszLayerCreationOptions, bClustered);
+    if (poDstLayer == nullptr)
     {
-        OGRFieldDefn *poSrcFieldDefn = poSrcLayerDefn->GetFieldDefn(iField);
-        poDstLayer->CreateField(poSrcFieldDefn);
-    }
-
-    if (poDstLayer->GetLayerDefn()->GetGeomFieldCount() == 0)
-    {
-        for (int iField = 0, nCount = poSrcLayerDefn->GetGeomFieldCount(); iField < nCount; iField++)
-        {
-            OGRGeomFieldDefn *poSrcFieldDefn = poSrcLayerDefn->GetGeomFieldDefn(iField);
-            poDstLayer->CreateGeomField(poSrcFieldDefn);
-        }
+        return OGRERR_FAILURE;
     }
 
     if (pszWhere != nullptr)
     {
-        CPLString osWhere = pszWhere;
+        CPLString osWhere = AdaptWhereClause(poSrcDS, poSrcLayer, pszWhere);
 
-        // There seems to be no way to force it into the OGRSQL dialect,
-        // so kludge the where clause to keep it from blowing up.
-        //
-        CPLString osDriverName = poSrcDS->GetDriverName();
-        if (osDriverName == "SQLite" || osDriverName == "GPKG")
+        // Clustered output is written in Hilbert order, and indexed once
+        // it has all been written.
+        CPLStringList aosOptions(CSLDuplicate(papszOptions), TRUE);
+        if (bClustered)
         {
-            CPLString osGeomColumn = poSrcLayer->GetGeometryColumn();
-            if (!osGeomColumn.empty())
-            {
-                CPLString osAreaExpr = "ST_Area(";
-                osAreaExpr += osGeomColumn;
-                osAreaExpr += ")";
-                osWhere.replaceAll("OGR_GEOM_AREA", osAreaExpr);
-            }
+            aosOptions.SetNameValue("SPATIAL_ORDER", "HILBERT");
         }
 
-        return EliminatePolygonsByQuery(OGRLayer::ToHandle(poSrcLayer), OGRLayer::ToHandle(poDstLayer), eMergeType, osWhere);
+        OGRErr eErr;
+        const char *pszPartitionField = CSLFetchNameValue(papszOptions, "PARTITION_BY");
+        if (pszPartitionField != nullptr)
+        {
+            eErr = EliminatePartitioned(poSrcLayer, poDstLayer, eMergeType, osWhere, pszPartitionField, aosOptions.List(), psStats, pfnProgress, pProgressData);
+        }
+        else
+        {
+            eErr = EliminatePolygonsByQueryEx(OGRLayer::ToHandle(poSrcLayer), OGRLayer::ToHandle(poDstLayer), eMergeType, osWhere, aosOptions.List(), psStats, pfnProgress, pProgressData);
+        }
+        if (eErr == OGRERR_NONE && bClustered)
+        {
+            eErr = BuildDeferredIndex(poDstDS, poDstLayer);
+        }
+        return eErr;
     }
 
     return OGRERR_UNSUPPORTED_OPERATION;
 }
 
 OGRErr EliminatePolygonsByQuery(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, const char *pszWhere)
+{
+    return EliminatePolygonsByQueryEx(hSrcLayer, hDstLayer, eMergeType, pszWhere, nullptr, nullptr, nullptr, nullptr);
+}
+
+OGRErr EliminatePolygonsByQueryEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
 {
     if (pszWhere == nullptr || strlen(pszWhere) == 0)
     {
@@ -411,32 +703,65 @@ OGRErr EliminatePolygonsByQuery(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, Elimin
 
     OGRLayer *poSrcLayer = OGRLayer::FromHandle(hSrcLayer);
 
-    // FIXME: This does not fail with bad WHERE statements.
-    OGRErr eErr = poSrcLayer->SetAttributeFilter(pszWhere);
+    OGRErr eErr = SetWhereFilter(poSrcLayer, pszWhere);
 
     if (eErr != OGRERR_NONE)
     {
         return eErr;
     }
 
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
+    // Selecting the features is a full scan of its own, so it gets a share
+    // of the progress. The count is unknown until it's done.
+    //
+    void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.1, pfnProgress, pProgressData);
+    bool bContinue = true;
+
     std::vector<GIntBig> vecFIDsToEliminate;
     for (auto &poFeature : poSrcLayer)
     {
+        if (!GDALScaledProgress(0.0, nullptr, pScaledProgress))
+        {
+            bContinue = false;
+            break;
+        }
+
         GIntBig nFID = poFeature->GetFID();
         vecFIDsToEliminate.push_back(nFID);
     }
 
+    GDALDestroyScaledProgress(pScaledProgress);
+
     eErr = poSrcLayer->SetAttributeFilter(nullptr);
 
+    if (!bContinue)
+    {
+        CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+        return OGRERR_FAILURE;
+    }
+
     if (eErr != OGRERR_NONE)
     {
         return eErr;
     }
 
-    return EliminatePolygonsByFID(hSrcLayer, hDstLayer, eMergeType, vecFIDsToEliminate.data(), vecFIDsToEliminate.size());
+    pScaledProgress = GDALCreateScaledProgress(0.1, 1.0, pfnProgress, pProgressData);
+    eErr = EliminatePolygonsByFIDEx(hSrcLayer, hDstLayer, eMergeType, vecFIDsToEliminate.data(), vecFIDsToEliminate.size(), papszOptions, psStats, GDALScaledProgress, pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
+
+    return eErr;
 }
 
 OGRErr EliminatePolygonsByFIDStrList(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, char **papszEliminateFIDs)
+{
+    return EliminatePolygonsByFIDStrListEx(hSrcLayer, hDstLayer, eMergeType, papszEliminateFIDs, nullptr, nullptr, nullptr, nullptr);
+}
+
+OGRErr EliminatePolygonsByFIDStrListEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, char **papszEliminateFIDs, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
 {
     std::vector<GIntBig> vecFIDsToEliminate;
     for (int i = 0, n = CSLCount(papszEliminateFIDs); i < n; i++)
@@ -446,10 +771,42 @@ OGRErr EliminatePolygonsByFIDStrList(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, E
         vecFIDsToEliminate.push_back(nFID);
     }
 
-    return EliminatePolygonsByFID(hSrcLayer, hDstLayer, eMergeType, vecFIDsToEliminate.data(), vecFIDsToEliminate.size());
+    return EliminatePolygonsByFIDEx(hSrcLayer, hDstLayer, eMergeType, vecFIDsToEliminate.data(), vecFIDsToEliminate.size(), papszOptions, psStats, pfnProgress, pProgressData);
+}
+
+// Merges and writes every feature that is kept. False if cancelled.
+//
+static bool WriteOutputs(Eliminator &oEliminator, OGRLayer *poDstLayer, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    Eliminator::output_t sOutput;
+    for (size_t i = 0; i < oEliminator.outputCount(); i++)
+    {
+        if (!pfnProgress(static_cast<double>(i) / oEliminator.outputCount(), nullptr, pProgressData))
+        {
+            return false;
+        }
+
+        oEliminator.output(i, sOutput);
+
+        OGRErr eErr;
+        {
+            StatsCollector::Scope oScope(oEliminator.stats(), ELIMINATE_PHASE_WRITE);
+            eErr = CopyFeature(poDstLayer, sOutput.poFeature, sOutput.poGeometry);
+        }
+
+        oEliminator.written(i, eErr);
+    }
+
+    pfnProgress(1.0, nullptr, pProgressData);
+    return true;
 }
 
 OGRErr EliminatePolygonsByFID(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, GIntBig *panEliminateFIDs , int nCount)
+{
+    return EliminatePolygonsByFIDEx(hSrcLayer, hDstLayer, eMergeType, panEliminateFIDs, nCount, nullptr, nullptr, nullptr, nullptr);
+}
+
+OGRErr EliminatePolygonsByFIDEx(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, EliminateMergeType eMergeType, GIntBig *panEliminateFIDs , int nCount, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
 {
     int nMajor, nMinor, nPatch;
     bool bHaveGEOS = OGRGetGEOSVersion(&nMajor, &nMinor, &nPatch);
@@ -473,148 +830,142 @@ OGRErr EliminatePolygonsByFID(OGRLayerH hSrcLayer, OGRLayerH hDstLayer, Eliminat
         }
     }
 
-    GEOSContextHandle_t hGEOSCtxt = OGRGeometry::createGEOSContext();
-    GEOSSTRtree *poSTRTree = GEOSSTRtree_create_r(hGEOSCtxt, 10);
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
+    Eliminator oEliminator(eMergeType, papszOptions, psStats);
 
-    std::list<FeatureCreature> lstFeatures;
-    std::list<FeatureCreature *> lstpoFeaturesToKeep;
-    std::list<FeatureCreature *> lstpoFeaturesToEliminate;
+    // Reading, neighbor discovery and merging/writing get 20%, 50% and 30%
+    // of the progress. Any of them may be cancelled, after which the
+    // destination holds whatever was written so far.
+    //
+    void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.2, pfnProgress, pProgressData);
+    bool bContinue = oEliminator.read(poSrcLayer, GDALScaledProgress, pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
 
-    for(auto &poFeature : poSrcLayer)
+    if (bContinue)
     {
-        lstFeatures.emplace_back(std::move(poFeature), hGEOSCtxt);
-        FeatureCreature &creature = lstFeatures.back();
+        pScaledProgress = GDALCreateScaledProgress(0.2, 0.7, pfnProgress, pProgressData);
+        bContinue = oEliminator.plan(std::move(setFIDsToEliminate), GDALScaledProgress, pScaledProgress);
+        GDALDestroyScaledProgress(pScaledProgress);
+    }
 
-        OGRErr eErr = creature.initGeometry();
-        if (eErr != OGRERR_NONE)
-        {
-            continue;
-        }
+    if (bContinue)
+    {
+        pScaledProgress = GDALCreateScaledProgress(0.7, 1.0, pfnProgress, pProgressData);
+        bContinue = WriteOutputs(oEliminator, poDstLayer, GDALScaledProgress, pScaledProgress);
+        GDALDestroyScaledProgress(pScaledProgress);
+    }
 
-        GIntBig nFID = creature.feature()->GetFID();
-        auto itr = setFIDsToEliminate.find(nFID);
-        if (itr != setFIDsToEliminate.end())
-        {
-            eErr = creature.initPreparedGeometry();
-            if (eErr != OGRERR_NONE)
-            {
-                continue;
-            }
+    return oEliminator.finish(bContinue);
+}
 
-            setFIDsToEliminate.erase(itr);
-            lstpoFeaturesToEliminate.push_back(&creature);
-        }
-        else
-        {
-            lstpoFeaturesToKeep.push_back(&creature);
-        }
+OGRErr EliminatePolygonsMultiSource(const char *pszSource, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    int nMajor, nMinor, nPatch;
+    bool bHaveGEOS = OGRGetGEOSVersion(&nMajor, &nMinor, &nPatch);
 
-        GEOSSTRtree_insert_r(hGEOSCtxt, poSTRTree, creature.geometry(), &creature);
+    if (!bHaveGEOS)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Installed GDAL library does not support GEOS.");
+        return OGRERR_UNSUPPORTED_OPERATION;
     }
 
-    if (!setFIDsToEliminate.empty())
+    if (pszWhere == nullptr || strlen(pszWhere) == 0)
     {
-        CPLError(CE_Warning, CPLE_AppDefined, "%lu selected features not found in source layer!", setFIDsToEliminate.size());
+        CPLError(CE_Failure, CPLE_AppDefined, "Filter must be specified.");
+        return OGRERR_FAILURE;
     }
 
-    for(auto poCreature : lstpoFeaturesToEliminate)
+    if (CSLFetchNameValue(papszOptions, "PARTITION_BY") != nullptr)
     {
-        std::list<FeatureCreature *> lstpoNeighbors;
+        CPLError(CE_Failure, CPLE_NotSupported, "Partitioning is not supported with a set of source files.");
+        return OGRERR_UNSUPPORTED_OPERATION;
+    }
 
-        struct capture_t
-        {
-            FeatureCreature *poCreature;
-            std::list<FeatureCreature *> *plstpoNeighbors;
-        };
-        capture_t capture = {poCreature, &lstpoNeighbors};
-        GEOSQueryCallback callback = [](void *poItem, void *poUserData) {
-            auto poNeighbor = static_cast<FeatureCreature *>(poItem);
-            auto poCapture = static_cast<capture_t *>(poUserData);
-            if (poCapture->poCreature != poNeighbor)
-            {
-                poCapture->plstpoNeighbors->push_back(poNeighbor);
-            }
-        };
+    CPLStringList aosFilenames;
+    if (!ExpandMultiSource(pszSource, aosFilenames))
+    {
+        return OGRERR_FAILURE;
+    }
 
-        GEOSSTRtree_query_r(hGEOSCtxt, poSTRTree, poCreature->geometry(), callback, &capture);
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
 
-        if (lstpoNeighbors.size() == 0)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "No neighbors?");
-            continue;
-        }
+    // Clustered output is written in Hilbert order, and indexed once it has
+    // all been written.
+    const bool bClustered = CPLFetchBool(papszOptions, "CLUSTERED_OUTPUT", false);
+    CPLStringList aosOptions(CSLDuplicate(papszOptions), TRUE);
+    if (bClustered)
+    {
+        aosOptions.SetNameValue("SPATIAL_ORDER", "HILBERT");
+    }
 
-        for (auto poNeighbor : lstpoNeighbors)
-        {
-            poCreature->addNeighborIfTouching(poNeighbor);
-        }
+    Eliminator oEliminator(eMergeType, aosOptions.List(), psStats);
+    std::unordered_set<GIntBig> setFIDsToEliminate;
+    OGRFeatureDefn *poSrcLayerDefn = nullptr;
 
-        FeatureCreature::neighbor_t *poNeighbor = poCreature->findNeighbor(eMergeType);
+    // The files are read in parallel; after that it is one layer, with the
+    // same progress split as EliminatePolygonsByFID.
+    //
+    // NUM_THREADS bounds the readers as it does the partitions.
+    const char *pszThreads = CSLFetchNameValueDef(papszOptions, "NUM_THREADS", "ALL_CPUS");
+    int nReadThreads = EQUAL(pszThreads, "ALL_CPUS") ? CPLGetNumCPUs() : atoi(pszThreads);
+    nReadThreads = std::max(1, std::min(nReadThreads, aosFilenames.Count()));
+    std::vector<GIntBig> anFIDOffsets;
+    void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.2, pfnProgress, pProgressData);
+    bool bContinue = ReadMultiSource(aosFilenames, pszSrcLayerName, pszWhere, nReadThreads, oEliminator, setFIDsToEliminate, &poSrcLayerDefn, anFIDOffsets, GDALScaledProgress, pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
 
-        if (poNeighbor == nullptr)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "No touching neighbors?");
-            continue;
-        }
+    const char *pszFIDOffsetsFilename = CSLFetchNameValue(papszOptions, "FID_OFFSETS_FILE");
+    if (bContinue && pszFIDOffsetsFilename != nullptr && !WriteFIDOffsets(pszFIDOffsetsFilename, aosFilenames, anFIDOffsets))
+    {
+        poSrcLayerDefn->Release();
+        bContinue = false;
+    }
 
-        poNeighbor->addCreatureToMerge(poCreature);
+    if (!bContinue)
+    {
+        // Failures were reported as they happened, so only the reports
+        // asked for remain.
+        oEliminator.finish(true);
+        return OGRERR_FAILURE;
     }
 
-    const bool bUseGEOSGeometries = true;
+    GDALDataset *poDstDS = GDALDataset::FromHandle(hDstDS);
+    if (pszDstLayerName == nullptr)
+    {
+        pszDstLayerName = poSrcLayerDefn->GetName();
+    }
+    const OGRSpatialReference *poSRS = poSrcLayerDefn->GetGeomFieldDefn(0)->GetSpatialRef();
+    OGRLayer *poDstLayer = CreateDstLayer(poDstDS, pszDstLayerName, poSrcLayerDefn, poSRS, papszLayerCreationOptions, bClustered);
+    poSrcLayerDefn->Release();
 
-    for(auto poCreature : lstpoFeaturesToKeep)
+    if (poDstLayer == nullptr)
     {
-        const OGRFeature *poFeature = poCreature->feature();
-        const OGRGeometry *poGeometry = poFeature->GetGeometryRef();
-        std::list<FeatureCreature *> lstpoCreaturesToMerge = poCreature->allCreaturesToMerge();
-        OGRErr eErr;
+        oEliminator.finish(true);
+        return OGRERR_FAILURE;
+    }
 
-        if (lstpoCreaturesToMerge.empty())
-        {
-            eErr = CopyFeature(poDstLayer, poFeature, poGeometry);
-        }
-        else
-        {
-            OGRGeometryUniquePtr poCombinedGeometry;
-            if (bUseGEOSGeometries)
-            {
-                // Clone the geometries because the collection assumes ownership.
-                std::vector<GEOSGeometry *> vecGeometries;
-                vecGeometries.push_back(GEOSGeom_clone_r(hGEOSCtxt, poCreature->geometry()));
-                for (auto poCreatureToMerge : lstpoCreaturesToMerge)
-                {
-                    vecGeometries.push_back(GEOSGeom_clone_r(hGEOSCtxt, poCreatureToMerge->geometry()));
-                }
-                GEOSGeometry *poGEOSGeometryCollection = GEOSGeom_createCollection_r(hGEOSCtxt, GEOS_MULTIPOLYGON, vecGeometries.data(), vecGeometries.size());
-                GEOSGeometry *poGEOSCombinedGeometry = GEOSUnaryUnion_r(hGEOSCtxt, poGEOSGeometryCollection);
-                poCombinedGeometry.reset(OGRGeometryFactory::createFromGEOS(hGEOSCtxt, poGEOSCombinedGeometry));
-                poCombinedGeometry->assignSpatialReference(poGeometry->getSpatialReference());
-                GEOSGeom_destroy_r(hGEOSCtxt, poGEOSCombinedGeometry);
-                GEOSGeom_destroy_r(hGEOSCtxt, poGEOSGeometryCollection);
-            }
-            else
-            {
-                poCombinedGeometry.reset(poGeometry->clone());
-                for (auto poCreatureToMerge : lstpoCreaturesToMerge)
-                {
-                    poCombinedGeometry.reset(poCombinedGeometry->Union(poCreatureToMerge->feature()->GetGeometryRef()));
-                }
-            }
-            eErr = CopyFeature(poDstLayer, poFeature, poCombinedGeometry.get());
-        }
+    pScaledProgress = GDALCreateScaledProgress(0.2, 0.7, pfnProgress, pProgressData);
+    bContinue = oEliminator.plan(std::move(setFIDsToEliminate), GDALScaledProgress, pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
 
-        if (eErr != OGRERR_NONE)
-        {
-            CPLError(CE_Warning, CPLE_AppDefined, "Failed to create feature in destination layer.");
-        }
+    if (bContinue)
+    {
+        pScaledProgress = GDALCreateScaledProgress(0.7, 1.0, pfnProgress, pProgressData);
+        bContinue = WriteOutputs(oEliminator, poDstLayer, GDALScaledProgress, pScaledProgress);
+        GDALDestroyScaledProgress(pScaledProgress);
     }
 
-    // Prior to GEOS 3.9, the tree does not copy the geometry, so it must be
-    // destroyed before the feature nodes, and the context last of all.
-    //
-    GEOSSTRtree_destroy_r(hGEOSCtxt, poSTRTree);
-    lstFeatures.clear();
-    OGRGeometry::freeGEOSContext(hGEOSCtxt);
-
-    return OGRERR_NONE;
+    OGRErr eErr = oEliminator.finish(bContinue);
+    if (eErr == OGRERR_NONE && bClustered)
+    {
+        eErr = BuildDeferredIndex(poDstDS, poDstLayer);
+    }
+    return eErr;
 }
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "cpl_conv.h"
+#include "ogrsf_frmts.h"
+
+#include "eliminate.h"
+#include "eliminator.h"
+
+
+OGRErr EliminateWKB(const GByte *const *papabyWKB, const size_t *panWKBSizes, const GIntBig *panFIDs, const int *pabCandidates, int nCount, EliminateMergeType eMergeType, CSLConstList papszOptions, EliminateStats *psStats, EliminateGroup **ppasGroups, int *pnGroups, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    *ppasGroups = nullptr;
+    *pnGroups = 0;
+
+    int nMajor, nMinor, nPatch;
+    bool bHaveGEOS = OGRGetGEOSVersion(&nMajor, &nMinor, &nPatch);
+
+    if (!bHaveGEOS)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Installed GDAL library does not support GEOS.");
+        return OGRERR_UNSUPPORTED_OPERATION;
+    }
+
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
+    // The features have a geometry and nothing else, so every one of them
+    // can share this definition.
+    //
+    OGRFeatureDefn *poDefn = new OGRFeatureDefn("eliminate");
+    poDefn->Reference();
+    poDefn->SetGeomType(wkbUnknown);
+
+    std::unordered_set<GIntBig> setFIDsToEliminate;
+    bool bContinue = true;
+    OGRErr eErr = OGRERR_NONE;
+
+    {
+        Eliminator oEliminator(eMergeType, papszOptions, psStats);
+
+        // Parsing, neighbor discovery and merging get 20%, 50% and 30% of
+        // the progress, as reading, indexing and writing do for a layer.
+        //
+        void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.2, pfnProgress, pProgressData);
+        for (int i = 0; i < nCount; i++)
+        {
+            if (!GDALScaledProgress(static_cast<double>(i) / nCount, nullptr, pScaledProgress))
+            {
+                bContinue = false;
+                break;
+            }
+
+            OGRFeatureUniquePtr poFeature(new OGRFeature(poDefn));
+            GIntBig nFID = panFIDs != nullptr ? panFIDs[i] : i;
+            poFeature->SetFID(nFID);
+
+            OGRGeometry *poGeometry = nullptr;
+            if (papabyWKB[i] != nullptr &&
+                OGRGeometryFactory::createFromWkb(papabyWKB[i], nullptr, &poGeometry, panWKBSizes[i]) == OGRERR_NONE)
+            {
+                poFeature->SetGeometryDirectly(poGeometry);
+            }
+
+            if (pabCandidates != nullptr && pabCandidates[i])
+            {
+                setFIDsToEliminate.insert(nFID);
+            }
+
+            oEliminator.add(std::move(poFeature));
+        }
+        GDALDestroyScaledProgress(pScaledProgress);
+
+        if (bContinue)
+        {
+            pScaledProgress = GDALCreateScaledProgress(0.2, 0.7, pfnProgress, pProgressData);
+            bContinue = oEliminator.plan(std::move(setFIDsToEliminate), GDALScaledProgress, pScaledProgress);
+            GDALDestroyScaledProgress(pScaledProgress);
+        }
+
+        const size_t nOutputs = bContinue ? oEliminator.outputCount() : 0;
+        EliminateGroup *pasGroups = static_cast<EliminateGroup *>(CPLCalloc(std::max<size_t>(1, nOutputs), sizeof(EliminateGroup)));
+        int nGroups = 0;
+
+        pScaledProgress = GDALCreateScaledProgress(0.7, 1.0, pfnProgress, pProgressData);
+
+        Eliminator::output_t sOutput;
+        for (size_t i = 0; i < nOutputs; i++)
+        {
+            if (!GDALScaledProgress(static_cast<double>(i) / nOutputs, nullptr, pScaledProgress))
+            {
+                bContinue = false;
+                break;
+            }
+
+            oEliminator.output(i, sOutput);
+
+            EliminateGroup &sGroup = pasGroups[nGroups++];
+            sGroup.nFID = sOutput.poFeature->GetFID();
+
+            OGRErr eWKBErr = OGRERR_NONE;
+            if (sOutput.poMergedGeometry != nullptr)
+            {
+                sGroup.nMerged = static_cast<int>(sOutput.lstpoMerged.size());
+                sGroup.panMergedFIDs = static_cast<GIntBig *>(CPLMalloc(sGroup.nMerged * sizeof(GIntBig)));
+                int iMerged = 0;
+                for (auto poMerged : sOutput.lstpoMerged)
+                {
+                    sGroup.panMergedFIDs[iMerged++] = poMerged->feature()->GetFID();
+                }
+
+                StatsCollector::Scope oScope(oEliminator.stats(), ELIMINATE_PHASE_WRITE);
+                sGroup.nWKBSize = sOutput.poMergedGeometry->WkbSize();
+                sGroup.pabyWKB = static_cast<GByte *>(CPLMalloc(sGroup.nWKBSize));
+                eWKBErr = sOutput.poMergedGeometry->exportToWkb(wkbNDR, sGroup.pabyWKB, wkbVariantIso);
+            }
+
+            oEliminator.written(i, eWKBErr);
+        }
+
+        if (bContinue)
+        {
+            GDALScaledProgress(1.0, nullptr, pScaledProgress);
+        }
+        GDALDestroyScaledProgress(pScaledProgress);
+
+        eErr = oEliminator.finish(bContinue);
+
+        if (eErr == OGRERR_NONE)
+        {
+            *ppasGroups = pasGroups;
+            *pnGroups = nGroups;
+        }
+        else
+        {
+            EliminateGroupsFree(pasGroups, nGroups);
+        }
+    }
+
+    poDefn->Release();
+
+    return eErr;
+}
+
+void EliminateGroupsFree(EliminateGroup *pasGroups, int nGroups)
+{
+    if (pasGroups != nullptr)
+    {
+        for (int i = 0; i < nGroups; i++)
+        {
+            CPLFree(pasGroups[i].panMergedFIDs);
+            CPLFree(pasGroups[i].pabyWKB);
+        }
+        CPLFree(pasGroups);
+    }
+}
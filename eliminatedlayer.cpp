@@ -0,0 +1,251 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <unordered_set>
+
+#include "eliminatedlayer.h"
+#include "eliminator.h"
+#include "sources.h"
+
+
+EliminatedLayer::EliminatedLayer(std::unique_ptr<Eliminator> poEliminator, OGRFeatureDefn *poFeatureDefn) :
+    m_poEliminator(std::move(poEliminator)),
+    m_poFeatureDefn(poFeatureDefn),
+    m_iNextOutput(0),
+    m_abProduced(m_poEliminator->outputCount(), false),
+    m_bFinished(false)
+{
+    m_poFeatureDefn->Reference();
+    SetDescription(m_poFeatureDefn->GetName());
+}
+
+EliminatedLayer::~EliminatedLayer()
+{
+    Finish();
+    m_poEliminator.reset();
+    m_poFeatureDefn->Release();
+}
+
+EliminatedLayer *EliminatedLayer::Create(GDALDataset *poSrcDS, OGRLayer *poSrcLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    int nMajor, nMinor, nPatch;
+    bool bHaveGEOS = OGRGetGEOSVersion(&nMajor, &nMinor, &nPatch);
+
+    if (!bHaveGEOS)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Installed GDAL library does not support GEOS.");
+        return nullptr;
+    }
+
+    if (pszWhere == nullptr || strlen(pszWhere) == 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Filter must be specified.");
+        return nullptr;
+    }
+
+    if (poSrcLayer->GetLayerDefn()->GetGeomFieldCount() != 1)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Source layer must have exactly one geometry column.");
+        return nullptr;
+    }
+
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
+    CPLString osWhere = poSrcDS != nullptr ? AdaptWhereClause(poSrcDS, poSrcLayer, pszWhere) : CPLString(pszWhere);
+    if (SetWhereFilter(poSrcLayer, osWhere) != OGRERR_NONE)
+    {
+        return nullptr;
+    }
+
+    // Selecting, reading and planning get 10%, 30% and 60% of the
+    // progress; the merging is done later, as the layer is read.
+    //
+    void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.1, pfnProgress, pProgressData);
+    bool bContinue = true;
+
+    std::unordered_set<GIntBig> setFIDsToEliminate;
+    for (auto &poFeature : poSrcLayer)
+    {
+        if (!GDALScaledProgress(0.0, nullptr, pScaledProgress))
+        {
+            bContinue = false;
+            break;
+        }
+        if (poFeature->GetFID() >= 0)
+        {
+            setFIDsToEliminate.insert(poFeature->GetFID());
+        }
+    }
+
+    GDALDestroyScaledProgress(pScaledProgress);
+
+    if (poSrcLayer->SetAttributeFilter(nullptr) != OGRERR_NONE)
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<Eliminator> poEliminator(new Eliminator(eMergeType, papszOptions, psStats));
+
+    if (bContinue)
+    {
+        pScaledProgress = GDALCreateScaledProgress(0.1, 0.4, pfnProgress, pProgressData);
+        bContinue = poEliminator->read(poSrcLayer, GDALScaledProgress, pScaledProgress);
+        GDALDestroyScaledProgress(pScaledProgress);
+    }
+
+    if (bContinue)
+    {
+        pScaledProgress = GDALCreateScaledProgress(0.4, 1.0, pfnProgress, pProgressData);
+        bContinue = poEliminator->plan(std::move(setFIDsToEliminate), GDALScaledProgress, pScaledProgress);
+        GDALDestroyScaledProgress(pScaledProgress);
+    }
+
+    if (!bContinue)
+    {
+        poEliminator->finish(false);
+        return nullptr;
+    }
+
+    pfnProgress(1.0, nullptr, pProgressData);
+
+    OGRFeatureDefn *poFeatureDefn = poSrcLayer->GetLayerDefn()->Clone();
+    return new EliminatedLayer(std::move(poEliminator), poFeatureDefn);
+}
+
+OGRErr EliminatedLayer::Finish()
+{
+    if (m_bFinished)
+    {
+        return OGRERR_NONE;
+    }
+    m_bFinished = true;
+    return m_poEliminator->finish(true);
+}
+
+void EliminatedLayer::ResetReading()
+{
+    m_iNextOutput = 0;
+}
+
+OGRFeature *EliminatedLayer::GetNextFeature()
+{
+    Eliminator::output_t sOutput;
+
+    while (m_iNextOutput < m_poEliminator->outputCount())
+    {
+        size_t i = m_iNextOutput++;
+
+        const bool bFirst = !m_abProduced[i] && !m_bFinished;
+        if (bFirst)
+        {
+            m_poEliminator->output(i, sOutput);
+        }
+        else
+        {
+            m_poEliminator->outputAgain(i, sOutput);
+        }
+
+        OGRFeatureUniquePtr poFeature(new OGRFeature(m_poFeatureDefn));
+        poFeature->SetFrom(sOutput.poFeature);
+        poFeature->SetFID(sOutput.poFeature->GetFID());
+        poFeature->SetGeometry(sOutput.poGeometry);
+
+        if (bFirst)
+        {
+            m_poEliminator->written(i, OGRERR_NONE);
+            m_abProduced[i] = true;
+        }
+
+        if ((m_poFilterGeom == nullptr || FilterGeometry(poFeature->GetGeometryRef())) &&
+            (m_poAttrQuery == nullptr || m_poAttrQuery->Evaluate(poFeature.get())))
+        {
+            return poFeature.release();
+        }
+    }
+
+    return nullptr;
+}
+
+OGRErr EliminatedLayer::SetNextByIndex(GIntBig nIndex)
+{
+    if (m_poFilterGeom != nullptr || m_poAttrQuery != nullptr)
+    {
+        return OGRLayer::SetNextByIndex(nIndex);
+    }
+
+    if (nIndex < 0 || static_cast<size_t>(nIndex) >= m_poEliminator->outputCount())
+    {
+        m_iNextOutput = m_poEliminator->outputCount();
+        return OGRERR_NON_EXISTING_FEATURE;
+    }
+
+    m_iNextOutput = static_cast<size_t>(nIndex);
+    return OGRERR_NONE;
+}
+
+GIntBig EliminatedLayer::GetFeatureCount(int bForce)
+{
+    if (m_poFilterGeom != nullptr || m_poAttrQuery != nullptr)
+    {
+        return OGRLayer::GetFeatureCount(bForce);
+    }
+
+    return static_cast<GIntBig>(m_poEliminator->outputCount());
+}
+
+OGRFeatureDefn *EliminatedLayer::GetLayerDefn()
+{
+    return m_poFeatureDefn;
+}
+
+int EliminatedLayer::TestCapability(const char *pszCap)
+{
+    if (EQUAL(pszCap, OLCFastFeatureCount))
+    {
+        return m_poFilterGeom == nullptr && m_poAttrQuery == nullptr;
+    }
+    if (EQUAL(pszCap, OLCFastSetNextByIndex))
+    {
+        return m_poFilterGeom == nullptr && m_poAttrQuery == nullptr;
+    }
+    return FALSE;
+}
+
+OGRLayerH EliminatedLayerCreate(GDALDatasetH hSrcDS, OGRLayerH hSrcLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    return OGRLayer::ToHandle(EliminatedLayer::Create(GDALDataset::FromHandle(hSrcDS), OGRLayer::FromHandle(hSrcLayer), eMergeType, pszWhere, papszOptions, psStats, pfnProgress, pProgressData));
+}
+
+OGRErr EliminatedLayerFinish(OGRLayerH hLayer)
+{
+    return static_cast<EliminatedLayer *>(OGRLayer::FromHandle(hLayer))->Finish();
+}
+
+void EliminatedLayerDestroy(OGRLayerH hLayer)
+{
+    delete OGRLayer::FromHandle(hLayer);
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+
+#ifndef ELIMINATEDLAYER_H_INCLUDED
+#define ELIMINATEDLAYER_H_INCLUDED
+
+#include <memory>
+#include <vector>
+
+#include "ogrsf_frmts.h"
+
+#include "eliminate.h"
+
+class Eliminator;
+
+// A read-only layer of the features of a source layer that are kept by an
+// elimination, each merged with whatever was merged into it. The source is
+// read and the merge plan made when the layer is created, after which the
+// source is no longer needed; the unions are done one feature at a time as
+// they are read, so nothing is written anywhere.
+//
+// Attribute and spatial filters apply to the merged features. Reading
+// again, after ResetReading() or to count filtered features, repeats the
+// unions but counts each feature once in the stats and reports. Those are
+// completed by Finish(), or when the layer is destroyed if it was not
+// called.
+//
+class EliminatedLayer final : public OGRLayer
+{
+public:
+    // Null on failure, with the error reported. The features matching
+    // pszWhere in poSrcLayer are the candidates for elimination. poSrcDS,
+    // if not null, is the dataset the layer belongs to, whose driver's
+    // dialect the clause is adapted to as EliminatePolygonsEx() does; if
+    // null, the clause must already be in that dialect.
+    static EliminatedLayer *Create(GDALDataset *poSrcDS, OGRLayer *poSrcLayer, EliminateMergeType eMergeType, const char *pszWhere, CSLConstList papszOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
+
+    ~EliminatedLayer() override;
+
+    // Writes the reports asked for in the options and completes the stats.
+    // Fails if verification found discrepancies or a report can't be
+    // written. The layer can still be read afterwards, but nothing more is
+    // counted.
+    OGRErr Finish();
+
+    void ResetReading() override;
+    OGRFeature *GetNextFeature() override;
+    OGRErr SetNextByIndex(GIntBig nIndex) override;
+    GIntBig GetFeatureCount(int bForce = TRUE) override;
+    OGRFeatureDefn *GetLayerDefn() override;
+    int TestCapability(const char *pszCap) override;
+
+private:
+    std::unique_ptr<Eliminator> m_poEliminator;
+    OGRFeatureDefn *m_poFeatureDefn;
+    size_t m_iNextOutput;
+    // Which outputs have been produced at least once, and so are already
+    // counted in the stats.
+    std::vector<bool> m_abProduced;
+    bool m_bFinished;
+
+    EliminatedLayer(std::unique_ptr<Eliminator> poEliminator, OGRFeatureDefn *poFeatureDefn);
+};
+
+#endif // ELIMINATEDLAYER_H_INCLUDED
@@ -0,0 +1,679 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gdal.h"
+
+#include "eliminator.h"
+#include "hilbert.h"
+#include "threaderrors.h"
+
+
+// How many candidates a thread takes at a time.
+static constexpr size_t CANDIDATE_CHUNK = 32;
+
+// NUM_THREADS is a count or ALL_CPUS, as for GDAL_NUM_THREADS.
+//
+static int GetNumThreads(CSLConstList papszOptions)
+{
+    const char *pszThreads = CSLFetchNameValueDef(papszOptions, "NUM_THREADS", "1");
+    int nThreads = EQUAL(pszThreads, "ALL_CPUS") ? CPLGetNumCPUs() : atoi(pszThreads);
+    return std::max(1, nThreads);
+}
+
+// Finds the neighbor a feature should be merged into, or null if it has
+// none. Safe to call from several threads at once, each with its own GEOS
+// context, stats and log, once every area has been cached.
+//
+static FeatureCreature *ChooseMergeTarget(FeatureCreature *poCreature, GEOSSTRtree *poSTRTree, EliminateMergeType eMergeType,
+                                          GEOSContextHandle_t hGEOSCtxt, Diagnostics &oDiagnostics, StatsCollector &oStats,
+                                          SlowFeatureLog &oSlowLog, ReproCapture &oRepro)
+{
+    Tracer::Scope oTraceScope(oStats.trace(), "candidate");
+
+    std::chrono::steady_clock::time_point tStart;
+    if (oSlowLog.enabled())
+    {
+        tStart = std::chrono::steady_clock::now();
+    }
+
+    std::list<FeatureCreature *> lstpoNeighbors;
+
+    FeatureCreature::query_t query = {poCreature, &lstpoNeighbors};
+
+    oStats.add(&EliminateStats::nCandidates);
+
+    {
+        StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_QUERY);
+        GEOSSTRtree_query_r(hGEOSCtxt, poSTRTree, poCreature->geometry(), FeatureCreature::query_t::callback, &query);
+    }
+
+    oStats.add(&EliminateStats::nIndexHits, lstpoNeighbors.size());
+
+    if (lstpoNeighbors.size() == 0)
+    {
+        oDiagnostics.record(Diagnostics::NO_NEIGHBORS, poCreature->feature()->GetFID());
+        return nullptr;
+    }
+
+    for (auto poNeighbor : lstpoNeighbors)
+    {
+        poCreature->addNeighborIfTouching(poNeighbor, hGEOSCtxt, oStats, oRepro);
+    }
+
+    if (oSlowLog.enabled())
+    {
+        std::chrono::duration<double> dfElapsed = std::chrono::steady_clock::now() - tStart;
+        oSlowLog.record(SlowFeatureLog::NEIGHBORS, poCreature->feature()->GetFID(),
+                        GEOSGetNumCoordinates_r(hGEOSCtxt, poCreature->geometry()),
+                        poCreature->neighborCount(), dfElapsed.count());
+    }
+
+    oStats.addMemory(ELIMINATE_MEMORY_NEIGHBORS, poCreature->neighborCount() * (sizeof(FeatureCreature::neighbor_t) + LIST_NODE_BYTES));
+
+    FeatureCreature::neighbor_t *poNeighbor = poCreature->findNeighbor(eMergeType);
+
+    if (poNeighbor == nullptr)
+    {
+        oDiagnostics.record(Diagnostics::NO_TOUCHING_NEIGHBORS, poCreature->feature()->GetFID());
+        return nullptr;
+    }
+
+    return poNeighbor->poCreature;
+}
+
+Eliminator::Eliminator(EliminateMergeType eMergeType, CSLConstList papszOptions, EliminateStats *psStats) :
+    m_eMergeType(eMergeType),
+    m_aosOptions(CSLDuplicate(papszOptions), TRUE),
+    m_psStats(psStats),
+    m_oStats(psStats != nullptr),
+    m_oCounters(psStats != nullptr && CPLFetchBool(papszOptions, "PERF_COUNTERS", false)),
+    m_nSlowFeatures(CSLFetchNameValue(papszOptions, "SLOW_FEATURES_FILE") != nullptr
+                    ? std::max(0, atoi(CSLFetchNameValueDef(papszOptions, "SLOW_FEATURES_COUNT", CPLSPrintf("%d", SlowFeatureLog::DEFAULT_MAX_ENTRIES))))
+                    : 0),
+    m_oSlowLog(m_nSlowFeatures),
+    m_oRepro(CSLFetchNameValue(papszOptions, "REPRO_DIR"),
+             CPLAtofM(CSLFetchNameValueDef(papszOptions, "REPRO_THRESHOLD", CPLSPrintf("%g", ReproCapture::DEFAULT_THRESHOLD))),
+             atoi(CSLFetchNameValueDef(papszOptions, "REPRO_MAX", CPLSPrintf("%d", ReproCapture::DEFAULT_MAX_CAPTURES)))),
+    m_bUseGEOSGeometries(!EQUAL(CSLFetchNameValueDef(papszOptions, "UNION_METHOD", "GEOS"), "OGR")),
+    m_hGEOSCtxt(OGRGeometry::createGEOSContext()),
+    m_poSTRTree(nullptr),
+    m_iGroup(0),
+    m_nStagesEnded(0)
+{
+    if (CSLFetchNameValue(papszOptions, "TRACE_FILE") != nullptr)
+    {
+        m_poTracer.reset(new Tracer());
+        m_oStats.setTrace(m_poTracer->createBuffer("main"));
+    }
+
+    int nNodeCapacity = std::max(2, atoi(CSLFetchNameValueDef(papszOptions, "INDEX_NODE_CAPACITY", "10")));
+    m_poSTRTree = GEOSSTRtree_create_r(m_hGEOSCtxt, nNodeCapacity);
+
+    m_oCounters.start();
+}
+
+Eliminator::~Eliminator()
+{
+    // Prior to GEOS 3.9, the tree does not copy the geometry, so it must be
+    // destroyed before the feature nodes, and the context last of all.
+    //
+    GEOSSTRtree_destroy_r(m_hGEOSCtxt, m_poSTRTree);
+    m_lstFeatures.clear();
+    m_poVerifier.reset();
+    OGRGeometry::freeGEOSContext(m_hGEOSCtxt);
+}
+
+void Eliminator::endStage(EliminateStage eStage)
+{
+    m_oCounters.stop(m_oStats.stats().asCounters[eStage]);
+    m_oStats.endStage(eStage);
+    m_nStagesEnded = eStage + 1;
+    if (m_nStagesEnded < ELIMINATE_STAGE_COUNT)
+    {
+        m_oCounters.start();
+    }
+}
+
+bool Eliminator::read(OGRLayer *poSrcLayer, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    GIntBig nFeatureCount = poSrcLayer->GetFeatureCount(FALSE);
+    GIntBig nFeaturesRead = 0;
+
+    poSrcLayer->ResetReading();
+
+    while (true)
+    {
+        double dfComplete = nFeatureCount > 0 ? std::min(1.0, static_cast<double>(nFeaturesRead) / nFeatureCount) : 0.0;
+        if (!pfnProgress(dfComplete, nullptr, pProgressData))
+        {
+            return false;
+        }
+
+        OGRFeatureUniquePtr poFeature;
+        {
+            StatsCollector::Scope oScope(m_oStats, ELIMINATE_PHASE_READ);
+            poFeature.reset(poSrcLayer->GetNextFeature());
+        }
+
+        if (poFeature == nullptr)
+        {
+            break;
+        }
+
+        nFeaturesRead++;
+        add(std::move(poFeature));
+    }
+
+    return true;
+}
+
+void Eliminator::add(OGRFeatureUniquePtr poFeature)
+{
+    m_oStats.add(&EliminateStats::nFeaturesRead);
+
+    m_lstFeatures.emplace_back(std::move(poFeature), m_hGEOSCtxt, &m_oDiagnostics);
+
+    if (m_oStats.enabled())
+    {
+        m_oStats.addMemory(ELIMINATE_MEMORY_FEATURES, m_lstFeatures.back().featureBytes());
+    }
+}
+
+// GEOS geometries are allocated in the order they are exported, and the
+// candidates are searched and the output written in the order they are
+// listed, so visiting the features along a Hilbert curve keeps features
+// that are near each other close in all three.
+//
+std::vector<FeatureCreature *> Eliminator::order()
+{
+    std::vector<FeatureCreature *> vecpoOrder;
+    vecpoOrder.reserve(m_lstFeatures.size());
+    for (auto &creature : m_lstFeatures)
+    {
+        vecpoOrder.push_back(&creature);
+    }
+
+    if (!EQUAL(m_aosOptions.FetchNameValueDef("SPATIAL_ORDER", "SOURCE"), "HILBERT"))
+    {
+        return vecpoOrder;
+    }
+
+    Tracer::Scope oTraceScope(m_oStats.trace(), "hilbert order");
+
+    OGREnvelope sExtent;
+    for (auto poCreature : vecpoOrder)
+    {
+        const OGRGeometry *poGeom = poCreature->feature()->GetGeometryRef();
+        if (poGeom != nullptr && !poGeom->IsEmpty())
+        {
+            OGREnvelope sEnvelope;
+            poGeom->getEnvelope(&sEnvelope);
+            sExtent.Merge(sEnvelope);
+        }
+    }
+
+    HilbertCurve oCurve(sExtent);
+    std::vector<GUInt32> anCodes;
+    anCodes.reserve(vecpoOrder.size());
+    for (auto poCreature : vecpoOrder)
+    {
+        anCodes.push_back(oCurve.code(poCreature->feature()->GetGeometryRef()));
+    }
+
+    std::vector<FeatureCreature *> vecpoSorted;
+    vecpoSorted.reserve(vecpoOrder.size());
+    for (size_t i : HilbertCurve::order(anCodes))
+    {
+        vecpoSorted.push_back(vecpoOrder[i]);
+    }
+    return vecpoSorted;
+}
+
+// Exports, prepares and indexes the features, and sorts them into those to
+// keep and the candidates.
+//
+bool Eliminator::build(const std::vector<FeatureCreature *> &vecpoOrder, std::unordered_set<GIntBig> &setFIDsToEliminate, void *pScaledProgress)
+{
+    for (size_t iCreature = 0; iCreature < vecpoOrder.size(); iCreature++)
+    {
+        if (!GDALScaledProgress(static_cast<double>(iCreature) / vecpoOrder.size(), nullptr, pScaledProgress))
+        {
+            return false;
+        }
+
+        FeatureCreature &creature = *vecpoOrder[iCreature];
+
+        OGRErr eErr;
+        {
+            StatsCollector::Scope oScope(m_oStats, ELIMINATE_PHASE_GEOS_EXPORT);
+            eErr = creature.initGeometry();
+        }
+        if (eErr != OGRERR_NONE)
+        {
+            continue;
+        }
+
+        if (m_oStats.enabled())
+        {
+            m_oStats.addMemory(ELIMINATE_MEMORY_GEOS_GEOMETRIES, creature.geometryBytes());
+        }
+
+        GIntBig nFID = creature.feature()->GetFID();
+        auto itr = setFIDsToEliminate.find(nFID);
+        if (itr != setFIDsToEliminate.end())
+        {
+            {
+                StatsCollector::Scope oScope(m_oStats, ELIMINATE_PHASE_PREPARE);
+                eErr = creature.initPreparedGeometry();
+            }
+            if (eErr != OGRERR_NONE)
+            {
+                continue;
+            }
+
+            if (m_oStats.enabled())
+            {
+                m_oStats.addMemory(ELIMINATE_MEMORY_PREPARED_GEOMETRIES, creature.preparedGeometryBytes());
+            }
+
+            setFIDsToEliminate.erase(itr);
+            m_vecpoCandidates.push_back(&creature);
+        }
+        else
+        {
+            m_vecpoKeep.push_back(&creature);
+        }
+
+        m_oStats.addMemory(ELIMINATE_MEMORY_FEATURES, LIST_NODE_BYTES + sizeof(FeatureCreature *));
+        m_oStats.addMemory(ELIMINATE_MEMORY_INDEX, STRTREE_ITEM_BYTES);
+
+        StatsCollector::Scope oScope(m_oStats, ELIMINATE_PHASE_INDEX);
+        GEOSSTRtree_insert_r(m_hGEOSCtxt, m_poSTRTree, creature.geometry(), &creature);
+    }
+
+    // The tree is built lazily by its first query. Do that here with an
+    // empty geometry so the cost is charged to the index.
+    //
+    {
+        StatsCollector::Scope oScope(m_oStats, ELIMINATE_PHASE_INDEX);
+        GEOSGeometry *poEmpty = GEOSGeom_createEmptyCollection_r(m_hGEOSCtxt, GEOS_GEOMETRYCOLLECTION);
+        GEOSSTRtree_query_r(m_hGEOSCtxt, m_poSTRTree, poEmpty, [](void *, void *) {}, nullptr);
+        GEOSGeom_destroy_r(m_hGEOSCtxt, poEmpty);
+    }
+
+    for (GIntBig nFID : setFIDsToEliminate)
+    {
+        m_oDiagnostics.record(Diagnostics::FID_NOT_FOUND, nFID);
+    }
+
+    return true;
+}
+
+// Neighbor discovery is the only stage run in parallel. Each thread has its
+// own GEOS context, stats and slow feature log, and the chosen targets are
+// only merged afterwards, in input order, so the output is the same for any
+// number of threads. Only this thread reports progress.
+//
+bool Eliminator::findTargets(void *pScaledProgress)
+{
+    m_vecpoTargets.assign(m_vecpoCandidates.size(), nullptr);
+    int nThreads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(GetNumThreads(m_aosOptions.List()), m_vecpoCandidates.size())));
+
+    if (nThreads > 1)
+    {
+        // Areas are cached on first use, so work them all out now rather
+        // than race on them.
+        for (auto &oCreature : m_lstFeatures)
+        {
+            if (oCreature.geometry() != nullptr)
+            {
+                oCreature.area();
+            }
+        }
+    }
+
+    std::atomic<size_t> nNextCandidate(0);
+    std::atomic<size_t> nCandidatesDone(0);
+    std::atomic<bool> bCancelled(false);
+
+    auto findTargets = [&](GEOSContextHandle_t hThreadGEOSCtxt, StatsCollector &oThreadStats, SlowFeatureLog &oThreadSlowLog, bool bReportProgress) {
+        while (!bCancelled.load(std::memory_order_relaxed))
+        {
+            if (bReportProgress && !GDALScaledProgress(static_cast<double>(nCandidatesDone.load(std::memory_order_relaxed)) / m_vecpoCandidates.size(), nullptr, pScaledProgress))
+            {
+                bCancelled = true;
+                break;
+            }
+            // Runs of consecutive candidates are near each other when they
+            // are in Hilbert order, so each thread stays in one area.
+            size_t iFirst = nNextCandidate.fetch_add(CANDIDATE_CHUNK, std::memory_order_relaxed);
+            if (iFirst >= m_vecpoCandidates.size())
+            {
+                break;
+            }
+            size_t iLast = std::min(m_vecpoCandidates.size(), iFirst + CANDIDATE_CHUNK);
+            for (size_t iCandidate = iFirst; iCandidate < iLast; iCandidate++)
+            {
+                m_vecpoTargets[iCandidate] = ChooseMergeTarget(m_vecpoCandidates[iCandidate], m_poSTRTree, m_eMergeType, hThreadGEOSCtxt,
+                                                               m_oDiagnostics, oThreadStats, oThreadSlowLog, m_oRepro);
+            }
+            nCandidatesDone.fetch_add(iLast - iFirst, std::memory_order_relaxed);
+        }
+    };
+
+    struct worker_t
+    {
+        GEOSContextHandle_t hGEOSCtxt;
+        StatsCollector oStats;
+        SlowFeatureLog oSlowLog;
+        ThreadErrors oErrors;
+
+        worker_t(bool bStats, size_t nSlowFeatures) :
+            hGEOSCtxt(OGRGeometry::createGEOSContext()), oStats(bStats), oSlowLog(nSlowFeatures)
+        {
+        }
+
+        ~worker_t()
+        {
+            OGRGeometry::freeGEOSContext(hGEOSCtxt);
+        }
+    };
+
+    std::vector<std::unique_ptr<worker_t>> vecWorkers;
+    std::vector<std::thread> vecThreads;
+    for (int i = 1; i < nThreads; i++)
+    {
+        vecWorkers.emplace_back(new worker_t(m_oStats.enabled(), m_nSlowFeatures));
+        worker_t *poWorker = vecWorkers.back().get();
+        if (m_poTracer)
+        {
+            poWorker->oStats.setTrace(m_poTracer->createBuffer(CPLSPrintf("worker %d", i)));
+        }
+        vecThreads.emplace_back([&findTargets, poWorker]() {
+            ThreadErrors::Scope oErrorScope(poWorker->oErrors);
+            findTargets(poWorker->hGEOSCtxt, poWorker->oStats, poWorker->oSlowLog, false);
+        });
+    }
+
+    findTargets(m_hGEOSCtxt, m_oStats, m_oSlowLog, true);
+
+    for (auto &oThread : vecThreads)
+    {
+        oThread.join();
+    }
+    for (auto &poWorker : vecWorkers)
+    {
+        m_oStats.merge(poWorker->oStats);
+        m_oSlowLog.merge(poWorker->oSlowLog);
+        poWorker->oErrors.replay();
+    }
+
+    m_oStats.stats().nThreads = nThreads;
+
+    if (bCancelled)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_vecpoCandidates.size(); i++)
+    {
+        if (m_vecpoTargets[i] != nullptr)
+        {
+            m_vecpoTargets[i]->addCreatureToMerge(m_vecpoCandidates[i]);
+            m_oStats.addMemory(ELIMINATE_MEMORY_NEIGHBORS, sizeof(FeatureCreature *) + LIST_NODE_BYTES);
+        }
+    }
+
+    return true;
+}
+
+bool Eliminator::plan(std::unordered_set<GIntBig> setFIDsToEliminate, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    // Building gets 40% of the progress, the neighbor search the rest.
+    void *pScaledProgress = GDALCreateScaledProgress(0.0, 0.4, pfnProgress, pProgressData);
+    bool bContinue = build(order(), setFIDsToEliminate, pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
+
+    endStage(ELIMINATE_STAGE_READ);
+
+    if (!bContinue)
+    {
+        return false;
+    }
+
+    pScaledProgress = GDALCreateScaledProgress(0.4, 1.0, pfnProgress, pProgressData);
+    bContinue = findTargets(pScaledProgress);
+    GDALDestroyScaledProgress(pScaledProgress);
+
+    endStage(ELIMINATE_STAGE_NEIGHBORS);
+
+    if (!bContinue)
+    {
+        return false;
+    }
+
+    // Verification is charged to the write stage, so timings from a
+    // verifying run are not comparable with other runs.
+    //
+    if (m_aosOptions.FetchBool("VERIFY", false))
+    {
+        double dfTolerance = CPLAtofM(m_aosOptions.FetchNameValueDef("VERIFY_TOLERANCE", CPLSPrintf("%g", Verifier::DEFAULT_TOLERANCE)));
+        int nSample = std::max(0, atoi(m_aosOptions.FetchNameValueDef("VERIFY_SAMPLE", "0")));
+        size_t nGroups = std::count_if(m_vecpoKeep.begin(), m_vecpoKeep.end(), [](const FeatureCreature *poCreature) {
+            return poCreature->hasCreaturesToMerge();
+        });
+        m_poVerifier.reset(new Verifier(m_hGEOSCtxt, dfTolerance, nSample, m_vecpoCandidates.size(), nGroups));
+
+        for (size_t i = 0; i < m_vecpoCandidates.size(); i++)
+        {
+            if (m_poVerifier->candidateSampled(i))
+            {
+                m_poVerifier->verifyNeighbors(m_vecpoCandidates[i], m_poSTRTree, m_eMergeType, m_vecpoTargets[i]);
+            }
+        }
+    }
+
+    return true;
+}
+
+void Eliminator::compute(size_t i, output_t &sOutput, StatsCollector &oStats, ReproCapture &oRepro)
+{
+    FeatureCreature *poCreature = m_vecpoKeep[i];
+
+    sOutput.poFeature = poCreature->feature();
+    sOutput.poGeometry = sOutput.poFeature->GetGeometryRef();
+    sOutput.poMergedGeometry.reset();
+    sOutput.lstpoMerged = poCreature->allCreaturesToMerge();
+
+    if (sOutput.lstpoMerged.empty())
+    {
+        return;
+    }
+
+    if (m_bUseGEOSGeometries)
+    {
+        GEOSGeometry *poGEOSCombinedGeometry = poCreature->unionWith(sOutput.lstpoMerged, oStats, oRepro);
+        if (poGEOSCombinedGeometry != nullptr)
+        {
+            {
+                StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_GEOS_IMPORT);
+                sOutput.poMergedGeometry.reset(OGRGeometryFactory::createFromGEOS(m_hGEOSCtxt, poGEOSCombinedGeometry));
+            }
+            GEOSGeom_destroy_r(m_hGEOSCtxt, poGEOSCombinedGeometry);
+        }
+    }
+    else
+    {
+        StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_UNION);
+        sOutput.poMergedGeometry.reset(sOutput.poGeometry->clone());
+        for (auto poCreatureToMerge : sOutput.lstpoMerged)
+        {
+            if (sOutput.poMergedGeometry == nullptr)
+            {
+                break;
+            }
+            sOutput.poMergedGeometry.reset(sOutput.poMergedGeometry->Union(poCreatureToMerge->feature()->GetGeometryRef()));
+        }
+    }
+
+    if (sOutput.poMergedGeometry == nullptr)
+    {
+        return;
+    }
+
+    sOutput.poMergedGeometry->assignSpatialReference(sOutput.poGeometry->getSpatialReference());
+    sOutput.poGeometry = sOutput.poMergedGeometry.get();
+}
+
+void Eliminator::output(size_t i, output_t &sOutput)
+{
+    if (!m_vecpoKeep[i]->hasCreaturesToMerge())
+    {
+        compute(i, sOutput, m_oStats, m_oRepro);
+        return;
+    }
+
+    Tracer::Scope oTraceScope(m_oStats.trace(), "merge group");
+
+    std::chrono::steady_clock::time_point tStart;
+    if (m_oSlowLog.enabled())
+    {
+        tStart = std::chrono::steady_clock::now();
+    }
+
+    compute(i, sOutput, m_oStats, m_oRepro);
+
+    m_oStats.add(&EliminateStats::nGroups);
+    m_oStats.add(&EliminateStats::nFeaturesMerged, sOutput.lstpoMerged.size());
+
+    if (sOutput.poMergedGeometry == nullptr)
+    {
+        m_oDiagnostics.record(Diagnostics::UNION_FAILED, sOutput.poFeature->GetFID());
+        return;
+    }
+
+    if (m_poVerifier && m_poVerifier->groupSampled(m_iGroup++))
+    {
+        m_poVerifier->verifyUnion(m_vecpoKeep[i], sOutput.lstpoMerged, sOutput.poGeometry);
+    }
+
+    if (m_oSlowLog.enabled())
+    {
+        std::chrono::duration<double> dfElapsed = std::chrono::steady_clock::now() - tStart;
+        GIntBig nVertices = GEOSGetNumCoordinates_r(m_hGEOSCtxt, m_vecpoKeep[i]->geometry());
+        for (auto poCreatureToMerge : sOutput.lstpoMerged)
+        {
+            nVertices += GEOSGetNumCoordinates_r(m_hGEOSCtxt, poCreatureToMerge->geometry());
+        }
+        m_oSlowLog.record(SlowFeatureLog::UNION, sOutput.poFeature->GetFID(), nVertices,
+                          sOutput.lstpoMerged.size(), dfElapsed.count());
+    }
+}
+
+void Eliminator::outputAgain(size_t i, output_t &sOutput)
+{
+    StatsCollector oStats(false);
+    ReproCapture oRepro(nullptr, 0.0, 0);
+    compute(i, sOutput, oStats, oRepro);
+}
+
+void Eliminator::written(size_t i, OGRErr eErr)
+{
+    if (eErr != OGRERR_NONE)
+    {
+        m_oDiagnostics.record(Diagnostics::WRITE_FAILED, m_vecpoKeep[i]->feature()->GetFID());
+    }
+    else
+    {
+        m_oStats.add(&EliminateStats::nFeaturesWritten);
+    }
+}
+
+OGRErr Eliminator::finish(bool bContinue)
+{
+    while (m_nStagesEnded < ELIMINATE_STAGE_COUNT)
+    {
+        endStage(static_cast<EliminateStage>(m_nStagesEnded));
+    }
+
+    m_oStats.finish(m_psStats);
+
+    m_oDiagnostics.report();
+
+    // A report that was asked for but can't be written fails the run, once
+    // the others have been written.
+    bool bReportsWritten = true;
+
+    const char *pszDiagnosticsFilename = m_aosOptions.FetchNameValue("DIAGNOSTICS_FILE");
+    if (pszDiagnosticsFilename != nullptr)
+    {
+        bReportsWritten &= m_oDiagnostics.write(pszDiagnosticsFilename);
+    }
+
+    const char *pszSlowFeaturesFilename = m_aosOptions.FetchNameValue("SLOW_FEATURES_FILE");
+    if (pszSlowFeaturesFilename != nullptr)
+    {
+        bReportsWritten &= m_oSlowLog.write(pszSlowFeaturesFilename);
+    }
+
+    if (m_poTracer)
+    {
+        bReportsWritten &= m_poTracer->write(m_aosOptions.FetchNameValue("TRACE_FILE"));
+    }
+
+    if (m_poVerifier)
+    {
+        m_poVerifier->report();
+
+        const char *pszVerifyFilename = m_aosOptions.FetchNameValue("VERIFY_FILE");
+        if (pszVerifyFilename != nullptr)
+        {
+            bReportsWritten &= m_poVerifier->write(pszVerifyFilename);
+        }
+    }
+
+    if (!bContinue)
+    {
+        CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+        return OGRERR_FAILURE;
+    }
+
+    if (!bReportsWritten)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    if (m_poVerifier && !m_poVerifier->empty())
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Verification found %d discrepancies.", static_cast<int>(m_poVerifier->count()));
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
@@ -0,0 +1,161 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef ELIMINATOR_H_INCLUDED
+#define ELIMINATOR_H_INCLUDED
+
+#include <list>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "cpl_string.h"
+#include "ogrsf_frmts.h"
+
+#include "geos_c.h"
+
+#include "eliminate.h"
+#include "diagnostics.h"
+#include "featurecreature.h"
+#include "perfcounters.h"
+#include "repro.h"
+#include "slowlog.h"
+#include "statscollector.h"
+#include "trace.h"
+#include "verify.h"
+
+// One elimination, split into stages so that the features can come from a
+// layer or straight from memory, and the results be written to a layer or
+// handed back one at a time:
+//
+//   read() or add()  Take ownership of the features.
+//   plan()           Export, prepare and index them, and find the neighbor
+//                    each candidate is to be merged into.
+//   output()         Produce each feature that is kept, merged with
+//                    whatever was merged into it. Any order, any subset.
+//   finish()         Write the reports asked for in the options, and the
+//                    stats.
+//
+// The stages must be called in that order, from one thread; plan() runs
+// worker threads of its own (see NUM_THREADS).
+//
+class Eliminator
+{
+public:
+    struct output_t
+    {
+        const OGRFeature *poFeature = nullptr;
+        // The features merged into it, if any.
+        std::list<FeatureCreature *> lstpoMerged;
+        // The geometry to write: the feature's own, or poMergedGeometry.
+        const OGRGeometry *poGeometry = nullptr;
+        OGRGeometryUniquePtr poMergedGeometry;
+    };
+
+private:
+    EliminateMergeType m_eMergeType;
+    CPLStringList m_aosOptions;
+    EliminateStats *m_psStats;
+
+    Diagnostics m_oDiagnostics;
+    StatsCollector m_oStats;
+    std::unique_ptr<Tracer> m_poTracer;
+    PerfCounters m_oCounters;
+    size_t m_nSlowFeatures;
+    SlowFeatureLog m_oSlowLog;
+    ReproCapture m_oRepro;
+    std::unique_ptr<Verifier> m_poVerifier;
+    bool m_bUseGEOSGeometries;
+
+    GEOSContextHandle_t m_hGEOSCtxt;
+    GEOSSTRtree *m_poSTRTree;
+
+    std::list<FeatureCreature> m_lstFeatures;
+    std::vector<FeatureCreature *> m_vecpoKeep;
+    std::vector<FeatureCreature *> m_vecpoCandidates;
+    std::vector<FeatureCreature *> m_vecpoTargets;
+    // Which candidates have had their verification sample taken.
+    size_t m_iGroup;
+    // How many of the stages have been ended, in order.
+    int m_nStagesEnded;
+
+    void endStage(EliminateStage eStage);
+
+    std::vector<FeatureCreature *> order();
+    bool build(const std::vector<FeatureCreature *> &vecpoOrder, std::unordered_set<GIntBig> &setFIDsToEliminate, void *pScaledProgress);
+    bool findTargets(void *pScaledProgress);
+
+    // Produces output i, timing it into oStats, and records nothing else.
+    void compute(size_t i, output_t &sOutput, StatsCollector &oStats, ReproCapture &oRepro);
+
+public:
+    Eliminator(EliminateMergeType eMergeType, CSLConstList papszOptions, EliminateStats *psStats);
+    ~Eliminator();
+
+    Eliminator(const Eliminator &) = delete;
+    Eliminator &operator=(const Eliminator &) = delete;
+
+    // Reads every feature of the layer. False if cancelled.
+    bool read(OGRLayer *poSrcLayer, GDALProgressFunc pfnProgress, void *pProgressData);
+
+    void add(OGRFeatureUniquePtr poFeature);
+
+    // The features with these FIDs are the candidates for elimination.
+    // False if cancelled.
+    bool plan(std::unordered_set<GIntBig> setFIDsToEliminate, GDALProgressFunc pfnProgress, void *pProgressData);
+
+    // How many features are kept, which is how many outputs there are.
+    size_t outputCount() const
+    {
+        return m_vecpoKeep.size();
+    }
+
+    // The kept feature behind output i, without merging anything.
+    const OGRFeature *outputFeature(size_t i) const
+    {
+        return m_vecpoKeep[i]->feature();
+    }
+
+    // Produces output i, counting it in the stats, diagnostics, verifier
+    // and slow log. Called once per output.
+    void output(size_t i, output_t &sOutput);
+
+    // Produces output i again, for a caller that has already had it from
+    // output(), without counting it a second time.
+    void outputAgain(size_t i, output_t &sOutput);
+
+    // Records whether output i could be written.
+    void written(size_t i, OGRErr eErr);
+
+    StatsCollector &stats()
+    {
+        return m_oStats;
+    }
+
+    // bContinue is false if the run was cancelled along the way. Fails if a
+    // report asked for can't be written.
+    OGRErr finish(bool bContinue);
+};
+
+#endif // ELIMINATOR_H_INCLUDED
@@ -25,10 +25,25 @@
 #define EXPLODE_H_INCLUDED
 
 #include "gdal.h"
+#include "stats.h"
 
 CPL_C_START
 
+/* Keys recognized in papszOptions:
+ *
+ *   PERF_COUNTERS=YES     Sample hardware counters into the stats (Linux
+ *                         only).
+ *   CLUSTERED_OUTPUT=YES  Write the parts in Hilbert curve order, which
+ *                         means holding them all in memory first, with the
+ *                         destination's spatial index built at the end.
+ */
+
 OGRErr Explode(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName);
+/* As above, taking the options above, creating the destination layer with
+ * papszLayerCreationOptions, filling in *psStats if psStats is non-null, and
+ * reporting progress.
+ */
+OGRErr ExplodeEx(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData);
 
 CPL_C_END
 
@@ -23,11 +23,17 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 
 #include "gdal.h"
 #include "commonutils.h"
+#include "alllayers.h"
+#include "batch.h"
 #include "explode.h"
+#include "server.h"
+#include "statscollector.h"
+#include "writeprofile.h"
 
 
 struct ExplodeOptions
@@ -37,11 +43,23 @@ struct ExplodeOptions
     char *pszDstFilename;
     char *pszDstLayerName;
     char *pszFormat;
+    char *pszStatsFilename;
+    GDALProgressFunc pfnProgress;
+    double dfTimeout;
+    char **papszOptions;
+    char **papszDatasetCreationOptions;
+    char **papszLayerCreationOptions;
+    char *pszWriteProfile;
+    bool bAllLayers;
+    int nLayerJobs;
 
     ExplodeOptions() :
         pszSrcFilename(nullptr), pszSrcLayerName(nullptr),
         pszDstFilename(nullptr), pszDstLayerName(nullptr),
-        pszFormat(nullptr) {}
+        pszFormat(nullptr), pszStatsFilename(nullptr),
+        pfnProgress(nullptr), dfTimeout(0.0), papszOptions(nullptr),
+        papszDatasetCreationOptions(nullptr), papszLayerCreationOptions(nullptr),
+        pszWriteProfile(nullptr), bAllLayers(false), nLayerJobs(0) {}
 
     virtual ~ExplodeOptions()
     {
@@ -50,12 +68,29 @@ struct ExplodeOptions
         CPLFree(pszDstFilename);
         CPLFree(pszDstLayerName);
         CPLFree(pszFormat);
+        CPLFree(pszStatsFilename);
+        CSLDestroy(papszOptions);
+        CSLDestroy(papszDatasetCreationOptions);
+        CSLDestroy(papszLayerCreationOptions);
+        CPLFree(pszWriteProfile);
     }
 };
 
 static void PrintUsage(const char *pszErrorMessage = nullptr)
 {
-    std::cerr << "explode [-f <formatname>] <src_filename> [-l <src_layer>] <dst_filename> [-l <dst_layer>]" << std::endl;
+    // A job's errors are captured with it, and its usage is no help there.
+    if (InCapturedJob())
+    {
+        if (pszErrorMessage != nullptr)
+        {
+            CPLError(CE_Failure, CPLE_IllegalArg, "%s", pszErrorMessage);
+        }
+        return;
+    }
+
+    std::cerr << "explode -batch <manifest> [-jobs <n>] [-report <report_filename>]" << std::endl;
+    std::cerr << "explode -serve <socket_path> [-jobs <n>] [-queue <n>]" << std::endl;
+    std::cerr << "explode [-f <formatname>] [-stats <stats_filename>] [-clustered] [-dsco <NAME=VALUE>]... [-lco <NAME=VALUE>]... [-write-profile fast|default] [-all-layers [-layer-jobs <n>]] [-perf] [-progress] [-timeout <seconds>] <src_filename> [-l <src_layer>] <dst_filename> [-l <dst_layer>]" << std::endl;
     if (pszErrorMessage != nullptr)
     {
         std::cerr << "FAILURE: " << pszErrorMessage << std::endl;
@@ -82,6 +117,9 @@ static OGRErr ExplodeCmdLineProcessor(int nArgc, char **papszArgv, ExplodeOption
     const char *pszDstFilename = nullptr;
     const char *pszDstLayerName = nullptr;
     const char *pszFormat = nullptr;
+    const char *pszStatsFilename = nullptr;
+    const char *pszTimeout = nullptr;
+    bool bProgress = false;
 
     for (int i = 1; i < nArgc; ++i)
     {
@@ -93,6 +131,77 @@ static OGRErr ExplodeCmdLineProcessor(int nArgc, char **papszArgv, ExplodeOption
             }
             pszFormat = papszArgv[++i];
         }
+        else if (EQUAL(papszArgv[i], "-stats"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszStatsFilename = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-clustered"))
+        {
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "CLUSTERED_OUTPUT", "YES");
+        }
+        else if (EQUAL(papszArgv[i], "-dsco"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszDatasetCreationOptions = CSLAddString(psOptions->papszDatasetCreationOptions, papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-lco"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->papszLayerCreationOptions = CSLAddString(psOptions->papszLayerCreationOptions, papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-write-profile"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszWriteProfile = papszArgv[++i];
+            if (!EQUAL(pszWriteProfile, "fast") && !EQUAL(pszWriteProfile, "default"))
+            {
+                PrintUsage(CPLSPrintf("Unknown write profile '%s'.", pszWriteProfile));
+                return OGRERR_FAILURE;
+            }
+            CPLFree(psOptions->pszWriteProfile);
+            psOptions->pszWriteProfile = CPLStrdup(pszWriteProfile);
+        }
+        else if (EQUAL(papszArgv[i], "-perf"))
+        {
+            psOptions->papszOptions = CSLSetNameValue(psOptions->papszOptions, "PERF_COUNTERS", "YES");
+        }
+        else if (EQUAL(papszArgv[i], "-progress"))
+        {
+            bProgress = true;
+        }
+        else if (EQUAL(papszArgv[i], "-all-layers"))
+        {
+            psOptions->bAllLayers = true;
+        }
+        else if (EQUAL(papszArgv[i], "-layer-jobs"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nLayerJobs = std::max(1, atoi(papszArgv[++i]));
+        }
+        else if (EQUAL(papszArgv[i], "-timeout"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            pszTimeout = papszArgv[++i];
+        }
         else if (EQUAL(papszArgv[i], "-l") || EQUAL(papszArgv[i], "-layer"))
         {
             if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
@@ -164,6 +273,12 @@ static OGRErr ExplodeCmdLineProcessor(int nArgc, char **papszArgv, ExplodeOption
         return OGRERR_FAILURE;
     }
 
+    if (psOptions->bAllLayers && (pszSrcLayerName != nullptr || pszDstLayerName != nullptr))
+    {
+        PrintUsage("-all-layers cannot be combined with -l.");
+        return OGRERR_FAILURE;
+    }
+
     if (pszSrcLayerName != nullptr)
     {
         psOptions->pszSrcLayerName = CPLStrdup(pszSrcLayerName);
@@ -174,6 +289,26 @@ static OGRErr ExplodeCmdLineProcessor(int nArgc, char **papszArgv, ExplodeOption
         psOptions->pszDstLayerName = CPLStrdup(pszDstLayerName);
     }
 
+    if (pszStatsFilename != nullptr)
+    {
+        psOptions->pszStatsFilename = CPLStrdup(pszStatsFilename);
+    }
+
+    if (bProgress)
+    {
+        psOptions->pfnProgress = GDALTermProgress;
+    }
+
+    if (pszTimeout != nullptr)
+    {
+        psOptions->dfTimeout = CPLAtofM(pszTimeout);
+        if (psOptions->dfTimeout <= 0.0)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Invalid value for -timeout: %s", pszTimeout);
+            return OGRERR_FAILURE;
+        }
+    }
+
     if (pszFormat != nullptr)
     {
         psOptions->pszFormat = CPLStrdup(pszFormat);
@@ -212,19 +347,96 @@ static OGRErr ExplodeBinary(ExplodeOptions *psOptions)
 
     OGRErr eErr = OGRERR_FAILURE;
 
+    EliminateStats sStats{};
+    EliminateStats *psStats = psOptions->pszStatsFilename != nullptr ? &sStats : nullptr;
+
+    GDALProgressFunc pfnProgress = psOptions->pfnProgress;
+    void *pProgressData = nullptr;
+    TimeoutProgressData sTimeout(pfnProgress, pProgressData, psOptions->dfTimeout);
+    if (psOptions->dfTimeout > 0.0)
+    {
+        pfnProgress = TimeoutProgress;
+        pProgressData = &sTimeout;
+    }
+
+    // A cancelled or timed out run still writes its stats.
+    InterruptWatch oWatch(pfnProgress, pProgressData);
+    pfnProgress = InterruptWatch::Progress;
+    pProgressData = &oWatch;
+
+    WriteProfile oProfile;
+    if (!oProfile.load(psOptions->pszWriteProfile, psOptions->pszFormat))
+    {
+        return OGRERR_FAILURE;
+    }
+    oProfile.addDatasetOptions(psOptions->papszDatasetCreationOptions);
+    oProfile.addLayerOptions(psOptions->papszLayerCreationOptions);
+
     int nFlags = GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR;
     GDALDatasetH hSrcDS = GDALOpenEx(psOptions->pszSrcFilename, nFlags, nullptr, nullptr, nullptr);
     if (hSrcDS != nullptr)
     {
-        GDALDatasetH hDstDS = reinterpret_cast<GDALDatasetH>(OGR_Dr_CreateDataSource(hDriver, psOptions->pszDstFilename, nullptr));
-        if (hDstDS != nullptr)
+        WriteProfile::ConfigScope oConfigScope(oProfile);
+        GDALDatasetH hDstDS = reinterpret_cast<GDALDatasetH>(OGR_Dr_CreateDataSource(hDriver, psOptions->pszDstFilename, const_cast<char **>(oProfile.datasetOptions())));
+        if (hDstDS != nullptr && psOptions->bAllLayers)
         {
-            eErr = Explode(hSrcDS, psOptions->pszSrcLayerName, hDstDS, psOptions->pszDstLayerName);
+            // Each layer is staged in memory and copied into the
+            // destination, where the profile's layer options apply.
+            auto fnLayer = [psOptions](GDALDatasetH hLayerSrcDS, const char *pszLayerName, GDALDatasetH hStageDS, EliminateStats *psLayerStats, GDALProgressFunc pfnLayerProgress, void *pLayerProgressData) {
+                return ExplodeEx(hLayerSrcDS, pszLayerName, hStageDS, pszLayerName, psOptions->papszOptions, nullptr, psLayerStats, pfnLayerProgress, pLayerProgressData);
+            };
+            int nJobs = psOptions->nLayerJobs > 0 ? psOptions->nLayerJobs : CPLGetNumCPUs();
+            bool bClustered = CPLFetchBool(psOptions->papszOptions, "CLUSTERED_OUTPUT", false);
+
+            oProfile.begin(hDstDS);
+            eErr = RunAllLayers(psOptions->pszSrcFilename, hDstDS, nJobs, bClustered, false, oProfile, fnLayer, psStats, pfnProgress, pProgressData);
+            OGRErr eEndErr = oProfile.end(hDstDS);
+            if (eErr == OGRERR_NONE)
+            {
+                eErr = eEndErr;
+            }
+            GDALClose(hDstDS);
+        }
+        else if (hDstDS != nullptr)
+        {
+            oProfile.begin(hDstDS);
+            eErr = ExplodeEx(hSrcDS, psOptions->pszSrcLayerName, hDstDS, psOptions->pszDstLayerName, psOptions->papszOptions, oProfile.layerOptions(), psStats, pfnProgress, pProgressData);
+            OGRErr eEndErr = oProfile.end(hDstDS);
+            if (eErr == OGRERR_NONE)
+            {
+                eErr = eEndErr;
+            }
             GDALClose(hDstDS);
         }
         GDALClose(hSrcDS);
     }
 
+    if ((eErr == OGRERR_NONE || oWatch.interrupted()) && psStats != nullptr)
+    {
+        psStats->bInterrupted = oWatch.interrupted();
+        OGRErr eStatsErr = EliminateStatsWriteJSONEx(psStats, psOptions->pszStatsFilename, oProfile.settings().List());
+        if (eErr == OGRERR_NONE)
+        {
+            eErr = eStatsErr;
+        }
+    }
+
+    return eErr;
+}
+
+// Runs one explode job per manifest line, each parsed as its own command
+// line.
+//
+static OGRErr RunBatchJob(int nArgc, char **papszArgv)
+{
+    ExplodeOptions *psOptions = new ExplodeOptions;
+    OGRErr eErr = ExplodeCmdLineProcessor(nArgc, papszArgv, psOptions);
+    if (eErr == OGRERR_NONE)
+    {
+        psOptions->pfnProgress = nullptr;
+        eErr = ExplodeBinary(psOptions);
+    }
+    delete psOptions;
     return eErr;
 }
 
@@ -241,6 +453,14 @@ MAIN_START(argc, argv)
     {
         PrintUsage();
     }
+    else if (nArgc > 1 && EQUAL(papszArgv[1], "-batch"))
+    {
+        nExitStatus = RunBatchCommand(nArgc, papszArgv, RunBatchJob) == OGRERR_NONE ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (nArgc > 1 && EQUAL(papszArgv[1], "-serve"))
+    {
+        nExitStatus = RunServerCommand("explode", nArgc, papszArgv, RunBatchJob) == OGRERR_NONE ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     else
     {
         ExplodeOptions *psOptions = new ExplodeOptions;
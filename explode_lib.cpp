@@ -21,10 +21,19 @@
  * DEALINGS IN THE SOFTWARE.
  ****************************************************************************/
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "gdal.h"
+#include "cpl_string.h"
 #include "ogrsf_frmts.h"
 
+#include "deferredindex.h"
 #include "explode.h"
+#include "hilbert.h"
+#include "perfcounters.h"
+#include "statscollector.h"
 
 
 static bool IsGeomTypeSupported(OGRwkbGeometryType eType)
@@ -83,6 +92,11 @@ OGRErr CopyFeature(OGRLayer *poDstLayer, const OGRFeature *poSrcFeature, const O
 }
 
 OGRErr Explode(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName)
+{
+    return ExplodeEx(hSrcDS, pszSrcLayerName, hDstDS, pszDstLayerName, nullptr, nullptr, nullptr, nullptr, nullptr);
+}
+
+OGRErr ExplodeEx(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hDstDS, const char *pszDstLayerName, CSLConstList papszOptions, CSLConstList papszLayerCreationOptions, EliminateStats *psStats, GDALProgressFunc pfnProgress, void *pProgressData)
 {
     GDALDataset *poSrcDS = GDALDataset::FromHandle(hSrcDS);
     GDALDataset *poDstDS = GDALDataset::FromHandle(hDstDS);
@@ -133,7 +147,22 @@ OGRErr Explode(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hD
 
     // TODO: Ownership of layer?
 
-    OGRLayer *poDstLayer = poDstDS->CreateLayer(pszDstLayerName, poSrcLayer->GetSpatialRef(), wkbPolygon);
+    const bool bClustered = CPLFetchBool(papszOptions, "CLUSTERED_OUTPUT", false);
+    char **papszLayerOptions = CSLDuplicate(papszLayerCreationOptions);
+    if (bClustered)
+    {
+        // The deferred index has to win, or building it at the end fails.
+        char **papszDeferredOptions = DeferredIndexLayerOptions(poDstDS);
+        papszLayerOptions = CSLMerge(papszLayerOptions, papszDeferredOptions);
+        CSLDestroy(papszDeferredOptions);
+    }
+    OGRLayer *poDstLayer = poDstDS->CreateLayer(pszDstLayerName, poSrcLayer->GetSpatialRef(), wkbPolygon, papszLayerOptions);
+    CSLDestroy(papszLayerOptions);
+
+    if (poDstLayer == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
 
     for (int iField = 0, nCount = poSrcLayerDefn->GetFieldCount(); iField < nCount; iField++)
     {
@@ -158,10 +187,53 @@ OGRErr Explode(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hD
         poDstLayer->CreateGeomField(&oDstFieldDefn);
     }
 
+    if (pfnProgress == nullptr)
+    {
+        pfnProgress = GDALDummyProgress;
+    }
+
     OGRErr eErr = OGRERR_NONE;
 
-    for (auto &poSrcFeature : poSrcLayer)
+    StatsCollector oStats(psStats != nullptr);
+
+    GIntBig nFeatureCount = poSrcLayer->GetFeatureCount(FALSE);
+    GIntBig nFeaturesRead = 0;
+
+    PerfCounters oCounters(oStats.enabled() && CPLFetchBool(papszOptions, "PERF_COUNTERS", false));
+    oCounters.start();
+
+    // Clustered output holds every part until all have been read, then
+    // writes them along a Hilbert curve, so reading is only half the work.
+    std::vector<OGRFeatureUniquePtr> apoHeldFeatures;
+    std::vector<std::pair<const OGRFeature *, const OGRGeometry *>> asHeldParts;
+    const double dfReadShare = bClustered ? 0.5 : 1.0;
+
+    poSrcLayer->ResetReading();
+
+    while (true)
     {
+        double dfComplete = nFeatureCount > 0 ? std::min(1.0, static_cast<double>(nFeaturesRead) / nFeatureCount) : 0.0;
+        if (!pfnProgress(dfComplete * dfReadShare, nullptr, pProgressData))
+        {
+            CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+            eErr = OGRERR_FAILURE;
+            break;
+        }
+
+        OGRFeatureUniquePtr poSrcFeature;
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_READ);
+            poSrcFeature.reset(poSrcLayer->GetNextFeature());
+        }
+
+        if (poSrcFeature == nullptr)
+        {
+            break;
+        }
+
+        nFeaturesRead++;
+        oStats.add(&EliminateStats::nFeaturesRead);
+
         const OGRGeometry *poSrcGeometry = poSrcFeature->GetGeometryRef();
         OGRwkbGeometryType eSrcFtrType = poSrcGeometry->getGeometryType();
 
@@ -177,23 +249,99 @@ OGRErr Explode(GDALDatasetH hSrcDS, const char *pszSrcLayerName, GDALDatasetH hD
             const OGRGeometryCollection *poSrcGeometryCollection = poSrcGeometry->toGeometryCollection();
             for (auto &poSrcSingularGeometry : poSrcGeometryCollection)
             {
+                if (bClustered)
+                {
+                    asHeldParts.emplace_back(poSrcFeature.get(), poSrcSingularGeometry);
+                    continue;
+                }
+
+                StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_WRITE);
                 eErr = CopyFeature(poDstLayer, poSrcFeature.get(), poSrcSingularGeometry);
                 if (eErr != OGRERR_NONE)
                 {
                     break;
                 }
+                oStats.add(&EliminateStats::nFeaturesWritten);
             }
         }
+        else if (bClustered)
+        {
+            asHeldParts.emplace_back(poSrcFeature.get(), poSrcGeometry);
+        }
         else
         {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_WRITE);
             eErr = CopyFeature(poDstLayer, poSrcFeature.get(), poSrcGeometry);
+            if (eErr == OGRERR_NONE)
+            {
+                oStats.add(&EliminateStats::nFeaturesWritten);
+            }
         }
 
         if (eErr != OGRERR_NONE)
         {
             break;
         }
+
+        if (bClustered)
+        {
+            apoHeldFeatures.push_back(std::move(poSrcFeature));
+        }
     }
 
+    if (eErr == OGRERR_NONE && bClustered)
+    {
+        OGREnvelope sExtent;
+        for (const auto &sPart : asHeldParts)
+        {
+            OGREnvelope sEnvelope;
+            sPart.second->getEnvelope(&sEnvelope);
+            sExtent.Merge(sEnvelope);
+        }
+
+        HilbertCurve oCurve(sExtent);
+        std::vector<GUInt32> anCodes;
+        anCodes.reserve(asHeldParts.size());
+        for (const auto &sPart : asHeldParts)
+        {
+            anCodes.push_back(oCurve.code(sPart.second));
+        }
+
+        size_t iWritten = 0;
+        for (size_t i : HilbertCurve::order(anCodes))
+        {
+            if (!pfnProgress(0.5 + 0.5 * iWritten++ / asHeldParts.size(), nullptr, pProgressData))
+            {
+                CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+                eErr = OGRERR_FAILURE;
+                break;
+            }
+
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_WRITE);
+            eErr = CopyFeature(poDstLayer, asHeldParts[i].first, asHeldParts[i].second);
+            if (eErr != OGRERR_NONE)
+            {
+                break;
+            }
+            oStats.add(&EliminateStats::nFeaturesWritten);
+        }
+    }
+
+    if (eErr == OGRERR_NONE && bClustered)
+    {
+        StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_WRITE);
+        eErr = BuildDeferredIndex(poDstDS, poDstLayer);
+    }
+
+    oCounters.stop(oStats.stats().asCounters[ELIMINATE_STAGE_WRITE]);
+    oStats.endStage(ELIMINATE_STAGE_WRITE);
+
+    if (eErr == OGRERR_NONE)
+    {
+        pfnProgress(1.0, nullptr, pProgressData);
+    }
+
+    oStats.finish(psStats);
+
     return eErr;
 }
@@ -0,0 +1,366 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef FEATURECREATURE_H_INCLUDED
+#define FEATURECREATURE_H_INCLUDED
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <vector>
+
+#include "cpl_port.h"
+#include "ogrsf_frmts.h"
+
+#include "geos_c.h"
+
+#include "eliminate.h"
+#include "diagnostics.h"
+#include "repro.h"
+#include "statscollector.h"
+
+// Rough per-object costs for the memory accounting, after the layouts in
+// GEOS 3.x. Good enough to size a machine, not to find a leak.
+//
+static constexpr GIntBig GEOS_COORDINATE_BYTES = 3 * sizeof(double);
+static constexpr GIntBig GEOS_GEOMETRY_BYTES = 96;
+static constexpr GIntBig PREPARED_SEGMENT_BYTES = 48;
+static constexpr GIntBig STRTREE_ITEM_BYTES = 80;
+static constexpr GIntBig LIST_NODE_BYTES = 2 * sizeof(void *);
+
+class FeatureCreature
+{
+public:
+    struct neighbor_t
+    {
+        FeatureCreature *poCreature;
+        double dfBoundaryLength;
+        void addCreatureToMerge(FeatureCreature *poCreatureToMerge)
+        {
+            poCreature->addCreatureToMerge(poCreatureToMerge);
+        }
+        static bool larger(const neighbor_t &a, const neighbor_t &b) { return a.poCreature->area() >= b.poCreature->area(); };
+        static bool smaller(const neighbor_t &a, const neighbor_t &b) { return a.poCreature->area() < b.poCreature->area(); };
+        static bool longer(const neighbor_t &a, const neighbor_t &b) { return a.dfBoundaryLength >= b.dfBoundaryLength; };
+        typedef bool (*comp_t)(const neighbor_t &, const neighbor_t &);
+
+        static comp_t comparator(EliminateMergeType eMergeType)
+        {
+            switch (eMergeType)
+            {
+                default:
+                case ELIMINATE_MERGE_LARGEST_AREA:
+                    return larger;
+
+                case ELIMINATE_MERGE_SMALLEST_AREA:
+                    return smaller;
+
+                case ELIMINATE_MERGE_LONGEST_BOUNDARY:
+                    return longer;
+            }
+        }
+    };
+
+    // Gathers the index hits for a feature, other than the feature itself.
+    struct query_t
+    {
+        FeatureCreature *poCreature;
+        std::list<FeatureCreature *> *plstpoNeighbors;
+
+        static void callback(void *poItem, void *poUserData)
+        {
+            auto poNeighbor = static_cast<FeatureCreature *>(poItem);
+            auto poQuery = static_cast<query_t *>(poUserData);
+            if (poQuery->poCreature != poNeighbor)
+            {
+                poQuery->plstpoNeighbors->push_back(poNeighbor);
+            }
+        }
+    };
+
+private:
+    OGRFeatureUniquePtr m_poFeature;
+    GEOSContextHandle_t m_hGEOSContext;
+    Diagnostics *m_poDiagnostics;
+    GEOSGeometry* m_poGEOSGeometry;
+    const GEOSPreparedGeometry *m_poGEOSPreparedGeometry;
+    double m_dfArea;
+    std::list<neighbor_t> m_lstNeighbors;
+    std::list<FeatureCreature *> m_lstpoCreaturesToMerge;
+
+public:
+    FeatureCreature(OGRFeatureUniquePtr poFeature, GEOSContextHandle_t hGEOSCtxt, Diagnostics *poDiagnostics) :
+        m_poFeature(std::move(poFeature)), m_hGEOSContext(hGEOSCtxt),
+        m_poDiagnostics(poDiagnostics), m_poGEOSGeometry(nullptr), m_poGEOSPreparedGeometry(nullptr),
+        m_dfArea(-1.0)
+    {
+    }
+
+    virtual ~FeatureCreature()
+    {
+        if (m_poGEOSPreparedGeometry != nullptr)
+        {
+            GEOSPreparedGeom_destroy_r(m_hGEOSContext ,m_poGEOSPreparedGeometry);
+        }
+        if (m_poGEOSGeometry != nullptr)
+        {
+            GEOSGeom_destroy_r(m_hGEOSContext, m_poGEOSGeometry);
+        }
+    }
+
+    const OGRFeature *feature() const
+    {
+        return m_poFeature.get();
+    }
+
+    OGRErr initGeometry()
+    {
+        if (m_poGEOSGeometry != nullptr)
+        {
+            return OGRERR_NONE;
+        }
+
+        OGRGeometry *poGeom = m_poFeature->GetGeometryRef();
+        if (poGeom == nullptr)
+        {
+            m_poDiagnostics->record(Diagnostics::NO_GEOMETRY, m_poFeature->GetFID());
+            return OGRERR_FAILURE;
+        }
+
+        m_poGEOSGeometry = poGeom->exportToGEOS(m_hGEOSContext);
+        if (m_poGEOSGeometry == nullptr)
+        {
+            m_poDiagnostics->record(Diagnostics::GEOS_EXPORT_FAILED, m_poFeature->GetFID());
+            return OGRERR_FAILURE;
+        }
+
+        return OGRERR_NONE;
+    }
+
+    GEOSGeometry *geometry()
+    {
+        if (m_poGEOSGeometry == nullptr)
+        {
+            initGeometry();
+        }
+        return m_poGEOSGeometry;
+    }
+
+    OGRErr initPreparedGeometry()
+    {
+        if (m_poGEOSPreparedGeometry != nullptr)
+        {
+            return OGRERR_NONE;
+        }
+
+        OGRErr eErr = initGeometry();
+        if (eErr != OGRERR_NONE)
+        {
+            return eErr;
+        }
+
+        m_poGEOSPreparedGeometry = GEOSPrepare_r(m_hGEOSContext, m_poGEOSGeometry);
+        if (m_poGEOSPreparedGeometry == nullptr)
+        {
+            m_poDiagnostics->record(Diagnostics::GEOS_PREPARE_FAILED, m_poFeature->GetFID());
+            return OGRERR_FAILURE;
+        }
+
+        return OGRERR_NONE;
+    }
+
+    const GEOSPreparedGeometry *preparedGeometry()
+    {
+        if (m_poGEOSPreparedGeometry == nullptr)
+        {
+            initPreparedGeometry();
+        }
+        return m_poGEOSPreparedGeometry;
+    }
+
+    double area()
+    {
+        if (m_dfArea < 0.0)
+        {
+            if (1 != GEOSArea_r(m_hGEOSContext, geometry(), &m_dfArea))
+            {
+                m_poDiagnostics->record(Diagnostics::AREA_FAILED, m_poFeature->GetFID());
+                m_dfArea = 0.0;
+            }
+        }
+        return m_dfArea;
+    }
+
+    // May be called from any thread, given that thread's GEOS context, as
+    // long as this feature's geometry is prepared and the neighbor's
+    // exported beforehand.
+    void addNeighborIfTouching(FeatureCreature* poNeighbor, GEOSContextHandle_t hGEOSCtxt, StatsCollector &oStats, ReproCapture &oRepro)
+    {
+        // TODO: Can simply perform the intersection to determine if they touch, but is it more expensive?
+
+        int nTouches;
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_TOUCHES);
+            ReproCapture::clock_t::time_point tStart = oRepro.now();
+            nTouches = GEOSPreparedTouches_r(hGEOSCtxt, preparedGeometry(), poNeighbor->geometry());
+            oRepro.check(hGEOSCtxt, "touches", m_poFeature->GetFID(), nTouches == 2, tStart, {geometry(), poNeighbor->geometry()});
+        }
+
+        if (1 == nTouches)
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_INTERSECTION);
+            ReproCapture::clock_t::time_point tStart = oRepro.now();
+            GEOSGeometry *poIntersection = GEOSIntersection_r(hGEOSCtxt, geometry(),  poNeighbor->geometry());
+
+            double dfLength = 0.0;
+            int nLengthOK = poIntersection != nullptr ? GEOSLength_r(hGEOSCtxt, poIntersection, &dfLength) : 0;
+            oRepro.check(hGEOSCtxt, "intersection", m_poFeature->GetFID(), nLengthOK != 1, tStart, {geometry(), poNeighbor->geometry()});
+            if (1 == nLengthOK)
+            {
+                m_lstNeighbors.push_back({poNeighbor, dfLength});
+            }
+            else
+            {
+                m_poDiagnostics->record(Diagnostics::LENGTH_FAILED, m_poFeature->GetFID());
+                m_lstNeighbors.push_back({poNeighbor, 0.0});
+            }
+            oStats.add(&EliminateStats::nNeighbors);
+
+            if (poIntersection != nullptr)
+            {
+                GEOSGeom_destroy_r(hGEOSCtxt, poIntersection);
+            }
+        }
+    }
+
+    size_t neighborCount() const
+    {
+        return m_lstNeighbors.size();
+    }
+
+    const std::list<neighbor_t> &neighbors() const
+    {
+        return m_lstNeighbors;
+    }
+
+    // The OGR feature, including its fields and geometry, and this node.
+    GIntBig featureBytes() const
+    {
+        GIntBig nBytes = sizeof(OGRFeature) + sizeof(FeatureCreature) + LIST_NODE_BYTES;
+        for (int iField = 0, nCount = m_poFeature->GetFieldCount(); iField < nCount; iField++)
+        {
+            nBytes += sizeof(OGRField);
+            if (m_poFeature->IsFieldSetAndNotNull(iField) && m_poFeature->GetFieldDefnRef(iField)->GetType() == OFTString)
+            {
+                nBytes += strlen(m_poFeature->GetFieldAsString(iField)) + 1;
+            }
+        }
+        const OGRGeometry *poGeom = m_poFeature->GetGeometryRef();
+        if (poGeom != nullptr)
+        {
+            nBytes += poGeom->WkbSize();
+        }
+        return nBytes;
+    }
+
+    GIntBig geometryBytes() const
+    {
+        if (m_poGEOSGeometry == nullptr)
+        {
+            return 0;
+        }
+        int nCoordinates = std::max(0, GEOSGetNumCoordinates_r(m_hGEOSContext, m_poGEOSGeometry));
+        int nParts = std::max(1, GEOSGetNumGeometries_r(m_hGEOSContext, m_poGEOSGeometry));
+        return nCoordinates * GEOS_COORDINATE_BYTES + nParts * GEOS_GEOMETRY_BYTES;
+    }
+
+    // The segment index is built by the first predicate, so this is what
+    // it will cost once that has happened.
+    GIntBig preparedGeometryBytes() const
+    {
+        if (m_poGEOSPreparedGeometry == nullptr)
+        {
+            return 0;
+        }
+        int nCoordinates = std::max(0, GEOSGetNumCoordinates_r(m_hGEOSContext, m_poGEOSGeometry));
+        return nCoordinates * PREPARED_SEGMENT_BYTES + GEOS_GEOMETRY_BYTES;
+    }
+
+    neighbor_t *findNeighbor(neighbor_t::comp_t comp)
+    {
+        auto itr = std::min_element(m_lstNeighbors.begin(), m_lstNeighbors.end(), comp);
+        return itr != m_lstNeighbors.end() ? &*itr : nullptr;
+    }
+
+    neighbor_t *findNeighbor(EliminateMergeType eMergeType)
+    {
+        return findNeighbor(neighbor_t::comparator(eMergeType));
+    }
+
+    // The union of this feature with the ones merged into it, which the
+    // caller must destroy.
+    GEOSGeometry *unionWith(const std::list<FeatureCreature *> &lstpoCreaturesToMerge, StatsCollector &oStats, ReproCapture &oRepro)
+    {
+        // Clone the geometries because the collection assumes ownership.
+        std::vector<GEOSGeometry *> vecGeometries;
+        vecGeometries.push_back(GEOSGeom_clone_r(m_hGEOSContext, geometry()));
+        for (auto poCreatureToMerge : lstpoCreaturesToMerge)
+        {
+            vecGeometries.push_back(GEOSGeom_clone_r(m_hGEOSContext, poCreatureToMerge->geometry()));
+        }
+        GEOSGeometry *poGEOSGeometryCollection = GEOSGeom_createCollection_r(m_hGEOSContext, GEOS_MULTIPOLYGON, vecGeometries.data(), vecGeometries.size());
+        GEOSGeometry *poGEOSCombinedGeometry;
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_UNION);
+            ReproCapture::clock_t::time_point tStart = oRepro.now();
+            poGEOSCombinedGeometry = GEOSUnaryUnion_r(m_hGEOSContext, poGEOSGeometryCollection);
+            oRepro.check(m_hGEOSContext, "union", m_poFeature->GetFID(), poGEOSCombinedGeometry == nullptr, tStart, {poGEOSGeometryCollection});
+        }
+        GEOSGeom_destroy_r(m_hGEOSContext, poGEOSGeometryCollection);
+        return poGEOSCombinedGeometry;
+    }
+
+    void addCreatureToMerge(FeatureCreature *poCreature)
+    {
+        m_lstpoCreaturesToMerge.push_back(poCreature);
+    }
+
+    bool hasCreaturesToMerge() const
+    {
+        return !m_lstpoCreaturesToMerge.empty();
+    }
+
+    std::list<FeatureCreature *> allCreaturesToMerge() const
+    {
+        std::list<FeatureCreature *> lstpoAllCreaturesToMerge;
+        for (auto poCreature : m_lstpoCreaturesToMerge)
+        {
+            lstpoAllCreaturesToMerge.push_back(poCreature);
+            std::list<FeatureCreature *> lstpoCreaturesCreatures = poCreature->allCreaturesToMerge();
+            lstpoAllCreaturesToMerge.insert(lstpoAllCreaturesToMerge.end(), lstpoCreaturesCreatures.begin(), lstpoCreaturesCreatures.end());
+        }
+        return lstpoAllCreaturesToMerge;
+    }
+};
+
+#endif // FEATURECREATURE_H_INCLUDED
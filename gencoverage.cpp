@@ -0,0 +1,590 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+// Writes a synthetic polygon coverage for benchmarking eliminate and
+// explode. Two styles are generated: clipped Voronoi cells, which look like
+// vector-digitized parcels, and a polygonized raster of nearest-seed blocks,
+// which looks like the output of a classification. Both are deterministic
+// for a given set of options, so results can be compared across builds.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+#include "gdal.h"
+#include "gdal_alg.h"
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "geos_c.h"
+
+#include "commonutils.h"
+
+
+// Every cell is roughly this wide, whatever the feature count, so an area
+// threshold means the same thing for any size of run.
+static constexpr double CELL_SIZE = 100.0;
+
+// Slivers are this fraction of a cell wide.
+static constexpr double SLIVER_WIDTH = 0.01;
+
+// Giants swallow everything within this fraction of the extent.
+static constexpr double GIANT_RADIUS = 0.05;
+
+struct GenerateOptions
+{
+    bool bRaster;
+    int nFeatures;
+    double dfSliverFraction;
+    int nVertices;
+    int nGiants;
+    GUIntBig nSeed;
+    const char *pszFormat;
+    const char *pszDstFilename;
+};
+
+// SplitMix64, so that the sequence doesn't depend on the standard library.
+class Random
+{
+    GUIntBig m_nState;
+
+public:
+    explicit Random(GUIntBig nSeed) :
+        m_nState(nSeed)
+    {
+    }
+
+    GUIntBig next()
+    {
+        GUIntBig z = (m_nState += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1).
+    double uniform()
+    {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    int below(int n)
+    {
+        return static_cast<int>(next() % static_cast<GUIntBig>(n));
+    }
+};
+
+static void PrintUsage(const char *pszErrorMessage = nullptr)
+{
+    std::cerr << "gencoverage [-type voronoi|raster] [-n <features>] [-slivers <fraction>] [-vertices <n>] [-giants <n>] [-seed <n>] [-f <formatname>] <dst_filename>" << std::endl;
+    if (pszErrorMessage != nullptr)
+    {
+        std::cerr << "FAILURE: " << pszErrorMessage << std::endl;
+    }
+}
+
+static bool HasEnoughAdditionalArgs(char **papszArgv, int i, int nArgc, int nExtraArgs)
+{
+    if (i + nExtraArgs >= nArgc)
+    {
+        PrintUsage(CPLSPrintf("%s option requires %d argument(s)", papszArgv[i], nExtraArgs));
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
+static OGRErr WriteFeature(OGRLayer *poLayer, int nID, OGRGeometry *poGeometry)
+{
+    OGRFeatureUniquePtr poFeature(OGRFeature::CreateFeature(poLayer->GetLayerDefn()));
+    poFeature->SetField(0, nID);
+    poFeature->SetGeometryDirectly(poGeometry);
+    return poLayer->CreateFeature(poFeature.get());
+}
+
+// Writes each polygon part of a geometry as its own feature.
+static OGRErr WritePolygons(OGRLayer *poLayer, int &nID, OGRGeometry *poGeometry, double dfMaxSegmentLength)
+{
+    OGRGeometryUniquePtr poOwned(poGeometry);
+    if (poGeometry == nullptr || poGeometry->IsEmpty())
+    {
+        return OGRERR_NONE;
+    }
+
+    OGRwkbGeometryType eType = wkbFlatten(poGeometry->getGeometryType());
+    if (eType == wkbPolygon)
+    {
+        poGeometry->segmentize(dfMaxSegmentLength);
+        return WriteFeature(poLayer, nID++, poOwned.release());
+    }
+    else if (eType == wkbMultiPolygon || eType == wkbGeometryCollection)
+    {
+        for (auto &&poPart : *poGeometry->toGeometryCollection())
+        {
+            OGRErr eErr = WritePolygons(poLayer, nID, poPart->clone(), dfMaxSegmentLength);
+            if (eErr != OGRERR_NONE)
+            {
+                return eErr;
+            }
+        }
+    }
+    return OGRERR_NONE;
+}
+
+// A strip of the given width straddling the longest edge of the polygon's
+// exterior ring, long enough to cover the edge.
+static OGRPolygon *SliverStrip(const OGRPolygon *poCell, double dfWidth)
+{
+    const OGRLinearRing *poRing = poCell->getExteriorRing();
+    int iLongest = 0;
+    double dfLongest = -1.0;
+    for (int i = 0; i + 1 < poRing->getNumPoints(); i++)
+    {
+        double dfLength = std::hypot(poRing->getX(i + 1) - poRing->getX(i), poRing->getY(i + 1) - poRing->getY(i));
+        if (dfLength > dfLongest)
+        {
+            dfLongest = dfLength;
+            iLongest = i;
+        }
+    }
+    if (dfLongest <= 0.0)
+    {
+        return nullptr;
+    }
+
+    double dfAX = poRing->getX(iLongest);
+    double dfAY = poRing->getY(iLongest);
+    double dfDX = (poRing->getX(iLongest + 1) - dfAX) / dfLongest;
+    double dfDY = (poRing->getY(iLongest + 1) - dfAY) / dfLongest;
+    double dfNX = -dfDY * dfWidth;
+    double dfNY = dfDX * dfWidth;
+    double dfExtra = dfLongest;
+
+    OGRLinearRing *poStripRing = new OGRLinearRing();
+    poStripRing->addPoint(dfAX - dfDX * dfExtra - dfNX, dfAY - dfDY * dfExtra - dfNY);
+    poStripRing->addPoint(dfAX + dfDX * 2 * dfExtra - dfNX, dfAY + dfDY * 2 * dfExtra - dfNY);
+    poStripRing->addPoint(dfAX + dfDX * 2 * dfExtra + dfNX, dfAY + dfDY * 2 * dfExtra + dfNY);
+    poStripRing->addPoint(dfAX - dfDX * dfExtra + dfNX, dfAY - dfDY * dfExtra + dfNY);
+    poStripRing->closeRings();
+
+    OGRPolygon *poStrip = new OGRPolygon();
+    poStrip->addRingDirectly(poStripRing);
+    return poStrip;
+}
+
+static OGRErr GenerateVoronoi(const GenerateOptions &sOptions, OGRLayer *poLayer)
+{
+    Random oRandom(sOptions.nSeed);
+
+    int nSlivers = static_cast<int>(sOptions.nFeatures * sOptions.dfSliverFraction);
+    int nPoints = std::max(1, sOptions.nFeatures - nSlivers);
+    double dfExtent = std::sqrt(static_cast<double>(nPoints)) * CELL_SIZE;
+
+    std::vector<std::pair<double, double>> aoPoints;
+    aoPoints.reserve(nPoints);
+    for (int i = 0; i < nPoints; i++)
+    {
+        aoPoints.emplace_back(oRandom.uniform() * dfExtent, oRandom.uniform() * dfExtent);
+    }
+
+    // A giant is a lone seed with the ones around it cleared away.
+    double dfGiantRadius = dfExtent * GIANT_RADIUS;
+    for (int i = 0; i < sOptions.nGiants; i++)
+    {
+        double dfX = oRandom.uniform() * dfExtent;
+        double dfY = oRandom.uniform() * dfExtent;
+        aoPoints.erase(std::remove_if(aoPoints.begin(), aoPoints.end(), [&](const std::pair<double, double> &oPoint) {
+            return std::hypot(oPoint.first - dfX, oPoint.second - dfY) < dfGiantRadius;
+        }), aoPoints.end());
+        aoPoints.emplace_back(dfX, dfY);
+    }
+
+    GEOSContextHandle_t hGEOSCtxt = OGRGeometry::createGEOSContext();
+
+    std::vector<GEOSGeometry *> apoPoints;
+    apoPoints.reserve(aoPoints.size());
+    for (const auto &oPoint : aoPoints)
+    {
+        apoPoints.push_back(GEOSGeom_createPointFromXY_r(hGEOSCtxt, oPoint.first, oPoint.second));
+    }
+    GEOSGeometry *poSites = GEOSGeom_createCollection_r(hGEOSCtxt, GEOS_MULTIPOINT, apoPoints.data(), apoPoints.size());
+    GEOSGeometry *poCells = GEOSVoronoiDiagram_r(hGEOSCtxt, poSites, nullptr, 0.0, 0);
+    GEOSGeom_destroy_r(hGEOSCtxt, poSites);
+
+    if (poCells == nullptr)
+    {
+        OGRGeometry::freeGEOSContext(hGEOSCtxt);
+        CPLError(CE_Failure, CPLE_AppDefined, "Voronoi diagram failed.");
+        return OGRERR_FAILURE;
+    }
+
+    OGRGeometryUniquePtr poCollection(OGRGeometryFactory::createFromGEOS(hGEOSCtxt, poCells));
+    GEOSGeom_destroy_r(hGEOSCtxt, poCells);
+    OGRGeometry::freeGEOSContext(hGEOSCtxt);
+
+    OGRLinearRing *poExtentRing = new OGRLinearRing();
+    poExtentRing->addPoint(0.0, 0.0);
+    poExtentRing->addPoint(dfExtent, 0.0);
+    poExtentRing->addPoint(dfExtent, dfExtent);
+    poExtentRing->addPoint(0.0, dfExtent);
+    poExtentRing->closeRings();
+    OGRPolygon oExtent;
+    oExtent.addRingDirectly(poExtentRing);
+
+    // The same segment length everywhere keeps shared edges identical on
+    // both sides, and gives the giants their long boundaries.
+    double dfMaxSegmentLength = 4.0 * CELL_SIZE / std::max(4, sOptions.nVertices);
+
+    // Slivers are cut from randomly chosen cells, at most one per cell.
+    int nCells = poCollection->toGeometryCollection()->getNumGeometries();
+    std::vector<bool> abSliver(nCells, false);
+    for (int i = 0; i < std::min(nSlivers, nCells); i++)
+    {
+        int iCell = oRandom.below(nCells);
+        while (abSliver[iCell])
+        {
+            iCell = (iCell + 1) % nCells;
+        }
+        abSliver[iCell] = true;
+    }
+
+    int nID = 1;
+    int iCell = 0;
+    for (auto &&poCell : *poCollection->toGeometryCollection())
+    {
+        OGRGeometryUniquePtr poClipped(poCell->Intersection(&oExtent));
+        if (poClipped == nullptr)
+        {
+            continue;
+        }
+
+        OGRErr eErr;
+        if (abSliver[iCell++] && wkbFlatten(poClipped->getGeometryType()) == wkbPolygon)
+        {
+            OGRGeometryUniquePtr poStrip(SliverStrip(poClipped->toPolygon(), CELL_SIZE * SLIVER_WIDTH));
+            if (poStrip == nullptr)
+            {
+                eErr = WritePolygons(poLayer, nID, poClipped.release(), dfMaxSegmentLength);
+            }
+            else
+            {
+                eErr = WritePolygons(poLayer, nID, poClipped->Intersection(poStrip.get()), dfMaxSegmentLength);
+                if (eErr == OGRERR_NONE)
+                {
+                    eErr = WritePolygons(poLayer, nID, poClipped->Difference(poStrip.get()), dfMaxSegmentLength);
+                }
+            }
+        }
+        else
+        {
+            eErr = WritePolygons(poLayer, nID, poClipped.release(), dfMaxSegmentLength);
+        }
+
+        if (eErr != OGRERR_NONE)
+        {
+            return eErr;
+        }
+    }
+
+    return OGRERR_NONE;
+}
+
+static OGRErr GenerateRaster(const GenerateOptions &sOptions, OGRLayer *poLayer)
+{
+    Random oRandom(sOptions.nSeed);
+
+    // One jittered seed per block, with each pixel taking the class of the
+    // nearest seed. The block size sets how ragged, and so how many
+    // vertices, the boundaries are.
+    int nSlivers = static_cast<int>(sOptions.nFeatures * sOptions.dfSliverFraction);
+    int nBlocksPerSide = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(std::max(1, sOptions.nFeatures - nSlivers))))));
+    int nBlockSize = std::max(4, sOptions.nVertices / 4);
+    int nSize = nBlocksPerSide * nBlockSize;
+    double dfPixelSize = CELL_SIZE / nBlockSize;
+
+    std::vector<std::pair<double, double>> aoSeeds;
+    aoSeeds.reserve(static_cast<size_t>(nBlocksPerSide) * nBlocksPerSide);
+    for (int j = 0; j < nBlocksPerSide; j++)
+    {
+        for (int i = 0; i < nBlocksPerSide; i++)
+        {
+            aoSeeds.emplace_back((i + oRandom.uniform()) * nBlockSize, (j + oRandom.uniform()) * nBlockSize);
+        }
+    }
+
+    std::vector<GInt32> anClasses(static_cast<size_t>(nSize) * nSize);
+    for (int y = 0; y < nSize; y++)
+    {
+        int nBlockY = y / nBlockSize;
+        for (int x = 0; x < nSize; x++)
+        {
+            int nBlockX = x / nBlockSize;
+            double dfBest = std::numeric_limits<double>::max();
+            int iBest = 0;
+            for (int j = std::max(0, nBlockY - 1); j <= std::min(nBlocksPerSide - 1, nBlockY + 1); j++)
+            {
+                for (int i = std::max(0, nBlockX - 1); i <= std::min(nBlocksPerSide - 1, nBlockX + 1); i++)
+                {
+                    int iSeed = j * nBlocksPerSide + i;
+                    double dfDistance = std::hypot(x + 0.5 - aoSeeds[iSeed].first, y + 0.5 - aoSeeds[iSeed].second);
+                    if (dfDistance < dfBest)
+                    {
+                        dfBest = dfDistance;
+                        iBest = iSeed;
+                    }
+                }
+            }
+            anClasses[static_cast<size_t>(y) * nSize + x] = iBest + 1;
+        }
+    }
+
+    GInt32 nNextClass = static_cast<GInt32>(aoSeeds.size()) + 1;
+
+    double dfGiantRadius = nSize * GIANT_RADIUS;
+    for (int i = 0; i < sOptions.nGiants; i++)
+    {
+        double dfX = oRandom.uniform() * nSize;
+        double dfY = oRandom.uniform() * nSize;
+        GInt32 nClass = nNextClass++;
+        for (int y = std::max(0, static_cast<int>(dfY - dfGiantRadius)); y < std::min(nSize, static_cast<int>(dfY + dfGiantRadius) + 1); y++)
+        {
+            for (int x = std::max(0, static_cast<int>(dfX - dfGiantRadius)); x < std::min(nSize, static_cast<int>(dfX + dfGiantRadius) + 1); x++)
+            {
+                if (std::hypot(x + 0.5 - dfX, y + 0.5 - dfY) < dfGiantRadius)
+                {
+                    anClasses[static_cast<size_t>(y) * nSize + x] = nClass;
+                }
+            }
+        }
+    }
+
+    // Slivers are one pixel high runs, like the speckle a classifier leaves
+    // along class boundaries.
+    int nSliverLength = std::max(1, nBlockSize / 4);
+    for (int i = 0; i < nSlivers; i++)
+    {
+        int x = oRandom.below(std::max(1, nSize - nSliverLength));
+        int y = oRandom.below(nSize);
+        GInt32 nClass = nNextClass++;
+        for (int k = 0; k < nSliverLength && x + k < nSize; k++)
+        {
+            anClasses[static_cast<size_t>(y) * nSize + x + k] = nClass;
+        }
+    }
+
+    GDALDriver *poMEMDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+    if (poMEMDriver == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unable to find format driver named MEM.");
+        return OGRERR_FAILURE;
+    }
+
+    GDALDatasetUniquePtr poRaster(poMEMDriver->Create("", nSize, nSize, 1, GDT_Int32, nullptr));
+    if (poRaster == nullptr)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    double adfGeoTransform[6] = {0.0, dfPixelSize, 0.0, nSize * dfPixelSize, 0.0, -dfPixelSize};
+    poRaster->SetGeoTransform(adfGeoTransform);
+
+    GDALRasterBand *poBand = poRaster->GetRasterBand(1);
+    if (poBand->RasterIO(GF_Write, 0, 0, nSize, nSize, anClasses.data(), nSize, nSize, GDT_Int32, 0, 0, nullptr) != CE_None)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    if (GDALPolygonize(GDALRasterBand::ToHandle(poBand), nullptr, OGRLayer::ToHandle(poLayer), 0, nullptr, nullptr, nullptr) != CE_None)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
+
+static OGRErr GenerateCmdLineProcessor(int nArgc, char **papszArgv, GenerateOptions *psOptions)
+{
+    for (int i = 1; i < nArgc; ++i)
+    {
+        if (EQUAL(papszArgv[i], "-f") || EQUAL(papszArgv[i], "-format"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->pszFormat = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-type"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            const char *pszType = papszArgv[++i];
+            if (EQUAL(pszType, "voronoi"))
+            {
+                psOptions->bRaster = false;
+            }
+            else if (EQUAL(pszType, "raster"))
+            {
+                psOptions->bRaster = true;
+            }
+            else
+            {
+                PrintUsage(CPLSPrintf("Unknown coverage type '%s'.", pszType));
+                return OGRERR_FAILURE;
+            }
+        }
+        else if (EQUAL(papszArgv[i], "-n"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nFeatures = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-slivers"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->dfSliverFraction = CPLAtofM(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-vertices"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nVertices = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-giants"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nGiants = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-seed"))
+        {
+            if (!HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1))
+            {
+                return OGRERR_FAILURE;
+            }
+            psOptions->nSeed = static_cast<GUIntBig>(CPLAtoGIntBig(papszArgv[++i]));
+        }
+        else if (psOptions->pszDstFilename == nullptr)
+        {
+            psOptions->pszDstFilename = papszArgv[i];
+        }
+        else
+        {
+            PrintUsage("Too many command options.");
+            return OGRERR_FAILURE;
+        }
+    }
+
+    if (psOptions->pszDstFilename == nullptr)
+    {
+        PrintUsage("Missing destination filename.");
+        return OGRERR_FAILURE;
+    }
+
+    if (psOptions->nFeatures <= 0 || psOptions->dfSliverFraction < 0.0 || psOptions->dfSliverFraction >= 1.0 ||
+        psOptions->nVertices <= 0 || psOptions->nGiants < 0)
+    {
+        PrintUsage("Feature and vertex counts must be positive, and the sliver fraction in [0, 1).");
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
+
+MAIN_START(argc, argv)
+{
+    GDALAllRegister();
+
+    int nExitStatus = EXIT_FAILURE;
+
+    char **papszArgv = argv;
+    int nArgc = GDALGeneralCmdLineProcessor(argc, &papszArgv, 0);
+
+    GenerateOptions sOptions = {false, 10000, 0.1, 32, 0, 1, "GPKG", nullptr};
+
+    if (nArgc <= 0)
+    {
+        PrintUsage();
+    }
+    else if (GenerateCmdLineProcessor(nArgc, papszArgv, &sOptions) == OGRERR_NONE)
+    {
+        GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(sOptions.pszFormat);
+        if (poDriver == nullptr)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Unable to find format driver named %s.", sOptions.pszFormat);
+        }
+        else
+        {
+            GDALDatasetUniquePtr poDS(poDriver->Create(sOptions.pszDstFilename, 0, 0, 0, GDT_Unknown, nullptr));
+            OGRLayer *poLayer = poDS != nullptr ? poDS->CreateLayer("coverage", nullptr, wkbPolygon, nullptr) : nullptr;
+            if (poLayer != nullptr)
+            {
+                OGRFieldDefn oField(sOptions.bRaster ? "class" : "id", OFTInteger);
+                poLayer->CreateField(&oField);
+
+                bool bTransaction = poDS->StartTransaction() == OGRERR_NONE;
+                OGRErr eErr = sOptions.bRaster ? GenerateRaster(sOptions, poLayer) : GenerateVoronoi(sOptions, poLayer);
+                if (bTransaction)
+                {
+                    if (eErr == OGRERR_NONE)
+                    {
+                        eErr = poDS->CommitTransaction();
+                    }
+                    else
+                    {
+                        poDS->RollbackTransaction();
+                    }
+                }
+                if (eErr == OGRERR_NONE)
+                {
+                    nExitStatus = EXIT_SUCCESS;
+                }
+            }
+        }
+    }
+
+    if (papszArgv != argv) {
+        CSLDestroy(papszArgv);
+    }
+
+    GDALDestroy();
+
+    return nExitStatus;
+}
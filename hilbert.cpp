@@ -0,0 +1,86 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <numeric>
+
+#include "ogr_geometry.h"
+
+#include "hilbert.h"
+
+static constexpr int HILBERT_ORDER = 16;
+static constexpr double HILBERT_CELLS = 1 << HILBERT_ORDER;
+
+HilbertCurve::HilbertCurve(const OGREnvelope &sExtent) :
+    m_sExtent(sExtent)
+{
+}
+
+GUInt32 HilbertCurve::code(double dfX, double dfY) const
+{
+    double dfWidth = m_sExtent.MaxX - m_sExtent.MinX;
+    double dfHeight = m_sExtent.MaxY - m_sExtent.MinY;
+    double dfU = dfWidth > 0.0 ? (dfX - m_sExtent.MinX) / dfWidth : 0.0;
+    double dfV = dfHeight > 0.0 ? (dfY - m_sExtent.MinY) / dfHeight : 0.0;
+    GUInt32 nX = static_cast<GUInt32>(std::min(HILBERT_CELLS - 1, std::max(0.0, dfU * HILBERT_CELLS)));
+    GUInt32 nY = static_cast<GUInt32>(std::min(HILBERT_CELLS - 1, std::max(0.0, dfV * HILBERT_CELLS)));
+
+    // The usual rotate-and-flip walk from the largest quadrant down.
+    GUInt32 nCode = 0;
+    for (GUInt32 nSide = 1U << (HILBERT_ORDER - 1); nSide > 0; nSide >>= 1)
+    {
+        GUInt32 nRX = (nX & nSide) != 0 ? 1 : 0;
+        GUInt32 nRY = (nY & nSide) != 0 ? 1 : 0;
+        nCode += nSide * nSide * ((3 * nRX) ^ nRY);
+        if (nRY == 0)
+        {
+            if (nRX == 1)
+            {
+                nX = nSide - 1 - (nX & (nSide - 1));
+                nY = nSide - 1 - (nY & (nSide - 1));
+            }
+            std::swap(nX, nY);
+        }
+    }
+    return nCode;
+}
+
+GUInt32 HilbertCurve::code(const OGRGeometry *poGeometry) const
+{
+    if (poGeometry == nullptr || poGeometry->IsEmpty())
+    {
+        return 0;
+    }
+    OGREnvelope sEnvelope;
+    poGeometry->getEnvelope(&sEnvelope);
+    return code((sEnvelope.MinX + sEnvelope.MaxX) / 2.0, (sEnvelope.MinY + sEnvelope.MaxY) / 2.0);
+}
+
+std::vector<size_t> HilbertCurve::order(const std::vector<GUInt32> &anCodes)
+{
+    std::vector<size_t> anOrder(anCodes.size());
+    std::iota(anOrder.begin(), anOrder.end(), 0);
+    std::stable_sort(anOrder.begin(), anOrder.end(), [&anCodes](size_t a, size_t b) { return anCodes[a] < anCodes[b]; });
+    return anOrder;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef HILBERT_H_INCLUDED
+#define HILBERT_H_INCLUDED
+
+#include <vector>
+
+#include "cpl_port.h"
+#include "ogr_core.h"
+
+class OGRGeometry;
+
+// Positions along a Hilbert curve laid over an extent, for putting features
+// that are near each other in space near each other in memory and in the
+// order they are processed. The curve has 2^16 cells a side.
+//
+class HilbertCurve
+{
+    OGREnvelope m_sExtent;
+
+public:
+    explicit HilbertCurve(const OGREnvelope &sExtent);
+
+    // Points outside the extent are clamped to its edge.
+    GUInt32 code(double dfX, double dfY) const;
+
+    // The code of the center of the geometry's envelope, or 0 without one.
+    GUInt32 code(const OGRGeometry *poGeometry) const;
+
+    // The order in which to visit items with these codes: a permutation of
+    // their indices, stable for equal codes.
+    static std::vector<size_t> order(const std::vector<GUInt32> &anCodes);
+};
+
+#endif // HILBERT_H_INCLUDED
@@ -0,0 +1,577 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+// Measures how fast each candidate intermediate format can be written with
+// CopyFeature and read back the way the ingest loops read it, so that the
+// format used between explode and eliminate can be chosen on numbers. The
+// source layer is loaded into memory once, then for each format it is
+// written with and without a transaction, and read back feature by feature
+// and, where GDAL supports it, through the Arrow stream interface.
+//
+// MB/s is the size of the written files over the time taken, so it is
+// comparable between reading and writing but not between formats.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "gdal.h"
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3, 6, 0)
+#include "ogr_recordbatch.h"
+#define IOBENCH_HAVE_ARROW
+#endif
+
+#include "commonutils.h"
+
+
+extern OGRErr CopyFeature(OGRLayer *poDstLayer, const OGRFeature *poSrcFeature, const OGRGeometry *poGeometry);
+
+typedef struct
+{
+    const char *pszDriver;
+    const char *pszExtension;
+} format_t;
+
+static const format_t asFormats[] = {
+    {"GPKG", "gpkg"},
+    {"FlatGeobuf", "fgb"},
+    {"ESRI Shapefile", "shp"},
+    {"Parquet", "parquet"},
+    {"GeoJSON", "geojson"},
+};
+
+class Source
+{
+    OGRFeatureDefn *m_poDefn;
+    OGRSpatialReference *m_poSRS;
+    OGRwkbGeometryType m_eGeomType;
+    std::vector<OGRFeatureUniquePtr> m_apoFeatures;
+
+public:
+    Source() :
+        m_poDefn(nullptr), m_poSRS(nullptr), m_eGeomType(wkbUnknown)
+    {
+    }
+
+    ~Source()
+    {
+        m_apoFeatures.clear();
+        if (m_poDefn != nullptr)
+        {
+            m_poDefn->Release();
+        }
+        if (m_poSRS != nullptr)
+        {
+            m_poSRS->Release();
+        }
+    }
+
+    Source(const Source &) = delete;
+    Source &operator=(const Source &) = delete;
+
+    bool load(OGRLayer *poLayer)
+    {
+        m_poDefn = poLayer->GetLayerDefn();
+        m_poDefn->Reference();
+        if (poLayer->GetSpatialRef() != nullptr)
+        {
+            m_poSRS = poLayer->GetSpatialRef()->Clone();
+        }
+        m_eGeomType = poLayer->GetGeomType();
+
+        poLayer->ResetReading();
+        OGRFeatureUniquePtr poFeature;
+        while ((poFeature = OGRFeatureUniquePtr(poLayer->GetNextFeature())) != nullptr)
+        {
+            m_apoFeatures.push_back(std::move(poFeature));
+        }
+        return !m_apoFeatures.empty();
+    }
+
+    OGRFeatureDefn *defn() const
+    {
+        return m_poDefn;
+    }
+
+    const OGRSpatialReference *srs() const
+    {
+        return m_poSRS;
+    }
+
+    OGRwkbGeometryType geomType() const
+    {
+        return m_eGeomType;
+    }
+
+    const std::vector<OGRFeatureUniquePtr> &features() const
+    {
+        return m_apoFeatures;
+    }
+};
+
+// Keeps the fastest of several rounds, which is the least disturbed by
+// whatever else the machine is doing.
+class Measurement
+{
+    std::chrono::steady_clock::time_point m_tStart;
+    double m_dfBestSeconds;
+    GIntBig m_nFeatures;
+    bool m_bOK;
+
+public:
+    Measurement() :
+        m_dfBestSeconds(-1.0), m_nFeatures(0), m_bOK(true)
+    {
+    }
+
+    void start()
+    {
+        m_tStart = std::chrono::steady_clock::now();
+    }
+
+    void stop(GIntBig nFeatures)
+    {
+        std::chrono::duration<double> dfElapsed = std::chrono::steady_clock::now() - m_tStart;
+        if (m_dfBestSeconds < 0.0 || dfElapsed.count() < m_dfBestSeconds)
+        {
+            m_dfBestSeconds = dfElapsed.count();
+        }
+        m_nFeatures = nFeatures;
+    }
+
+    void fail()
+    {
+        m_bOK = false;
+    }
+
+    bool measured() const
+    {
+        return m_bOK && m_dfBestSeconds >= 0.0;
+    }
+
+    void report(const char *pszDriver, const char *pszPath, GIntBig nBytes, FILE *fpJSON) const
+    {
+        if (!measured())
+        {
+            printf("%-16s %-12s %12s\n", pszDriver, pszPath, "n/a");
+            return;
+        }
+
+        double dfSeconds = std::max(m_dfBestSeconds, 1e-9);
+        double dfFeaturesPerSecond = m_nFeatures / dfSeconds;
+        double dfMBPerSecond = nBytes / dfSeconds / (1024.0 * 1024.0);
+        printf("%-16s %-12s %12" CPL_FRMT_GB_WITHOUT_PREFIX "d %14" CPL_FRMT_GB_WITHOUT_PREFIX "d %10.3f %14.0f %10.1f\n",
+               pszDriver, pszPath, m_nFeatures, nBytes, m_dfBestSeconds, dfFeaturesPerSecond, dfMBPerSecond);
+
+        if (fpJSON != nullptr)
+        {
+            fprintf(fpJSON,
+                    "{\"driver\": \"%s\", \"path\": \"%s\", \"features\": " CPL_FRMT_GIB ", \"bytes\": " CPL_FRMT_GIB
+                    ", \"seconds\": %.6f, \"features_per_second\": %.1f, \"mb_per_second\": %.3f}\n",
+                    pszDriver, pszPath, m_nFeatures, nBytes, m_dfBestSeconds, dfFeaturesPerSecond, dfMBPerSecond);
+        }
+    }
+};
+
+static void PrintUsage(const char *pszErrorMessage = nullptr)
+{
+    std::cerr << "iobench [-formats <driver>[,<driver>]...] [-rounds <n>] [-dir <scratch_directory>] [-json <results_filename>] <src_filename> [-l <src_layer>]" << std::endl;
+    if (pszErrorMessage != nullptr)
+    {
+        std::cerr << "FAILURE: " << pszErrorMessage << std::endl;
+    }
+}
+
+static bool HasEnoughAdditionalArgs(char **papszArgv, int i, int nArgc, int nExtraArgs)
+{
+    if (i + nExtraArgs >= nArgc)
+    {
+        PrintUsage(CPLSPrintf("%s option requires %d argument(s)", papszArgv[i], nExtraArgs));
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
+// Shapefiles and some others are several files, so the size of a written
+// dataset is everything in its directory.
+static GIntBig DirectorySize(const char *pszDirectory)
+{
+    GIntBig nBytes = 0;
+    char **papszFiles = VSIReadDir(pszDirectory);
+    for (char **papszIter = papszFiles; papszIter != nullptr && *papszIter != nullptr; papszIter++)
+    {
+        VSIStatBufL sStat;
+        if (VSIStatL(CPLFormFilename(pszDirectory, *papszIter, nullptr), &sStat) == 0 && !VSI_ISDIR(sStat.st_mode))
+        {
+            nBytes += sStat.st_size;
+        }
+    }
+    CSLDestroy(papszFiles);
+    return nBytes;
+}
+
+static void EmptyDirectory(const char *pszDirectory)
+{
+    char **papszFiles = VSIReadDir(pszDirectory);
+    for (char **papszIter = papszFiles; papszIter != nullptr && *papszIter != nullptr; papszIter++)
+    {
+        if (!EQUAL(*papszIter, ".") && !EQUAL(*papszIter, ".."))
+        {
+            VSIUnlink(CPLFormFilename(pszDirectory, *papszIter, nullptr));
+        }
+    }
+    CSLDestroy(papszFiles);
+}
+
+// Writes every source feature with CopyFeature, as explode and eliminate do,
+// including the time to close the dataset since some drivers only write
+// their index or footer then.
+static bool WriteDataset(GDALDriver *poDriver, const char *pszFilename, const Source &oSource, bool bTransaction, Measurement &oMeasurement)
+{
+    oMeasurement.start();
+
+    GDALDatasetUniquePtr poDS(poDriver->Create(pszFilename, 0, 0, 0, GDT_Unknown, nullptr));
+    if (poDS == nullptr)
+    {
+        return false;
+    }
+
+    OGRLayer *poLayer = poDS->CreateLayer("iobench", oSource.srs(), oSource.geomType(), nullptr);
+    if (poLayer == nullptr)
+    {
+        return false;
+    }
+
+    for (int iField = 0; iField < oSource.defn()->GetFieldCount(); iField++)
+    {
+        if (poLayer->CreateField(oSource.defn()->GetFieldDefn(iField)) != OGRERR_NONE)
+        {
+            return false;
+        }
+    }
+
+    if (bTransaction && poDS->StartTransaction() != OGRERR_NONE)
+    {
+        // No native transactions; only measure the plain path.
+        CPLErrorReset();
+        return false;
+    }
+
+    for (const auto &poFeature : oSource.features())
+    {
+        if (CopyFeature(poLayer, poFeature.get(), poFeature->GetGeometryRef()) != OGRERR_NONE)
+        {
+            return false;
+        }
+    }
+
+    if (bTransaction && poDS->CommitTransaction() != OGRERR_NONE)
+    {
+        return false;
+    }
+
+    poDS.reset();
+    oMeasurement.stop(oSource.features().size());
+    return true;
+}
+
+// Reads the way the ingest loops do, one OGRFeature at a time.
+static bool ReadDataset(const char *pszFilename, Measurement &oMeasurement)
+{
+    oMeasurement.start();
+
+    GDALDatasetUniquePtr poDS(GDALDataset::Open(pszFilename, GDAL_OF_VECTOR | GDAL_OF_READONLY));
+    if (poDS == nullptr || poDS->GetLayerCount() != 1)
+    {
+        return false;
+    }
+
+    OGRLayer *poLayer = poDS->GetLayer(0);
+    GIntBig nFeatures = 0;
+    OGRFeatureUniquePtr poFeature;
+    while ((poFeature = OGRFeatureUniquePtr(poLayer->GetNextFeature())) != nullptr)
+    {
+        nFeatures++;
+    }
+
+    poDS.reset();
+    oMeasurement.stop(nFeatures);
+    return true;
+}
+
+static bool ReadDatasetArrow(const char *pszFilename, Measurement &oMeasurement)
+{
+#ifdef IOBENCH_HAVE_ARROW
+    oMeasurement.start();
+
+    GDALDatasetUniquePtr poDS(GDALDataset::Open(pszFilename, GDAL_OF_VECTOR | GDAL_OF_READONLY));
+    if (poDS == nullptr || poDS->GetLayerCount() != 1)
+    {
+        return false;
+    }
+
+    // Drivers without a native implementation fall back to a generic one
+    // built on GetNextFeature, which is worth knowing but is not the fast
+    // path; it shows up in the table as a read no faster than the plain one.
+    struct ArrowArrayStream sStream;
+    if (!poDS->GetLayer(0)->GetArrowStream(&sStream, nullptr))
+    {
+        return false;
+    }
+
+    GIntBig nFeatures = 0;
+    bool bOK = true;
+    while (true)
+    {
+        struct ArrowArray sArray;
+        if (sStream.get_next(&sStream, &sArray) != 0)
+        {
+            bOK = false;
+            break;
+        }
+        if (sArray.release == nullptr)
+        {
+            break;
+        }
+        nFeatures += sArray.length;
+        sArray.release(&sArray);
+    }
+    sStream.release(&sStream);
+
+    poDS.reset();
+    if (bOK)
+    {
+        oMeasurement.stop(nFeatures);
+    }
+    return bOK;
+#else
+    (void)pszFilename;
+    (void)oMeasurement;
+    return false;
+#endif
+}
+
+static void RunFormat(const format_t &sFormat, const Source &oSource, const char *pszScratchDir, int nRounds, FILE *fpJSON)
+{
+    GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(sFormat.pszDriver);
+    if (poDriver == nullptr)
+    {
+        printf("%-16s %-12s %12s\n", sFormat.pszDriver, "", "not available");
+        return;
+    }
+
+    CPLString osDirectory = CPLFormFilename(pszScratchDir, CPLString(sFormat.pszExtension), nullptr);
+    VSIMkdir(osDirectory, 0755);
+    CPLString osFilename = CPLFormFilename(osDirectory, "iobench", sFormat.pszExtension);
+
+    Measurement oWrite, oWriteTransaction, oRead, oReadArrow;
+    GIntBig nBytes = 0;
+
+    for (int iRound = 0; iRound < nRounds; iRound++)
+    {
+        EmptyDirectory(osDirectory);
+        if (oWriteTransaction.measured() || iRound == 0)
+        {
+            CPLPushErrorHandler(CPLQuietErrorHandler);
+            bool bOK = WriteDataset(poDriver, osFilename, oSource, true, oWriteTransaction);
+            CPLPopErrorHandler();
+            if (!bOK)
+            {
+                oWriteTransaction.fail();
+            }
+            EmptyDirectory(osDirectory);
+        }
+
+        if (!WriteDataset(poDriver, osFilename, oSource, false, oWrite))
+        {
+            oWrite.fail();
+            break;
+        }
+        nBytes = DirectorySize(osDirectory);
+
+        if (!ReadDataset(osFilename, oRead))
+        {
+            oRead.fail();
+        }
+
+        if (oReadArrow.measured() || iRound == 0)
+        {
+            if (!ReadDatasetArrow(osFilename, oReadArrow))
+            {
+                oReadArrow.fail();
+            }
+        }
+    }
+
+    EmptyDirectory(osDirectory);
+    VSIRmdir(osDirectory);
+
+    oWrite.report(sFormat.pszDriver, "write", nBytes, fpJSON);
+    oWriteTransaction.report(sFormat.pszDriver, "write+txn", nBytes, fpJSON);
+    oRead.report(sFormat.pszDriver, "read", nBytes, fpJSON);
+    oReadArrow.report(sFormat.pszDriver, "read+arrow", nBytes, fpJSON);
+}
+
+MAIN_START(argc, argv)
+{
+    GDALAllRegister();
+
+    int nExitStatus = EXIT_FAILURE;
+
+    char **papszArgv = argv;
+    int nArgc = GDALGeneralCmdLineProcessor(argc, &papszArgv, 0);
+
+    const char *pszSrcFilename = nullptr;
+    const char *pszSrcLayerName = nullptr;
+    const char *pszScratchDir = nullptr;
+    const char *pszJSONFilename = nullptr;
+    char **papszFormats = nullptr;
+    int nRounds = 3;
+    bool bOK = nArgc > 0;
+
+    for (int i = 1; bOK && i < nArgc; ++i)
+    {
+        if (EQUAL(papszArgv[i], "-formats") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            papszFormats = CSLTokenizeString2(papszArgv[++i], ",", 0);
+        }
+        else if (EQUAL(papszArgv[i], "-rounds") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            nRounds = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-dir") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            pszScratchDir = papszArgv[++i];
+        }
+        else if (EQUAL(papszArgv[i], "-json") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            pszJSONFilename = papszArgv[++i];
+        }
+        else if ((EQUAL(papszArgv[i], "-l") || EQUAL(papszArgv[i], "-layer")) && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            pszSrcLayerName = papszArgv[++i];
+        }
+        else if (bOK && pszSrcFilename == nullptr)
+        {
+            pszSrcFilename = papszArgv[i];
+        }
+        else if (bOK)
+        {
+            PrintUsage("Too many command options.");
+            bOK = false;
+        }
+    }
+
+    if (bOK && pszSrcFilename == nullptr)
+    {
+        PrintUsage("Missing source filename.");
+        bOK = false;
+    }
+
+    if (bOK && nRounds < 1)
+    {
+        PrintUsage("Rounds must be at least 1.");
+        bOK = false;
+    }
+
+    GDALDatasetUniquePtr poSrcDS;
+    OGRLayer *poSrcLayer = nullptr;
+    if (bOK)
+    {
+        poSrcDS.reset(GDALDataset::Open(pszSrcFilename, GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR));
+        if (poSrcDS != nullptr)
+        {
+            poSrcLayer = pszSrcLayerName != nullptr ? poSrcDS->GetLayerByName(pszSrcLayerName) :
+                         poSrcDS->GetLayerCount() == 1 ? poSrcDS->GetLayer(0) : nullptr;
+            if (poSrcLayer == nullptr)
+            {
+                CPLError(CE_Failure, CPLE_AppDefined, "Source layer must be specified and exist.");
+            }
+        }
+    }
+
+    Source oSource;
+    if (poSrcLayer != nullptr && !oSource.load(poSrcLayer))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Source layer is empty.");
+        poSrcLayer = nullptr;
+    }
+    poSrcDS.reset();
+
+    FILE *fpJSON = nullptr;
+    if (poSrcLayer != nullptr && pszJSONFilename != nullptr)
+    {
+        fpJSON = fopen(pszJSONFilename, "a");
+        if (fpJSON == nullptr)
+        {
+            CPLError(CE_Failure, CPLE_FileIO, "Unable to open %s.", pszJSONFilename);
+            poSrcLayer = nullptr;
+        }
+    }
+
+    if (poSrcLayer != nullptr)
+    {
+        CPLString osScratchDir = pszScratchDir != nullptr ? CPLString(pszScratchDir) : CPLString(CPLGenerateTempFilename("iobench"));
+        VSIMkdir(osScratchDir, 0755);
+
+        printf("%zu features, best of %d rounds, scratch directory %s\n", oSource.features().size(), nRounds, osScratchDir.c_str());
+        printf("%-16s %-12s %12s %14s %10s %14s %10s\n", "driver", "path", "features", "bytes", "seconds", "features/s", "MB/s");
+
+        for (const format_t &sFormat : asFormats)
+        {
+            if (papszFormats == nullptr || CSLFindString(papszFormats, sFormat.pszDriver) >= 0)
+            {
+                RunFormat(sFormat, oSource, osScratchDir, nRounds, fpJSON);
+            }
+        }
+
+        if (pszScratchDir == nullptr)
+        {
+            VSIRmdir(osScratchDir);
+        }
+        nExitStatus = EXIT_SUCCESS;
+    }
+
+    if (fpJSON != nullptr)
+    {
+        fclose(fpJSON);
+    }
+    CSLDestroy(papszFormats);
+
+    if (papszArgv != argv) {
+        CSLDestroy(papszArgv);
+    }
+
+    GDALDestroy();
+
+    return nExitStatus;
+}
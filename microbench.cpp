@@ -0,0 +1,512 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+// Times the hot FeatureCreature operations one at a time on fixed fixtures,
+// reporting nanoseconds and allocations per operation, so that a change to
+// one kernel or to the data layout can be measured on its own. The fixture
+// is a grid of squares whose sides are densified to the requested vertex
+// count, so every interior square has four edge and four corner neighbors.
+//
+// Allocations are counted by replacing the global operator new, so they
+// cover GEOS and the standard library but not CPLMalloc.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <new>
+#include <vector>
+
+#include "gdal.h"
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "geos_c.h"
+
+#include "commonutils.h"
+#include "diagnostics.h"
+#include "featurecreature.h"
+
+
+extern OGRErr CopyFeature(OGRLayer *poDstLayer, const OGRFeature *poSrcFeature, const OGRGeometry *poGeometry);
+
+static GIntBig gnAllocations = 0;
+
+void *operator new(size_t nSize)
+{
+    gnAllocations++;
+    void *p = malloc(nSize == 0 ? 1 : nSize);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t nSize)
+{
+    return operator new(nSize);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// Accumulates the time and allocations of the timed sections only, so the
+// setup for each round isn't charged to the operation.
+class Measurement
+{
+    std::chrono::steady_clock::time_point m_tStart;
+    GIntBig m_nAllocationsStart;
+    double m_dfNanoseconds;
+    GIntBig m_nAllocations;
+    GIntBig m_nOperations;
+
+public:
+    Measurement() :
+        m_nAllocationsStart(0), m_dfNanoseconds(0.0), m_nAllocations(0), m_nOperations(0)
+    {
+    }
+
+    void start()
+    {
+        m_nAllocationsStart = gnAllocations;
+        m_tStart = std::chrono::steady_clock::now();
+    }
+
+    void stop(GIntBig nOperations)
+    {
+        std::chrono::duration<double, std::nano> dfElapsed = std::chrono::steady_clock::now() - m_tStart;
+        m_dfNanoseconds += dfElapsed.count();
+        m_nAllocations += gnAllocations - m_nAllocationsStart;
+        m_nOperations += nOperations;
+    }
+
+    void report(const char *pszName) const
+    {
+        double dfOperations = static_cast<double>(std::max<GIntBig>(1, m_nOperations));
+        printf("%-24s %12" CPL_FRMT_GB_WITHOUT_PREFIX "d ops %12.1f ns/op %10.2f allocs/op\n",
+               pszName, m_nOperations, m_dfNanoseconds / dfOperations, m_nAllocations / dfOperations);
+    }
+};
+
+class Fixture
+{
+    int m_nSide;
+    OGRFeatureDefn *m_poDefn;
+    std::vector<OGRFeatureUniquePtr> m_apoFeatures;
+
+public:
+    Fixture(int nSide, int nVertices) :
+        m_nSide(nSide), m_poDefn(new OGRFeatureDefn("fixture"))
+    {
+        m_poDefn->Reference();
+        OGRFieldDefn oField("id", OFTInteger);
+        m_poDefn->AddFieldDefn(&oField);
+
+        // Each side gets the same evenly spaced vertices, so the shared
+        // edges of neighbors match exactly.
+        int nPerSide = std::max(1, nVertices / 4);
+        for (int j = 0; j < nSide; j++)
+        {
+            for (int i = 0; i < nSide; i++)
+            {
+                double adfX[4] = {double(i), double(i + 1), double(i + 1), double(i)};
+                double adfY[4] = {double(j), double(j), double(j + 1), double(j + 1)};
+                OGRLinearRing *poRing = new OGRLinearRing();
+                for (int k = 0; k < 4; k++)
+                {
+                    for (int m = 0; m < nPerSide; m++)
+                    {
+                        double t = static_cast<double>(m) / nPerSide;
+                        poRing->addPoint(adfX[k] + (adfX[(k + 1) % 4] - adfX[k]) * t,
+                                         adfY[k] + (adfY[(k + 1) % 4] - adfY[k]) * t);
+                    }
+                }
+                poRing->closeRings();
+                OGRPolygon *poPolygon = new OGRPolygon();
+                poPolygon->addRingDirectly(poRing);
+
+                OGRFeatureUniquePtr poFeature(OGRFeature::CreateFeature(m_poDefn));
+                poFeature->SetFID(static_cast<GIntBig>(j) * nSide + i);
+                poFeature->SetField(0, j * nSide + i);
+                poFeature->SetGeometryDirectly(poPolygon);
+                m_apoFeatures.push_back(std::move(poFeature));
+            }
+        }
+    }
+
+    ~Fixture()
+    {
+        m_apoFeatures.clear();
+        m_poDefn->Release();
+    }
+
+    Fixture(const Fixture &) = delete;
+    Fixture &operator=(const Fixture &) = delete;
+
+    int side() const
+    {
+        return m_nSide;
+    }
+
+    OGRFeatureDefn *defn() const
+    {
+        return m_poDefn;
+    }
+
+    const std::vector<OGRFeatureUniquePtr> &features() const
+    {
+        return m_apoFeatures;
+    }
+
+    // Fresh creatures, so that nothing cached by a previous round is reused.
+    void createCreatures(std::list<FeatureCreature> &lstCreatures, GEOSContextHandle_t hGEOSCtxt, Diagnostics *poDiagnostics) const
+    {
+        lstCreatures.clear();
+        for (const auto &poFeature : m_apoFeatures)
+        {
+            lstCreatures.emplace_back(OGRFeatureUniquePtr(poFeature->Clone()), hGEOSCtxt, poDiagnostics);
+        }
+    }
+};
+
+static void PrintUsage(const char *pszErrorMessage = nullptr)
+{
+    std::cerr << "microbench [-side <n>] [-vertices <n>] [-rounds <n>] [-only <benchmark>]" << std::endl;
+    if (pszErrorMessage != nullptr)
+    {
+        std::cerr << "FAILURE: " << pszErrorMessage << std::endl;
+    }
+}
+
+static bool HasEnoughAdditionalArgs(char **papszArgv, int i, int nArgc, int nExtraArgs)
+{
+    if (i + nExtraArgs >= nArgc)
+    {
+        PrintUsage(CPLSPrintf("%s option requires %d argument(s)", papszArgv[i], nExtraArgs));
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
+static void RunBenchmarks(const Fixture &oFixture, int nRounds, const char *pszOnly)
+{
+    GEOSContextHandle_t hGEOSCtxt = OGRGeometry::createGEOSContext();
+    Diagnostics oDiagnostics;
+    StatsCollector oStats(false);
+    ReproCapture oRepro(nullptr, ReproCapture::DEFAULT_THRESHOLD, 0);
+    int nSide = oFixture.side();
+
+    auto wanted = [pszOnly](const char *pszName) {
+        return pszOnly == nullptr || EQUAL(pszOnly, pszName);
+    };
+
+    // The creatures by grid position, for finding neighbors.
+    auto grid = [](std::list<FeatureCreature> &lstCreatures) {
+        std::vector<FeatureCreature *> apoGrid;
+        for (auto &oCreature : lstCreatures)
+        {
+            apoGrid.push_back(&oCreature);
+        }
+        return apoGrid;
+    };
+
+    std::list<FeatureCreature> lstCreatures;
+
+    if (wanted("initGeometry"))
+    {
+        Measurement oMeasurement;
+        for (int iRound = 0; iRound < nRounds; iRound++)
+        {
+            oFixture.createCreatures(lstCreatures, hGEOSCtxt, &oDiagnostics);
+            oMeasurement.start();
+            for (auto &oCreature : lstCreatures)
+            {
+                oCreature.initGeometry();
+            }
+            oMeasurement.stop(lstCreatures.size());
+        }
+        oMeasurement.report("initGeometry");
+    }
+
+    if (wanted("area"))
+    {
+        Measurement oMeasurement;
+        for (int iRound = 0; iRound < nRounds; iRound++)
+        {
+            oFixture.createCreatures(lstCreatures, hGEOSCtxt, &oDiagnostics);
+            for (auto &oCreature : lstCreatures)
+            {
+                oCreature.initGeometry();
+            }
+            oMeasurement.start();
+            for (auto &oCreature : lstCreatures)
+            {
+                oCreature.area();
+            }
+            oMeasurement.stop(lstCreatures.size());
+        }
+        oMeasurement.report("area");
+    }
+
+    if (wanted("addNeighborIfTouching") || wanted("findNeighbor"))
+    {
+        Measurement oTouching;
+        Measurement oFind;
+        for (int iRound = 0; iRound < nRounds; iRound++)
+        {
+            oFixture.createCreatures(lstCreatures, hGEOSCtxt, &oDiagnostics);
+            for (auto &oCreature : lstCreatures)
+            {
+                oCreature.initPreparedGeometry();
+            }
+            std::vector<FeatureCreature *> apoGrid = grid(lstCreatures);
+
+            GIntBig nPairs = 0;
+            oTouching.start();
+            for (int j = 1; j + 1 < nSide; j++)
+            {
+                for (int i = 1; i + 1 < nSide; i++)
+                {
+                    FeatureCreature *poCreature = apoGrid[j * nSide + i];
+                    for (int dj = -1; dj <= 1; dj++)
+                    {
+                        for (int di = -1; di <= 1; di++)
+                        {
+                            if (di != 0 || dj != 0)
+                            {
+                                poCreature->addNeighborIfTouching(apoGrid[(j + dj) * nSide + i + di], hGEOSCtxt, oStats, oRepro);
+                                nPairs++;
+                            }
+                        }
+                    }
+                }
+            }
+            oTouching.stop(nPairs);
+
+            // Area is cached first so that only the selection is timed.
+            for (auto &oCreature : lstCreatures)
+            {
+                oCreature.area();
+            }
+
+            GIntBig nFinds = 0;
+            oFind.start();
+            for (int j = 1; j + 1 < nSide; j++)
+            {
+                for (int i = 1; i + 1 < nSide; i++)
+                {
+                    for (EliminateMergeType eMergeType : {ELIMINATE_MERGE_LARGEST_AREA, ELIMINATE_MERGE_SMALLEST_AREA, ELIMINATE_MERGE_LONGEST_BOUNDARY})
+                    {
+                        apoGrid[j * nSide + i]->findNeighbor(eMergeType);
+                        nFinds++;
+                    }
+                }
+            }
+            oFind.stop(nFinds);
+        }
+        if (wanted("addNeighborIfTouching"))
+        {
+            oTouching.report("addNeighborIfTouching");
+        }
+        if (wanted("findNeighbor"))
+        {
+            oFind.report("findNeighbor");
+        }
+    }
+
+    if (wanted("query"))
+    {
+        oFixture.createCreatures(lstCreatures, hGEOSCtxt, &oDiagnostics);
+        GEOSSTRtree *poSTRTree = GEOSSTRtree_create_r(hGEOSCtxt, 10);
+        for (auto &oCreature : lstCreatures)
+        {
+            GEOSSTRtree_insert_r(hGEOSCtxt, poSTRTree, oCreature.geometry(), &oCreature);
+        }
+
+        Measurement oMeasurement;
+        std::list<FeatureCreature *> lstpoNeighbors;
+        for (int iRound = 0; iRound < nRounds; iRound++)
+        {
+            oMeasurement.start();
+            for (auto &oCreature : lstCreatures)
+            {
+                lstpoNeighbors.clear();
+                FeatureCreature::query_t query = {&oCreature, &lstpoNeighbors};
+                GEOSSTRtree_query_r(hGEOSCtxt, poSTRTree, oCreature.geometry(), FeatureCreature::query_t::callback, &query);
+            }
+            oMeasurement.stop(lstCreatures.size());
+        }
+        oMeasurement.report("query");
+
+        GEOSSTRtree_destroy_r(hGEOSCtxt, poSTRTree);
+    }
+
+    if (wanted("union"))
+    {
+        oFixture.createCreatures(lstCreatures, hGEOSCtxt, &oDiagnostics);
+        std::vector<FeatureCreature *> apoGrid = grid(lstCreatures);
+
+        // Each interior square with its four edge neighbors, the shape of a
+        // typical merge group.
+        Measurement oMeasurement;
+        for (int iRound = 0; iRound < nRounds; iRound++)
+        {
+            GIntBig nGroups = 0;
+            oMeasurement.start();
+            for (int j = 1; j + 1 < nSide; j += 3)
+            {
+                for (int i = 1; i + 1 < nSide; i += 3)
+                {
+                    std::list<FeatureCreature *> lstpoGroup = {
+                        apoGrid[(j - 1) * nSide + i], apoGrid[(j + 1) * nSide + i],
+                        apoGrid[j * nSide + i - 1], apoGrid[j * nSide + i + 1]};
+                    GEOSGeometry *poUnion = apoGrid[j * nSide + i]->unionWith(lstpoGroup, oStats, oRepro);
+                    GEOSGeom_destroy_r(hGEOSCtxt, poUnion);
+                    nGroups++;
+                }
+            }
+            oMeasurement.stop(nGroups);
+        }
+        oMeasurement.report("union");
+    }
+
+    if (wanted("CopyFeature"))
+    {
+        GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("Memory");
+        if (poDriver == nullptr)
+        {
+            poDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+        }
+        GDALDatasetUniquePtr poDS(poDriver != nullptr ? poDriver->Create("", 0, 0, 0, GDT_Unknown, nullptr) : nullptr);
+        OGRLayer *poLayer = poDS != nullptr ? poDS->CreateLayer("copy", nullptr, wkbPolygon, nullptr) : nullptr;
+        if (poLayer == nullptr)
+        {
+            CPLError(CE_Warning, CPLE_AppDefined, "No in-memory vector driver; skipping CopyFeature.");
+        }
+        else
+        {
+            poLayer->CreateField(oFixture.defn()->GetFieldDefn(0));
+
+            Measurement oMeasurement;
+            for (int iRound = 0; iRound < nRounds; iRound++)
+            {
+                oMeasurement.start();
+                for (const auto &poFeature : oFixture.features())
+                {
+                    CopyFeature(poLayer, poFeature.get(), poFeature->GetGeometryRef());
+                }
+                oMeasurement.stop(oFixture.features().size());
+            }
+            oMeasurement.report("CopyFeature");
+        }
+    }
+
+    lstCreatures.clear();
+    OGRGeometry::freeGEOSContext(hGEOSCtxt);
+}
+
+MAIN_START(argc, argv)
+{
+    GDALAllRegister();
+
+    int nExitStatus = EXIT_FAILURE;
+
+    char **papszArgv = argv;
+    int nArgc = GDALGeneralCmdLineProcessor(argc, &papszArgv, 0);
+
+    int nSide = 32;
+    int nVertices = 64;
+    int nRounds = 20;
+    const char *pszOnly = nullptr;
+    bool bOK = nArgc > 0;
+
+    for (int i = 1; bOK && i < nArgc; ++i)
+    {
+        if (EQUAL(papszArgv[i], "-side") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            nSide = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-vertices") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            nVertices = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-rounds") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            nRounds = atoi(papszArgv[++i]);
+        }
+        else if (EQUAL(papszArgv[i], "-only") && (bOK = HasEnoughAdditionalArgs(papszArgv, i, nArgc, 1)))
+        {
+            pszOnly = papszArgv[++i];
+        }
+        else if (bOK)
+        {
+            PrintUsage(CPLSPrintf("Unknown option %s.", papszArgv[i]));
+            bOK = false;
+        }
+    }
+
+    if (bOK && (nSide < 3 || nVertices < 4 || nRounds < 1))
+    {
+        PrintUsage("The side must be at least 3, vertices at least 4 and rounds at least 1.");
+        bOK = false;
+    }
+
+    if (bOK)
+    {
+        Fixture oFixture(nSide, nVertices);
+        printf("%d x %d squares of %d vertices, %d rounds\n", nSide, nSide, nVertices, nRounds);
+        RunBenchmarks(oFixture, nRounds, pszOnly);
+        nExitStatus = EXIT_SUCCESS;
+    }
+
+    if (papszArgv != argv) {
+        CSLDestroy(papszArgv);
+    }
+
+    GDALDestroy();
+
+    return nExitStatus;
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "cpl_error.h"
+
+#include "perfcounters.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int OpenCounter(unsigned int nType, unsigned long long nConfig)
+{
+    struct perf_event_attr sAttr;
+    memset(&sAttr, 0, sizeof(sAttr));
+    sAttr.size = sizeof(sAttr);
+    sAttr.type = nType;
+    sAttr.config = nConfig;
+    sAttr.disabled = 1;
+    // User space only, so that the default perf_event_paranoid level of 2
+    // still lets us in.
+    sAttr.exclude_kernel = 1;
+    sAttr.exclude_hv = 1;
+    // Follow the threads started after the counter is opened, so that the
+    // NEIGHBORS workers are counted too. Their counts are added in when
+    // they exit, which they have by the time the stage is read.
+    sAttr.inherit = 1;
+    sAttr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &sAttr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters(bool bEnabled) :
+    m_bAvailable(false)
+{
+    for (int &nFD : m_anFD)
+    {
+        nFD = -1;
+    }
+
+    if (!bEnabled)
+    {
+        return;
+    }
+
+    m_anFD[CYCLES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    m_anFD[INSTRUCTIONS] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    m_anFD[CACHE_MISSES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    m_anFD[BRANCH_MISSES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+    for (int nFD : m_anFD)
+    {
+        m_bAvailable |= nFD >= 0;
+    }
+
+    if (!m_bAvailable)
+    {
+        CPLDebug("ELIMINATE", "Hardware performance counters unavailable: %s", strerror(errno));
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int nFD : m_anFD)
+    {
+        if (nFD >= 0)
+        {
+            close(nFD);
+        }
+    }
+}
+
+void PerfCounters::start()
+{
+    for (int nFD : m_anFD)
+    {
+        if (nFD >= 0)
+        {
+            ioctl(nFD, PERF_EVENT_IOC_RESET, 0);
+            ioctl(nFD, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop(EliminateCounterStats &sCounters)
+{
+    GIntBig *apnCounts[COUNTER_COUNT] = {
+        &sCounters.nCycles,
+        &sCounters.nInstructions,
+        &sCounters.nCacheMisses,
+        &sCounters.nBranchMisses,
+    };
+
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        int nFD = m_anFD[i];
+        if (nFD < 0)
+        {
+            continue;
+        }
+
+        ioctl(nFD, PERF_EVENT_IOC_DISABLE, 0);
+
+        // value, time enabled, time running
+        unsigned long long anValues[3];
+        if (read(nFD, anValues, sizeof(anValues)) != sizeof(anValues) || anValues[2] == 0)
+        {
+            continue;
+        }
+
+        // Scale up if the kernel had to multiplex the counter.
+        double dfCount = static_cast<double>(anValues[0]);
+        if (anValues[2] < anValues[1])
+        {
+            dfCount *= static_cast<double>(anValues[1]) / anValues[2];
+        }
+
+        if (*apnCounts[i] < 0)
+        {
+            *apnCounts[i] = 0;
+        }
+        *apnCounts[i] += static_cast<GIntBig>(dfCount);
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters(bool bEnabled) :
+    m_bAvailable(false)
+{
+    for (int &nFD : m_anFD)
+    {
+        nFD = -1;
+    }
+
+    if (bEnabled)
+    {
+        CPLDebug("ELIMINATE", "Hardware performance counters are only supported on Linux.");
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::start()
+{
+}
+
+void PerfCounters::stop(EliminateCounterStats &)
+{
+}
+
+#endif
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef PERFCOUNTERS_H_INCLUDED
+#define PERFCOUNTERS_H_INCLUDED
+
+#include "stats.h"
+
+// Hardware counters for the calling thread and the threads it starts after
+// construction, read through perf_event_open on Linux. Counters the kernel
+// or the machine won't give us are reported as -1, and everywhere else all
+// of them are; nothing here is an error.
+//
+class PerfCounters
+{
+    enum
+    {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT
+    };
+
+    int m_anFD[COUNTER_COUNT];
+    bool m_bAvailable;
+
+public:
+    explicit PerfCounters(bool bEnabled);
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const
+    {
+        return m_bAvailable;
+    }
+
+    void start();
+
+    // Adds the counts since start() to the stage.
+    void stop(EliminateCounterStats &sCounters);
+
+    // Times a stage from construction to destruction.
+    class Scope
+    {
+        PerfCounters &m_oCounters;
+        EliminateCounterStats &m_sCounters;
+
+    public:
+        Scope(PerfCounters &oCounters, EliminateCounterStats &sCounters) :
+            m_oCounters(oCounters), m_sCounters(sCounters)
+        {
+            m_oCounters.start();
+        }
+
+        ~Scope()
+        {
+            m_oCounters.stop(m_sCounters);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+};
+
+#endif // PERFCOUNTERS_H_INCLUDED
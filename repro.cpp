@@ -0,0 +1,241 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "repro.h"
+
+
+ReproCapture::ReproCapture(const char *pszDirectory, double dfThreshold, int nMaxCaptures) :
+    m_dfThreshold(dfThreshold), m_nMaxCaptures(nMaxCaptures), m_nCaptures(0)
+{
+    if (pszDirectory != nullptr)
+    {
+        m_osDirectory = pszDirectory;
+        VSIStatBufL sStat;
+        if (VSIStatL(pszDirectory, &sStat) != 0 && VSIMkdirRecursive(pszDirectory, 0755) != 0)
+        {
+            CPLError(CE_Warning, CPLE_FileIO, "Cannot create %s; GEOS reproducers will not be captured.", pszDirectory);
+            m_osDirectory.clear();
+        }
+    }
+}
+
+void ReproCapture::write(GEOSContextHandle_t hGEOSCtxt, const char *pszOperation, GIntBig nFID, bool bFailed,
+                         double dfSeconds, std::initializer_list<const GEOSGeometry *> apoInputs)
+{
+    int nCapture = m_nCaptures.fetch_add(1, std::memory_order_relaxed);
+    if (nCapture >= m_nMaxCaptures)
+    {
+        if (nCapture == m_nMaxCaptures)
+        {
+            CPLError(CE_Warning, CPLE_AppDefined, "Captured %d GEOS reproducers; not capturing any more.", m_nMaxCaptures);
+        }
+        return;
+    }
+
+    CPLString osName = CPLSPrintf("%s_" CPL_FRMT_GIB "_%d", pszOperation, nFID, nCapture);
+    CPLString osFilename = CPLFormFilename(m_osDirectory.c_str(), osName, "txt");
+
+    VSILFILE *fp = VSIFOpenL(osFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Warning, CPLE_FileIO, "Cannot create %s.", osFilename.c_str());
+        return;
+    }
+
+    bool bOK = VSIFPrintfL(fp, "OPERATION=%s\nFID=" CPL_FRMT_GIB "\nSTATUS=%s\nSECONDS=%.6f\n",
+                           pszOperation, nFID, bFailed ? "failed" : "slow", dfSeconds) > 0;
+
+    GEOSWKBWriter *poWriter = GEOSWKBWriter_create_r(hGEOSCtxt);
+    GEOSWKBWriter_setOutputDimension_r(hGEOSCtxt, poWriter, 3);
+    for (const GEOSGeometry *poInput : apoInputs)
+    {
+        size_t nSize = 0;
+        unsigned char *pabyWKB = poInput != nullptr ? GEOSWKBWriter_write_r(hGEOSCtxt, poWriter, poInput, &nSize) : nullptr;
+        if (pabyWKB == nullptr)
+        {
+            bOK = false;
+            continue;
+        }
+        char *pszHex = CPLBinaryToHex(static_cast<int>(nSize), pabyWKB);
+        bOK &= VSIFPrintfL(fp, "WKB=%s\n", pszHex) > 0;
+        CPLFree(pszHex);
+        GEOSFree_r(hGEOSCtxt, pabyWKB);
+    }
+    GEOSWKBWriter_destroy_r(hGEOSCtxt, poWriter);
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Warning, CPLE_FileIO, "Failed writing %s.", osFilename.c_str());
+    }
+}
+
+// Runs one iteration, returning false if GEOS failed.
+static bool RunOperation(GEOSContextHandle_t hGEOSCtxt, const CPLString &osOperation, const std::vector<GEOSGeometry *> &apoInputs,
+                         const GEOSPreparedGeometry *poPrepared)
+{
+    if (osOperation == "touches")
+    {
+        return GEOSPreparedTouches_r(hGEOSCtxt, poPrepared, apoInputs[1]) != 2;
+    }
+    else if (osOperation == "intersection")
+    {
+        GEOSGeometry *poResult = GEOSIntersection_r(hGEOSCtxt, apoInputs[0], apoInputs[1]);
+        double dfLength = 0.0;
+        bool bOK = poResult != nullptr && GEOSLength_r(hGEOSCtxt, poResult, &dfLength) == 1;
+        if (poResult != nullptr)
+        {
+            GEOSGeom_destroy_r(hGEOSCtxt, poResult);
+        }
+        return bOK;
+    }
+    else if (apoInputs.size() == 1)
+    {
+        GEOSGeometry *poResult = GEOSUnaryUnion_r(hGEOSCtxt, apoInputs[0]);
+        bool bOK = poResult != nullptr;
+        if (poResult != nullptr)
+        {
+            GEOSGeom_destroy_r(hGEOSCtxt, poResult);
+        }
+        return bOK;
+    }
+    else
+    {
+        // Clone the geometries because the collection assumes ownership.
+        std::vector<GEOSGeometry *> vecGeometries;
+        for (GEOSGeometry *poInput : apoInputs)
+        {
+            vecGeometries.push_back(GEOSGeom_clone_r(hGEOSCtxt, poInput));
+        }
+        GEOSGeometry *poCollection = GEOSGeom_createCollection_r(hGEOSCtxt, GEOS_MULTIPOLYGON, vecGeometries.data(), vecGeometries.size());
+        GEOSGeometry *poResult = GEOSUnaryUnion_r(hGEOSCtxt, poCollection);
+        bool bOK = poResult != nullptr;
+        if (poResult != nullptr)
+        {
+            GEOSGeom_destroy_r(hGEOSCtxt, poResult);
+        }
+        GEOSGeom_destroy_r(hGEOSCtxt, poCollection);
+        return bOK;
+    }
+}
+
+bool ReplayReproducer(const char *pszFilename, int nIterations, std::string &osOperation, std::vector<double> &adfSeconds)
+{
+    char **papszLines = CSLLoad(pszFilename);
+    if (papszLines == nullptr)
+    {
+        return false;
+    }
+
+    GEOSContextHandle_t hGEOSCtxt = GEOS_init_r();
+    GEOSWKBReader *poReader = GEOSWKBReader_create_r(hGEOSCtxt);
+    std::vector<GEOSGeometry *> apoInputs;
+    bool bOK = true;
+
+    for (int i = 0; papszLines[i] != nullptr; i++)
+    {
+        char *pszKey = nullptr;
+        const char *pszValue = CPLParseNameValue(papszLines[i], &pszKey);
+        if (pszKey == nullptr || pszValue == nullptr)
+        {
+            CPLFree(pszKey);
+            continue;
+        }
+        if (EQUAL(pszKey, "OPERATION"))
+        {
+            osOperation = pszValue;
+        }
+        else if (EQUAL(pszKey, "WKB"))
+        {
+            int nSize = 0;
+            GByte *pabyWKB = CPLHexToBinary(pszValue, &nSize);
+            GEOSGeometry *poGeom = GEOSWKBReader_read_r(hGEOSCtxt, poReader, pabyWKB, nSize);
+            CPLFree(pabyWKB);
+            if (poGeom == nullptr)
+            {
+                CPLError(CE_Failure, CPLE_AppDefined, "%s: invalid WKB on line %d.", pszFilename, i + 1);
+                bOK = false;
+            }
+            else
+            {
+                apoInputs.push_back(poGeom);
+            }
+        }
+        CPLFree(pszKey);
+    }
+    CSLDestroy(papszLines);
+
+    size_t nRequiredInputs = osOperation == "union" ? 1 : 2;
+    if (bOK && (osOperation != "touches" && osOperation != "intersection" && osOperation != "union"))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "%s: unknown operation '%s'.", pszFilename, osOperation.c_str());
+        bOK = false;
+    }
+    else if (bOK && apoInputs.size() < nRequiredInputs)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "%s: %s needs at least %d input geometries.",
+                 pszFilename, osOperation.c_str(), static_cast<int>(nRequiredInputs));
+        bOK = false;
+    }
+
+    if (bOK)
+    {
+        // The prepared geometry is cached during a real run, so preparing
+        // it isn't part of what is timed.
+        const GEOSPreparedGeometry *poPrepared = nullptr;
+        if (osOperation == "touches")
+        {
+            poPrepared = GEOSPrepare_r(hGEOSCtxt, apoInputs[0]);
+        }
+
+        for (int i = 0; i < nIterations; i++)
+        {
+            ReproCapture::clock_t::time_point tStart = ReproCapture::clock_t::now();
+            bool bSucceeded = RunOperation(hGEOSCtxt, osOperation, apoInputs, poPrepared);
+            std::chrono::duration<double> dfElapsed = ReproCapture::clock_t::now() - tStart;
+            adfSeconds.push_back(dfElapsed.count());
+            if (!bSucceeded && i == 0)
+            {
+                CPLError(CE_Warning, CPLE_AppDefined, "%s: %s failed.", pszFilename, osOperation.c_str());
+            }
+        }
+
+        if (poPrepared != nullptr)
+        {
+            GEOSPreparedGeom_destroy_r(hGEOSCtxt, poPrepared);
+        }
+    }
+
+    for (GEOSGeometry *poInput : apoInputs)
+    {
+        GEOSGeom_destroy_r(hGEOSCtxt, poInput);
+    }
+    GEOSWKBReader_destroy_r(hGEOSCtxt, poReader);
+    GEOS_finish_r(hGEOSCtxt);
+
+    return bOK;
+}
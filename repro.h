@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef REPRO_H_INCLUDED
+#define REPRO_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "cpl_port.h"
+
+#include "geos_c.h"
+
+// Dumps the inputs of GEOS operations that fail or run longer than a
+// threshold, so a hotspot can be reproduced and profiled without the
+// dataset it came from. Each capture is a small text file of NAME=VALUE
+// lines: the operation, the FID it was run for, why it was captured, how
+// long it took, and one hex WKB line per input geometry, in order.
+// Any thread may capture.
+//
+class ReproCapture
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    static constexpr double DEFAULT_THRESHOLD = 1.0;
+    static constexpr int DEFAULT_MAX_CAPTURES = 100;
+
+private:
+    std::string m_osDirectory;
+    double m_dfThreshold;
+    int m_nMaxCaptures;
+    std::atomic<int> m_nCaptures;
+
+    void write(GEOSContextHandle_t hGEOSCtxt, const char *pszOperation, GIntBig nFID, bool bFailed,
+               double dfSeconds, std::initializer_list<const GEOSGeometry *> apoInputs);
+
+public:
+    // A null directory disables capture.
+    ReproCapture(const char *pszDirectory, double dfThreshold, int nMaxCaptures);
+
+    ReproCapture(const ReproCapture &) = delete;
+    ReproCapture &operator=(const ReproCapture &) = delete;
+
+    bool enabled() const
+    {
+        return !m_osDirectory.empty();
+    }
+
+    clock_t::time_point now() const
+    {
+        return enabled() ? clock_t::now() : clock_t::time_point();
+    }
+
+    // Call after the operation, with the time taken from now() before it.
+    void check(GEOSContextHandle_t hGEOSCtxt, const char *pszOperation, GIntBig nFID, bool bFailed,
+               clock_t::time_point tStart, std::initializer_list<const GEOSGeometry *> apoInputs)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        std::chrono::duration<double> dfElapsed = clock_t::now() - tStart;
+        if (bFailed || dfElapsed.count() >= m_dfThreshold)
+        {
+            write(hGEOSCtxt, pszOperation, nFID, bFailed, dfElapsed.count(), apoInputs);
+        }
+    }
+};
+
+// Runs the operation in a capture file nIterations times, returning the
+// time of each run. Fails if the file can't be read or names an operation
+// we don't know.
+bool ReplayReproducer(const char *pszFilename, int nIterations, std::string &osOperation, std::vector<double> &adfSeconds);
+
+#endif // REPRO_H_INCLUDED
@@ -0,0 +1,469 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
+
+#include "server.h"
+
+#ifdef _WIN32
+
+OGRErr RunServer(const char * /*pszTool*/, const char * /*pszSocketPath*/, int /*nMaxJobs*/, int /*nMaxQueued*/, const BatchJobFunc & /*fnJob*/)
+{
+    CPLError(CE_Failure, CPLE_NotSupported, "Server mode needs Unix domain sockets.");
+    return OGRERR_FAILURE;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cstring>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cpl_json.h"
+#include "cpl_vsi.h"
+
+
+// How often blocked threads look up to see whether the server is stopping.
+static constexpr int POLL_INTERVAL_MS = 200;
+
+// A request line longer than this closes the connection.
+static constexpr size_t MAX_REQUEST_BYTES = 1024 * 1024;
+
+class ServerConnection
+{
+    int m_nFD;
+    std::mutex m_oMutex;
+
+public:
+    explicit ServerConnection(int nFD) : m_nFD(nFD) {}
+    ~ServerConnection() { close(m_nFD); }
+
+    ServerConnection(const ServerConnection &) = delete;
+    ServerConnection &operator=(const ServerConnection &) = delete;
+
+    int fd() const { return m_nFD; }
+
+    // Writes one line. A client that has gone away just misses it.
+    void send(const CPLString &osLine)
+    {
+        std::lock_guard<std::mutex> oLock(m_oMutex);
+        std::string osData = osLine + "\n";
+        size_t nSent = 0;
+        while (nSent < osData.size())
+        {
+            ssize_t nWritten = ::send(m_nFD, osData.data() + nSent, osData.size() - nSent, 0);
+            if (nWritten <= 0)
+            {
+                return;
+            }
+            nSent += static_cast<size_t>(nWritten);
+        }
+    }
+};
+
+struct server_request_t
+{
+    std::shared_ptr<ServerConnection> poConnection;
+    CPLString osId;
+    CPLStringList aosArgs;
+    CPLString osStatsFilename;
+    bool bTemporaryStats = false;
+};
+
+class JobServer
+{
+    const char *m_pszTool;
+    const BatchJobFunc &m_fnJob;
+    const size_t m_nMaxQueued;
+
+    std::mutex m_oMutex;
+    std::condition_variable m_oCondition;
+    std::deque<server_request_t> m_oQueue;
+    std::atomic<bool> m_bStopping{false};
+    std::atomic<GIntBig> m_nNextRequest{0};
+
+public:
+    JobServer(const char *pszTool, const BatchJobFunc &fnJob, int nMaxQueued) :
+        m_pszTool(pszTool), m_fnJob(fnJob), m_nMaxQueued(static_cast<size_t>(std::max(1, nMaxQueued)))
+    {
+    }
+
+    bool stopping() const { return m_bStopping; }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> oLock(m_oMutex);
+        m_bStopping = true;
+        m_oCondition.notify_all();
+    }
+
+    // Worker thread: runs queued jobs until stopped and drained.
+    void work()
+    {
+        while (true)
+        {
+            server_request_t sRequest;
+            {
+                std::unique_lock<std::mutex> oLock(m_oMutex);
+                m_oCondition.wait(oLock, [this]() { return m_bStopping || !m_oQueue.empty(); });
+                if (m_oQueue.empty())
+                {
+                    return;
+                }
+                sRequest = std::move(m_oQueue.front());
+                m_oQueue.pop_front();
+            }
+            run(sRequest);
+        }
+    }
+
+    // Connection thread: reads request lines until the client hangs up or
+    // the server stops.
+    void serve(std::shared_ptr<ServerConnection> poConnection)
+    {
+        std::string osBuffer;
+        char achChunk[4096];
+
+        while (!m_bStopping)
+        {
+            struct pollfd sPoll = { poConnection->fd(), POLLIN, 0 };
+            int nReady = poll(&sPoll, 1, POLL_INTERVAL_MS);
+            if (nReady == 0)
+            {
+                continue;
+            }
+            if (nReady < 0)
+            {
+                return;
+            }
+
+            ssize_t nRead = recv(poConnection->fd(), achChunk, sizeof(achChunk), 0);
+            if (nRead <= 0)
+            {
+                return;
+            }
+            osBuffer.append(achChunk, static_cast<size_t>(nRead));
+
+            size_t nEnd;
+            while ((nEnd = osBuffer.find('\n')) != std::string::npos)
+            {
+                CPLString osLine(osBuffer.substr(0, nEnd));
+                osBuffer.erase(0, nEnd + 1);
+                osLine.Trim();
+                if (!osLine.empty())
+                {
+                    handle(poConnection, osLine);
+                }
+            }
+
+            if (osBuffer.size() > MAX_REQUEST_BYTES)
+            {
+                poConnection->send(Rejection("null", "Request too long."));
+                return;
+            }
+        }
+    }
+
+private:
+    static CPLString Quoted(const char *pszText)
+    {
+        char *pszEscaped = CPLEscapeString(pszText, -1, CPLES_BackslashQuotable);
+        CPLString osQuoted = CPLSPrintf("\"%s\"", pszEscaped);
+        CPLFree(pszEscaped);
+        return osQuoted;
+    }
+
+    static CPLString Rejection(const CPLString &osId, const char *pszError)
+    {
+        return CPLSPrintf("{\"id\": %s, \"status\": \"rejected\", \"error\": %s}", osId.c_str(), Quoted(pszError).c_str());
+    }
+
+    void handle(const std::shared_ptr<ServerConnection> &poConnection, const CPLString &osLine)
+    {
+        CPLJSONDocument oDocument;
+        if (!oDocument.LoadMemory(osLine.c_str()))
+        {
+            poConnection->send(Rejection("null", "Request is not valid JSON."));
+            return;
+        }
+
+        CPLJSONObject oRoot = oDocument.GetRoot();
+        CPLJSONObject oId = oRoot.GetObj("id");
+        CPLString osId = oId.IsValid() ? CPLString(oId.Format(CPLJSONObject::PrettyFormat::Plain)) : CPLString("null");
+
+        if (oRoot.GetString("command") == "shutdown")
+        {
+            stop();
+            poConnection->send(CPLSPrintf("{\"id\": %s, \"status\": \"stopping\"}", osId.c_str()));
+            return;
+        }
+
+        std::string osTool = oRoot.GetString("tool", m_pszTool);
+        if (!EQUAL(osTool.c_str(), m_pszTool))
+        {
+            poConnection->send(Rejection(osId, CPLSPrintf("This server only runs %s.", m_pszTool)));
+            return;
+        }
+
+        CPLJSONArray oArgs = oRoot.GetArray("args");
+        if (!oArgs.IsValid() || oArgs.Size() == 0)
+        {
+            poConnection->send(Rejection(osId, "Missing \"args\"."));
+            return;
+        }
+
+        server_request_t sRequest;
+        sRequest.poConnection = poConnection;
+        sRequest.osId = osId;
+        sRequest.aosArgs.AddString(m_pszTool);
+        for (int i = 0; i < oArgs.Size(); i++)
+        {
+            // Numbers are taken as written, so {"args": ["-min", 10, ...]}
+            // works too.
+            CPLJSONObject oArg = oArgs[i];
+            CPLString osArg = oArg.GetType() == CPLJSONObject::Type::String ? oArg.ToString() : oArg.Format(CPLJSONObject::PrettyFormat::Plain);
+            if (EQUAL(osArg, "-stats") && i + 1 < oArgs.Size())
+            {
+                sRequest.osStatsFilename = oArgs[i + 1].ToString();
+            }
+            sRequest.aosArgs.AddString(osArg);
+        }
+
+        // Every run reports its stats; if the client didn't ask for them
+        // in a file, they go through memory.
+        if (sRequest.osStatsFilename.empty())
+        {
+            sRequest.osStatsFilename = CPLSPrintf("/vsimem/%s_server/" CPL_FRMT_GIB ".json", m_pszTool, m_nNextRequest++);
+            sRequest.bTemporaryStats = true;
+            sRequest.aosArgs.AddString("-stats");
+            sRequest.aosArgs.AddString(sRequest.osStatsFilename);
+        }
+
+        size_t nAhead;
+        {
+            std::lock_guard<std::mutex> oLock(m_oMutex);
+            if (m_bStopping)
+            {
+                poConnection->send(Rejection(osId, "Server is shutting down."));
+                return;
+            }
+            if (m_oQueue.size() >= m_nMaxQueued)
+            {
+                poConnection->send(Rejection(osId, CPLSPrintf("Queue is full, with %d jobs waiting.", static_cast<int>(m_oQueue.size()))));
+                return;
+            }
+            nAhead = m_oQueue.size();
+            m_oQueue.push_back(std::move(sRequest));
+            m_oCondition.notify_one();
+        }
+
+        poConnection->send(CPLSPrintf("{\"id\": %s, \"status\": \"queued\", \"ahead\": %d}", osId.c_str(), static_cast<int>(nAhead)));
+    }
+
+    void run(server_request_t &sRequest)
+    {
+        sRequest.poConnection->send(CPLSPrintf("{\"id\": %s, \"status\": \"running\"}", sRequest.osId.c_str()));
+
+        auto tStart = std::chrono::steady_clock::now();
+        CPLString osError;
+        bool bOK = RunCapturedJob(m_fnJob, sRequest.aosArgs.size(), sRequest.aosArgs.List(), osError);
+        double dfSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+        CPLString osStats = "null";
+        VSIStatBufL sStat;
+        if (bOK && VSIStatL(sRequest.osStatsFilename, &sStat) == 0)
+        {
+            CPLJSONDocument oStats;
+            if (oStats.Load(sRequest.osStatsFilename))
+            {
+                osStats = oStats.GetRoot().Format(CPLJSONObject::PrettyFormat::Plain);
+            }
+        }
+        if (sRequest.bTemporaryStats)
+        {
+            VSIUnlink(sRequest.osStatsFilename);
+        }
+
+        CPLString osResponse = CPLSPrintf("{\"id\": %s, \"status\": \"done\", \"ok\": %s, \"seconds\": %.6f",
+                                          sRequest.osId.c_str(), bOK ? "true" : "false", dfSeconds);
+        if (!bOK)
+        {
+            osResponse += CPLSPrintf(", \"error\": %s", Quoted(osError.empty() ? "Failed." : osError.c_str()).c_str());
+        }
+        osResponse += ", \"stats\": " + osStats + "}";
+        sRequest.poConnection->send(osResponse);
+    }
+};
+
+static int OpenListeningSocket(const char *pszSocketPath)
+{
+    struct sockaddr_un sAddress;
+    memset(&sAddress, 0, sizeof(sAddress));
+    sAddress.sun_family = AF_UNIX;
+    if (strlen(pszSocketPath) >= sizeof(sAddress.sun_path))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Socket path too long: %s", pszSocketPath);
+        return -1;
+    }
+    strcpy(sAddress.sun_path, pszSocketPath);
+
+    // A socket left behind by a server that died would block the bind, but
+    // one that still accepts connections belongs to a live server.
+    struct stat sStat;
+    if (lstat(pszSocketPath, &sStat) == 0 && S_ISSOCK(sStat.st_mode))
+    {
+        int nProbeFD = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool bLive = nProbeFD >= 0 && connect(nProbeFD, reinterpret_cast<struct sockaddr *>(&sAddress), sizeof(sAddress)) == 0;
+        if (nProbeFD >= 0)
+        {
+            close(nProbeFD);
+        }
+        if (bLive)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Another server is already listening on %s.", pszSocketPath);
+            return -1;
+        }
+        unlink(pszSocketPath);
+    }
+
+    int nFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (nFD < 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Cannot create socket: %s", strerror(errno));
+        return -1;
+    }
+
+    if (bind(nFD, reinterpret_cast<struct sockaddr *>(&sAddress), sizeof(sAddress)) != 0 || listen(nFD, SOMAXCONN) != 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Cannot listen on %s: %s", pszSocketPath, strerror(errno));
+        close(nFD);
+        return -1;
+    }
+
+    return nFD;
+}
+
+OGRErr RunServer(const char *pszTool, const char *pszSocketPath, int nMaxJobs, int nMaxQueued, const BatchJobFunc &fnJob)
+{
+    int nListenFD = OpenListeningSocket(pszSocketPath);
+    if (nListenFD < 0)
+    {
+        return OGRERR_FAILURE;
+    }
+
+    // Writing to a client that has hung up must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    JobServer oServer(pszTool, fnJob, nMaxQueued);
+
+    std::vector<std::thread> vecWorkers;
+    for (int i = 0; i < std::max(1, nMaxJobs); i++)
+    {
+        vecWorkers.emplace_back(&JobServer::work, &oServer);
+    }
+
+    // Each connection's thread, and whether it has finished and can be
+    // joined, so that a long-lived server doesn't accumulate them.
+    std::list<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> lstConnections;
+    while (!oServer.stopping())
+    {
+        for (auto oIter = lstConnections.begin(); oIter != lstConnections.end();)
+        {
+            if (*oIter->second)
+            {
+                oIter->first.join();
+                oIter = lstConnections.erase(oIter);
+            }
+            else
+            {
+                ++oIter;
+            }
+        }
+
+        struct pollfd sPoll = { nListenFD, POLLIN, 0 };
+        if (poll(&sPoll, 1, POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int nFD = accept(nListenFD, nullptr, nullptr);
+        if (nFD >= 0)
+        {
+            auto poDone = std::make_shared<std::atomic<bool>>(false);
+            auto poConnection = std::make_shared<ServerConnection>(nFD);
+            std::thread oThread([&oServer, poConnection, poDone]()
+            {
+                oServer.serve(poConnection);
+                *poDone = true;
+            });
+            lstConnections.emplace_back(std::move(oThread), poDone);
+        }
+    }
+
+    close(nListenFD);
+    unlink(pszSocketPath);
+
+    for (auto &oThread : vecWorkers)
+    {
+        oThread.join();
+    }
+    for (auto &sConnection : lstConnections)
+    {
+        sConnection.first.join();
+    }
+
+    return OGRERR_NONE;
+}
+
+#endif // _WIN32
+
+OGRErr RunServerCommand(const char *pszTool, int nArgc, char **papszArgv, const BatchJobFunc &fnJob)
+{
+    batch_command_t sCommand;
+    if (!ParseBatchCommand(nArgc, papszArgv, "-serve", false, true, sCommand))
+    {
+        return OGRERR_FAILURE;
+    }
+    return RunServer(pszTool, sCommand.pszTarget, sCommand.nJobs, sCommand.nMaxQueued, fnJob);
+}
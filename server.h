@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#include "batch.h"
+
+// Serves jobs over a local Unix domain socket, so that interactive callers
+// don't pay for process start-up and driver registration on every call.
+// The drivers stay registered and a pool of nMaxJobs worker threads stays
+// up for the life of the server; requests beyond that wait their turn, up
+// to nMaxQueued of them, and any more are rejected until the queue drains.
+//
+// Each request is one line of JSON:
+//
+//   {"id": <anything>, "args": ["-min", "10", "src.gpkg", "dst.gpkg"]}
+//
+// with the arguments as on the tool's command line. "tool", if given, must
+// name the tool being served. {"command": "shutdown"} stops the server once
+// the jobs already accepted have finished.
+//
+// Each request is answered with a line of JSON per change of status, all
+// carrying the request's "id": "queued" with the number of jobs ahead of
+// it, "running", and finally "done" with "ok", "seconds", "error" if it
+// failed, and the run's "stats". A request that is not accepted, because
+// it is malformed, the queue is full or the server is stopping, is
+// answered "rejected" with the "error". Requests on one connection may be
+// pipelined; their answers can interleave.
+
+// Runs until shut down. Fails if the socket cannot be set up, or on
+// platforms without Unix domain sockets.
+OGRErr RunServer(const char *pszTool, const char *pszSocketPath, int nMaxJobs, int nMaxQueued, const BatchJobFunc &fnJob);
+
+// Runs "<tool> -serve <socket_path> [-jobs <n>] [-queue <n>]", the queue
+// holding 64 jobs by default.
+OGRErr RunServerCommand(const char *pszTool, int nArgc, char **papszArgv, const BatchJobFunc &fnJob);
+
+#endif // SERVER_H_INCLUDED
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <algorithm>
+
+#include "cpl_error.h"
+#include "cpl_vsi.h"
+
+#include "slowlog.h"
+
+
+SlowFeatureLog::SlowFeatureLog(size_t nMaxEntries) :
+    m_nMaxEntries(nMaxEntries)
+{
+}
+
+const char *SlowFeatureLog::kindName(Kind eKind)
+{
+    return eKind == NEIGHBORS ? "neighbors" : "union";
+}
+
+void SlowFeatureLog::merge(const SlowFeatureLog &oOther)
+{
+    for (const entry_t &sEntry : oOther.entries())
+    {
+        record(sEntry.eKind, sEntry.nFID, sEntry.nVertices, sEntry.nNeighbors, sEntry.dfSeconds);
+    }
+}
+
+std::vector<SlowFeatureLog::entry_t> SlowFeatureLog::entries() const
+{
+    auto oHeap = m_oHeap;
+    std::vector<entry_t> vecEntries;
+    vecEntries.reserve(oHeap.size());
+    while (!oHeap.empty())
+    {
+        vecEntries.push_back(oHeap.top());
+        oHeap.pop();
+    }
+    std::reverse(vecEntries.begin(), vecEntries.end());
+    return vecEntries;
+}
+
+bool SlowFeatureLog::write(const char *pszFilename) const
+{
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return false;
+    }
+
+    bool bOK = VSIFPrintfL(fp, "[\n") > 0;
+    bool bFirst = true;
+    for (const entry_t &sEntry : entries())
+    {
+        bOK &= VSIFPrintfL(fp,
+                           "%s  {\"kind\": \"%s\", \"fid\": " CPL_FRMT_GIB ", \"vertices\": " CPL_FRMT_GIB
+                           ", \"neighbors\": " CPL_FRMT_GIB ", \"seconds\": %.6f}",
+                           bFirst ? "" : ",\n", kindName(sEntry.eKind), sEntry.nFID,
+                           sEntry.nVertices, sEntry.nNeighbors, sEntry.dfSeconds) > 0;
+        bFirst = false;
+    }
+    bOK &= VSIFPrintfL(fp, "%s]\n", bFirst ? "" : "\n") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef SLOWLOG_H_INCLUDED
+#define SLOWLOG_H_INCLUDED
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "cpl_port.h"
+
+// Keeps the slowest pieces of work seen in a run, so that the few features
+// that dominate a run can be found and simplified or split beforehand. Only
+// the top entries are held, in a min-heap, so recording is cheap once the
+// log is full. Like StatsCollector, each thread keeps its own log and they
+// are merged at the end.
+//
+class SlowFeatureLog
+{
+public:
+    enum Kind
+    {
+        NEIGHBORS = 0,   // Finding the neighbors of one feature to eliminate.
+        UNION            // Merging one group and writing the result.
+    };
+
+    struct entry_t
+    {
+        double dfSeconds;
+        Kind eKind;
+        GIntBig nFID;
+        GIntBig nVertices;
+        GIntBig nNeighbors;
+
+        bool operator>(const entry_t &other) const
+        {
+            return dfSeconds > other.dfSeconds;
+        }
+    };
+
+    static constexpr int DEFAULT_MAX_ENTRIES = 20;
+
+private:
+    size_t m_nMaxEntries;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> m_oHeap;
+
+public:
+    // A log with no room records nothing.
+    explicit SlowFeatureLog(size_t nMaxEntries);
+
+    bool enabled() const
+    {
+        return m_nMaxEntries > 0;
+    }
+
+    void record(Kind eKind, GIntBig nFID, GIntBig nVertices, GIntBig nNeighbors, double dfSeconds)
+    {
+        if (m_oHeap.size() < m_nMaxEntries)
+        {
+            m_oHeap.push({dfSeconds, eKind, nFID, nVertices, nNeighbors});
+        }
+        else if (m_nMaxEntries > 0 && dfSeconds > m_oHeap.top().dfSeconds)
+        {
+            m_oHeap.pop();
+            m_oHeap.push({dfSeconds, eKind, nFID, nVertices, nNeighbors});
+        }
+    }
+
+    void merge(const SlowFeatureLog &oOther);
+
+    // Slowest first.
+    std::vector<entry_t> entries() const;
+
+    bool write(const char *pszFilename) const;
+
+    static const char *kindName(Kind eKind);
+};
+
+#endif // SLOWLOG_H_INCLUDED
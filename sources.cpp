@@ -0,0 +1,537 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "sources.h"
+#include "threaderrors.h"
+
+
+static bool HasWildcard(const char *pszName)
+{
+    return strchr(pszName, '*') != nullptr || strchr(pszName, '?') != nullptr;
+}
+
+// Matches '*' and '?' only, case sensitively.
+//
+static bool MatchWildcard(const char *pszPattern, const char *pszName)
+{
+    const char *pszStar = nullptr;
+    const char *pszStarName = nullptr;
+    while (*pszName != '\0')
+    {
+        if (*pszPattern == '*')
+        {
+            pszStar = pszPattern++;
+            pszStarName = pszName;
+        }
+        else if (*pszPattern == '?' || *pszPattern == *pszName)
+        {
+            pszPattern++;
+            pszName++;
+        }
+        else if (pszStar != nullptr)
+        {
+            pszPattern = pszStar + 1;
+            pszName = ++pszStarName;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (*pszPattern == '*')
+    {
+        pszPattern++;
+    }
+    return *pszPattern == '\0';
+}
+
+bool IsMultiSource(const char *pszSource)
+{
+    if (pszSource[0] == '@' || HasWildcard(CPLGetFilename(pszSource)))
+    {
+        return true;
+    }
+
+    // A directory can itself be a dataset, as for shapefiles, in which case
+    // it is left to the driver.
+    VSIStatBufL sStat;
+    return VSIStatL(pszSource, &sStat) == 0 && VSI_ISDIR(sStat.st_mode) &&
+           GDALIdentifyDriverEx(pszSource, GDAL_OF_VECTOR, nullptr, nullptr) == nullptr;
+}
+
+static bool ReadFileList(const char *pszListFilename, CPLStringList &aosFilenames)
+{
+    VSILFILE *fp = VSIFOpenL(pszListFilename, "rb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_OpenFailed, "Unable to open %s.", pszListFilename);
+        return false;
+    }
+
+    while (const char *pszLine = CPLReadLineL(fp))
+    {
+        CPLString osLine = pszLine;
+        osLine.Trim();
+        if (!osLine.empty() && osLine[0] != '#')
+        {
+            aosFilenames.AddString(osLine);
+        }
+    }
+
+    VSIFCloseL(fp);
+    return true;
+}
+
+bool ExpandMultiSource(const char *pszSource, CPLStringList &aosFilenames)
+{
+    if (pszSource[0] == '@')
+    {
+        if (!ReadFileList(pszSource + 1, aosFilenames))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        CPLString osDirectory = pszSource;
+        CPLString osPattern = "*";
+        if (HasWildcard(CPLGetFilename(pszSource)))
+        {
+            osDirectory = CPLGetPath(pszSource);
+            osPattern = CPLGetFilename(pszSource);
+        }
+
+        CPLStringList aosEntries(VSIReadDir(osDirectory.empty() ? "." : osDirectory.c_str()), TRUE);
+        aosEntries.Sort();
+        for (int i = 0; i < aosEntries.Count(); i++)
+        {
+            if (!MatchWildcard(osPattern, aosEntries[i]))
+            {
+                continue;
+            }
+            CPLString osFilename = osDirectory.empty() ? CPLString(aosEntries[i]) : CPLString(CPLFormFilename(osDirectory, aosEntries[i], nullptr));
+            if (GDALIdentifyDriverEx(osFilename, GDAL_OF_VECTOR, nullptr, nullptr) != nullptr)
+            {
+                aosFilenames.AddString(osFilename);
+            }
+        }
+    }
+
+    if (aosFilenames.Count() == 0)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "No source files found for %s.", pszSource);
+        return false;
+    }
+
+    return true;
+}
+
+CPLString AdaptWhereClause(GDALDataset *poSrcDS, OGRLayer *poSrcLayer, const char *pszWhere)
+{
+    CPLString osWhere = pszWhere;
+
+    // There seems to be no way to force it into the OGRSQL dialect,
+    // so kludge the where clause to keep it from blowing up.
+    //
+    CPLString osDriverName = poSrcDS->GetDriverName();
+    if (osDriverName == "SQLite" || osDriverName == "GPKG")
+    {
+        CPLString osGeomColumn = poSrcLayer->GetGeometryColumn();
+        if (!osGeomColumn.empty())
+        {
+            CPLString osAreaExpr = "ST_Area(";
+            osAreaExpr += osGeomColumn;
+            osAreaExpr += ")";
+            osWhere.replaceAll("OGR_GEOM_AREA", osAreaExpr);
+        }
+    }
+
+    return osWhere;
+}
+
+OGRErr SetWhereFilter(OGRLayer *poLayer, const char *pszWhere)
+{
+    CPLErrorReset();
+    OGRErr eErr = poLayer->SetAttributeFilter(pszWhere);
+    if (eErr != OGRERR_NONE)
+    {
+        return eErr;
+    }
+
+    poLayer->ResetReading();
+    OGRFeatureUniquePtr poFeature(poLayer->GetNextFeature());
+    if (poFeature == nullptr && CPLGetLastErrorType() == CE_Failure)
+    {
+        poLayer->SetAttributeFilter(nullptr);
+        return OGRERR_FAILURE;
+    }
+    poLayer->ResetReading();
+
+    return OGRERR_NONE;
+}
+
+struct source_file_t
+{
+    const char *pszFilename;
+    // Open from OpenSourceFile() until the file has been read.
+    GDALDatasetUniquePtr poDS;
+    OGRLayer *poLayer = nullptr;
+    std::vector<OGRFeatureUniquePtr> apoFeatures;
+    std::vector<bool> abCandidates;
+    OGRFeatureDefn *poDefn = nullptr;
+    bool bOK = false;
+};
+
+// Polygons and multipolygons mix in one layer, as do layers that only say
+// they have some geometry.
+//
+static bool CompatibleGeomTypes(OGRwkbGeometryType eType, OGRwkbGeometryType eOtherType)
+{
+    eType = wkbFlatten(eType);
+    eOtherType = wkbFlatten(eOtherType);
+    if (eType == eOtherType || eType == wkbUnknown || eOtherType == wkbUnknown)
+    {
+        return true;
+    }
+    return (eType == wkbPolygon || eType == wkbMultiPolygon) && (eOtherType == wkbPolygon || eOtherType == wkbMultiPolygon);
+}
+
+// Every file must have the fields, spatial reference and a geometry type
+// compatible with those of the first.
+//
+static bool SameSchema(const source_file_t &sFile, const source_file_t &sFirst)
+{
+    OGRFeatureDefn *poDefn = sFirst.poDefn;
+    OGRFeatureDefn *poOtherDefn = sFile.poDefn;
+
+    bool bSameFields = poDefn->GetFieldCount() == poOtherDefn->GetFieldCount();
+    for (int iField = 0; bSameFields && iField < poDefn->GetFieldCount(); iField++)
+    {
+        const OGRFieldDefn *poField = poDefn->GetFieldDefn(iField);
+        const OGRFieldDefn *poOtherField = poOtherDefn->GetFieldDefn(iField);
+        bSameFields = EQUAL(poField->GetNameRef(), poOtherField->GetNameRef()) && poField->GetType() == poOtherField->GetType();
+    }
+    if (!bSameFields)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "The fields of %s differ from those of %s.", sFile.pszFilename, sFirst.pszFilename);
+        return false;
+    }
+
+    const OGRGeomFieldDefn *poGeomField = poDefn->GetGeomFieldDefn(0);
+    const OGRGeomFieldDefn *poOtherGeomField = poOtherDefn->GetGeomFieldDefn(0);
+
+    const OGRSpatialReference *poSRS = poGeomField->GetSpatialRef();
+    const OGRSpatialReference *poOtherSRS = poOtherGeomField->GetSpatialRef();
+    if ((poSRS == nullptr) != (poOtherSRS == nullptr) || (poSRS != nullptr && !poSRS->IsSame(poOtherSRS)))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "The spatial reference of %s differs from that of %s.", sFile.pszFilename, sFirst.pszFilename);
+        return false;
+    }
+
+    if (!CompatibleGeomTypes(poGeomField->GetType(), poOtherGeomField->GetType()))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "The geometry type of %s, %s, does not go with %s of %s.", sFile.pszFilename,
+                 OGRGeometryTypeToName(poOtherGeomField->GetType()), OGRGeometryTypeToName(poGeomField->GetType()), sFirst.pszFilename);
+        return false;
+    }
+
+    return true;
+}
+
+// Opens the file and finds its layer, leaving the features unread.
+//
+static bool OpenSourceFile(source_file_t &sFile, const char *pszLayerName)
+{
+    const int nFlags = GDAL_OF_VECTOR | GDAL_OF_READONLY | GDAL_OF_VERBOSE_ERROR;
+    sFile.poDS.reset(GDALDataset::Open(sFile.pszFilename, nFlags));
+    if (sFile.poDS == nullptr)
+    {
+        return false;
+    }
+    GDALDataset *poSrcDS = sFile.poDS.get();
+
+    OGRLayer *poSrcLayer = nullptr;
+    if (pszLayerName != nullptr)
+    {
+        poSrcLayer = poSrcDS->GetLayerByName(pszLayerName);
+    }
+    else if (poSrcDS->GetLayerCount() == 1)
+    {
+        poSrcLayer = poSrcDS->GetLayer(0);
+    }
+    if (poSrcLayer == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Source layer %s not found in %s.", pszLayerName != nullptr ? pszLayerName : "must be specified;", sFile.pszFilename);
+        return false;
+    }
+
+    if (poSrcLayer->GetLayerDefn()->GetGeomFieldCount() != 1)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "%s must have exactly one geometry column.", sFile.pszFilename);
+        return false;
+    }
+
+    // The features hold a reference to it, so it outlives the dataset.
+    sFile.poLayer = poSrcLayer;
+    sFile.poDefn = poSrcLayer->GetLayerDefn();
+    sFile.poDefn->Reference();
+
+    return true;
+}
+
+// Selects the candidates the way EliminatePolygonsByQuery does, then reads
+// every feature and closes the file.
+//
+static bool ReadSourceFile(source_file_t &sFile, const char *pszWhere, StatsCollector &oStats, const std::atomic<bool> &bCancelled)
+{
+    OGRLayer *poSrcLayer = sFile.poLayer;
+    if (SetWhereFilter(poSrcLayer, AdaptWhereClause(sFile.poDS.get(), poSrcLayer, pszWhere)) != OGRERR_NONE)
+    {
+        return false;
+    }
+    std::unordered_set<GIntBig> setCandidateFIDs;
+    for (auto &poFeature : poSrcLayer)
+    {
+        setCandidateFIDs.insert(poFeature->GetFID());
+    }
+    if (poSrcLayer->SetAttributeFilter(nullptr) != OGRERR_NONE)
+    {
+        return false;
+    }
+
+    poSrcLayer->ResetReading();
+    while (!bCancelled)
+    {
+        OGRFeatureUniquePtr poFeature;
+        {
+            StatsCollector::Scope oScope(oStats, ELIMINATE_PHASE_READ);
+            poFeature.reset(poSrcLayer->GetNextFeature());
+        }
+        if (poFeature == nullptr)
+        {
+            break;
+        }
+        sFile.abCandidates.push_back(setCandidateFIDs.count(poFeature->GetFID()) > 0);
+        sFile.apoFeatures.push_back(std::move(poFeature));
+    }
+
+    sFile.poLayer = nullptr;
+    sFile.poDS.reset();
+
+    return !bCancelled;
+}
+
+bool ReadMultiSource(const CPLStringList &aosFilenames, const char *pszLayerName, const char *pszWhere, int nThreads,
+                     Eliminator &oEliminator, std::unordered_set<GIntBig> &setFIDsToEliminate, OGRFeatureDefn **ppoDefn,
+                     std::vector<GIntBig> &anFIDOffsets, GDALProgressFunc pfnProgress, void *pProgressData)
+{
+    *ppoDefn = nullptr;
+    anFIDOffsets.clear();
+
+    std::vector<source_file_t> asFiles(aosFilenames.Count());
+    for (int i = 0; i < aosFilenames.Count(); i++)
+    {
+        asFiles[i].pszFilename = aosFilenames[i];
+    }
+
+    // The first file sets the schema the others are checked against as they
+    // are opened, so a mismatch fails before their features are read.
+    if (!OpenSourceFile(asFiles[0], pszLayerName))
+    {
+        return false;
+    }
+    std::mutex oSchemaMutex;
+
+    std::atomic<size_t> nNextFile(0);
+    std::atomic<size_t> nFilesDone(0);
+    std::atomic<bool> bCancelled(false);
+
+    struct reader_t
+    {
+        StatsCollector oStats;
+        ThreadErrors oErrors;
+
+        explicit reader_t(bool bStats) : oStats(bStats)
+        {
+        }
+    };
+
+    nThreads = std::max(1, std::min(nThreads, aosFilenames.Count()));
+    std::vector<std::unique_ptr<reader_t>> vecReaders;
+    std::vector<std::thread> vecThreads;
+    for (int i = 0; i < nThreads; i++)
+    {
+        vecReaders.emplace_back(new reader_t(oEliminator.stats().enabled()));
+        reader_t *poReader = vecReaders.back().get();
+        vecThreads.emplace_back([&, poReader]() {
+            ThreadErrors::Scope oErrorScope(poReader->oErrors);
+            while (!bCancelled)
+            {
+                size_t iFile = nNextFile++;
+                if (iFile >= asFiles.size())
+                {
+                    break;
+                }
+                source_file_t &sFile = asFiles[iFile];
+                bool bOK = true;
+                if (iFile > 0)
+                {
+                    bOK = OpenSourceFile(sFile, pszLayerName);
+                    if (bOK)
+                    {
+                        std::lock_guard<std::mutex> oLock(oSchemaMutex);
+                        bOK = SameSchema(sFile, asFiles[0]);
+                    }
+                }
+                asFiles[iFile].bOK = bOK && ReadSourceFile(sFile, pszWhere, poReader->oStats, bCancelled);
+                if (!asFiles[iFile].bOK)
+                {
+                    bCancelled = true;
+                }
+                nFilesDone++;
+            }
+        });
+    }
+
+    // Only this thread reports progress, by files read.
+    //
+    bool bUserCancelled = false;
+    size_t nFilesReported = static_cast<size_t>(-1);
+    while (nFilesDone < asFiles.size() && !bCancelled)
+    {
+        size_t nDone = nFilesDone;
+        if (nDone != nFilesReported)
+        {
+            nFilesReported = nDone;
+            if (!pfnProgress(static_cast<double>(nDone) / asFiles.size(), nullptr, pProgressData))
+            {
+                bUserCancelled = true;
+                bCancelled = true;
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    for (auto &oThread : vecThreads)
+    {
+        oThread.join();
+    }
+    for (auto &poReader : vecReaders)
+    {
+        oEliminator.stats().merge(poReader->oStats);
+        poReader->oErrors.replay();
+    }
+
+    bool bOK = !bCancelled;
+
+    // Each file's FIDs are shifted past the largest of the file before, so
+    // the source FID is the FID less the file's offset. Features without
+    // one are numbered after the file's largest.
+    GIntBig nFIDOffset = 0;
+    for (auto &sFile : asFiles)
+    {
+        if (!bOK)
+        {
+            break;
+        }
+        anFIDOffsets.push_back(nFIDOffset);
+        GIntBig nNextFID = 0;
+        for (const auto &poFeature : sFile.apoFeatures)
+        {
+            nNextFID = std::max(nNextFID, poFeature->GetFID() + 1);
+        }
+        for (size_t i = 0; i < sFile.apoFeatures.size(); i++)
+        {
+            GIntBig nSourceFID = sFile.apoFeatures[i]->GetFID();
+            GIntBig nFID = nFIDOffset + (nSourceFID >= 0 ? nSourceFID : nNextFID++);
+            sFile.apoFeatures[i]->SetFID(nFID);
+            if (sFile.abCandidates[i])
+            {
+                setFIDsToEliminate.insert(nFID);
+            }
+            oEliminator.add(std::move(sFile.apoFeatures[i]));
+        }
+        sFile.apoFeatures.clear();
+        nFIDOffset += nNextFID;
+    }
+
+    if (bOK)
+    {
+        *ppoDefn = asFiles[0].poDefn;
+        (*ppoDefn)->Reference();
+    }
+    for (auto &sFile : asFiles)
+    {
+        if (sFile.poDefn != nullptr)
+        {
+            sFile.poDefn->Release();
+        }
+    }
+
+    if (bUserCancelled)
+    {
+        CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated.");
+    }
+
+    return bOK;
+}
+
+bool WriteFIDOffsets(const char *pszFilename, const CPLStringList &aosFilenames, const std::vector<GIntBig> &anFIDOffsets)
+{
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return false;
+    }
+
+    bool bOK = VSIFPrintfL(fp, "[\n") > 0;
+    for (size_t i = 0; i < anFIDOffsets.size(); i++)
+    {
+        char *pszEscaped = CPLEscapeString(aosFilenames[static_cast<int>(i)], -1, CPLES_BackslashQuotable);
+        bOK &= VSIFPrintfL(fp, "%s  {\"file\": \"%s\", \"fid_offset\": " CPL_FRMT_GIB "}",
+                           i > 0 ? ",\n" : "", pszEscaped, anFIDOffsets[i]) > 0;
+        CPLFree(pszEscaped);
+    }
+    bOK &= VSIFPrintfL(fp, "%s]\n", anFIDOffsets.empty() ? "" : "\n") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+
+#ifndef SOURCES_H_INCLUDED
+#define SOURCES_H_INCLUDED
+
+#include <unordered_set>
+#include <vector>
+
+#include "cpl_string.h"
+#include "gdal.h"
+#include "ogrsf_frmts.h"
+
+#include "eliminator.h"
+
+// The features eliminate reads can come from one dataset, or from many
+// files read as one layer, such as a coverage delivered in tiles whose
+// polygons touch across file boundaries. A source is a set of files if it
+// is
+//
+//   @<filename>        A list of files, one per line; '#' starts a comment.
+//   <directory>        Every vector file in the directory.
+//   <path with * or ?> Every vector file whose name matches, in a single
+//                      directory.
+//
+// Files are taken in name order, except for a list, which is taken as
+// given.
+
+bool IsMultiSource(const char *pszSource);
+
+// Fails if the source names no files.
+bool ExpandMultiSource(const char *pszSource, CPLStringList &aosFilenames);
+
+// SQLite and GPKG take the where clause in their own dialect, which has no
+// OGR_GEOM_AREA, so it is rewritten to their ST_Area() of the geometry.
+CPLString AdaptWhereClause(GDALDataset *poSrcDS, OGRLayer *poSrcLayer, const char *pszWhere);
+
+// Sets pszWhere as the layer's attribute filter. Drivers that hand the
+// clause to their own SQL engine only find it bad when reading, so the first
+// feature is read too, and an error then fails the call, with the filter
+// cleared. Reading is left reset.
+OGRErr SetWhereFilter(OGRLayer *poLayer, const char *pszWhere);
+
+// Reads the layer pszLayerName, or the only layer, of every file on up to
+// nThreads threads, and adds the features to the eliminator in file order.
+// So that FIDs are unique across files, each file's are shifted by the
+// offset returned for it in anFIDOffsets: past the largest FID of the file
+// before. The FIDs of those matching pszWhere are added to
+// setFIDsToEliminate. Every file's fields, spatial reference and geometry
+// type must match those of the first, which is checked as each file is
+// opened; the first's definition is returned in *ppoDefn, referenced, for
+// the destination layer. False on failure or if cancelled.
+bool ReadMultiSource(const CPLStringList &aosFilenames, const char *pszLayerName, const char *pszWhere, int nThreads,
+                     Eliminator &oEliminator, std::unordered_set<GIntBig> &setFIDsToEliminate, OGRFeatureDefn **ppoDefn,
+                     std::vector<GIntBig> &anFIDOffsets, GDALProgressFunc pfnProgress, void *pProgressData);
+
+// Writes each file with its FID offset to pszFilename as JSON, so that the
+// FIDs in the output and reports can be traced back to their source.
+bool WriteFIDOffsets(const char *pszFilename, const CPLStringList &aosFilenames, const std::vector<GIntBig> &anFIDOffsets);
+
+#endif // SOURCES_H_INCLUDED
@@ -0,0 +1,504 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "statscollector.h"
+
+
+static const char *const apszPhaseNames[ELIMINATE_PHASE_COUNT] = {
+    "read",
+    "geos_export",
+    "prepare",
+    "index",
+    "query",
+    "touches",
+    "intersection",
+    "union",
+    "geos_import",
+    "write",
+};
+
+static const char *const apszStageNames[ELIMINATE_STAGE_COUNT] = {
+    "read",
+    "neighbors",
+    "write",
+};
+
+static const char *const apszMemoryCategoryNames[ELIMINATE_MEMORY_COUNT] = {
+    "features",
+    "geos_geometries",
+    "prepared_geometries",
+    "index",
+    "neighbors",
+};
+
+const char *EliminatePhaseName(EliminatePhase ePhase)
+{
+    if (ePhase < 0 || ePhase >= ELIMINATE_PHASE_COUNT)
+    {
+        return "unknown";
+    }
+    return apszPhaseNames[ePhase];
+}
+
+const char *EliminateStageName(EliminateStage eStage)
+{
+    if (eStage < 0 || eStage >= ELIMINATE_STAGE_COUNT)
+    {
+        return "unknown";
+    }
+    return apszStageNames[eStage];
+}
+
+const char *EliminateMemoryCategoryName(EliminateMemoryCategory eCategory)
+{
+    if (eCategory < 0 || eCategory >= ELIMINATE_MEMORY_COUNT)
+    {
+        return "unknown";
+    }
+    return apszMemoryCategoryNames[eCategory];
+}
+
+static CPLString CounterToJSON(GIntBig nCount)
+{
+    return nCount < 0 ? CPLString("null") : CPLString(CPLSPrintf(CPL_FRMT_GIB, nCount));
+}
+
+static GIntBig EstimatedMemoryBytes(const EliminateStats *psStats)
+{
+    GIntBig nTotal = 0;
+    for (GIntBig nBytes : psStats->anMemoryBytes)
+    {
+        nTotal += nBytes;
+    }
+    return nTotal;
+}
+
+// The growth in RSS over the run, or -1 if it isn't known.
+static GIntBig MeasuredMemoryBytes(const EliminateStats *psStats)
+{
+    if (psStats->nStartRSSBytes < 0 || psStats->nPeakRSSBytes < 0)
+    {
+        return -1;
+    }
+    return std::max<GIntBig>(0, psStats->nPeakRSSBytes - psStats->nStartRSSBytes);
+}
+
+static GIntBig PerMillionFeatures(const EliminateStats *psStats, GIntBig nBytes)
+{
+    if (nBytes < 0 || psStats->nFeaturesRead <= 0)
+    {
+        return -1;
+    }
+    return static_cast<GIntBig>(static_cast<double>(nBytes) / psStats->nFeaturesRead * 1e6);
+}
+
+OGRErr EliminateStatsWriteJSON(const EliminateStats *psStats, const char *pszFilename)
+{
+    return EliminateStatsWriteJSONEx(psStats, pszFilename, nullptr);
+}
+
+OGRErr EliminateStatsWriteJSONEx(const EliminateStats *psStats, const char *pszFilename, CSLConstList papszWriteSettings)
+{
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return OGRERR_FAILURE;
+    }
+
+    double dfFeaturesPerSecond = psStats->dfWallSeconds > 0.0 ? psStats->nFeaturesRead / psStats->dfWallSeconds : 0.0;
+
+    bool bOK = VSIFPrintfL(fp,
+                           "{\n"
+                           "  \"wall_seconds\": %.6f,\n"
+                           "  \"cpu_seconds\": %.6f,\n"
+                           "  \"threads\": %d,\n"
+                           "  \"features_read\": " CPL_FRMT_GIB ",\n"
+                           "  \"features_written\": " CPL_FRMT_GIB ",\n"
+                           "  \"candidates\": " CPL_FRMT_GIB ",\n"
+                           "  \"index_hits\": " CPL_FRMT_GIB ",\n"
+                           "  \"neighbors\": " CPL_FRMT_GIB ",\n"
+                           "  \"groups\": " CPL_FRMT_GIB ",\n"
+                           "  \"features_merged\": " CPL_FRMT_GIB ",\n"
+                           "  \"features_per_second\": %.1f,\n"
+                           "  \"interrupted\": %s,\n",
+                           psStats->dfWallSeconds, psStats->dfCPUSeconds, psStats->nThreads,
+                           psStats->nFeaturesRead, psStats->nFeaturesWritten,
+                           psStats->nCandidates, psStats->nIndexHits,
+                           psStats->nNeighbors, psStats->nGroups,
+                           psStats->nFeaturesMerged, dfFeaturesPerSecond,
+                           psStats->bInterrupted ? "true" : "false") > 0;
+
+    if (papszWriteSettings != nullptr)
+    {
+        bOK &= VSIFPrintfL(fp, "  \"write_settings\": {") > 0;
+        bool bFirst = true;
+        for (CSLConstList papszIter = papszWriteSettings; *papszIter != nullptr; ++papszIter)
+        {
+            char *pszKey = nullptr;
+            const char *pszValue = CPLParseNameValue(*papszIter, &pszKey);
+            if (pszKey != nullptr && pszValue != nullptr)
+            {
+                char *pszEscapedKey = CPLEscapeString(pszKey, -1, CPLES_BackslashQuotable);
+                char *pszEscapedValue = CPLEscapeString(pszValue, -1, CPLES_BackslashQuotable);
+                bOK &= VSIFPrintfL(fp, "%s\"%s\": \"%s\"", bFirst ? "" : ", ", pszEscapedKey, pszEscapedValue) > 0;
+                CPLFree(pszEscapedKey);
+                CPLFree(pszEscapedValue);
+                bFirst = false;
+            }
+            CPLFree(pszKey);
+        }
+        bOK &= VSIFPrintfL(fp, "},\n") > 0;
+    }
+
+    bOK &= VSIFPrintfL(fp, "  \"phases\": {\n") > 0;
+
+    for (int i = 0; i < ELIMINATE_PHASE_COUNT; i++)
+    {
+        const EliminatePhaseStats &sPhase = psStats->asPhases[i];
+        bOK &= VSIFPrintfL(fp,
+                           "    \"%s\": {\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"calls\": " CPL_FRMT_GIB "}%s\n",
+                           apszPhaseNames[i], sPhase.dfWallSeconds, sPhase.dfCPUSeconds,
+                           sPhase.nCalls, i + 1 < ELIMINATE_PHASE_COUNT ? "," : "") > 0;
+    }
+
+    bOK &= VSIFPrintfL(fp, "  },\n  \"stage_seconds\": {") > 0;
+
+    for (int i = 0; i < ELIMINATE_STAGE_COUNT; i++)
+    {
+        bOK &= VSIFPrintfL(fp, "%s\"%s\": %.6f", i > 0 ? ", " : "", apszStageNames[i], psStats->adfStageSeconds[i]) > 0;
+    }
+
+    bOK &= VSIFPrintfL(fp, "},\n  \"counters\": {\n") > 0;
+
+    for (int i = 0; i < ELIMINATE_STAGE_COUNT; i++)
+    {
+        const EliminateCounterStats &sCounters = psStats->asCounters[i];
+        CPLString osIPC = "null";
+        if (sCounters.nCycles > 0 && sCounters.nInstructions >= 0)
+        {
+            osIPC = CPLSPrintf("%.3f", static_cast<double>(sCounters.nInstructions) / sCounters.nCycles);
+        }
+        bOK &= VSIFPrintfL(fp,
+                           "    \"%s\": {\"cycles\": %s, \"instructions\": %s, \"ipc\": %s, \"cache_misses\": %s, \"branch_misses\": %s}%s\n",
+                           apszStageNames[i], CounterToJSON(sCounters.nCycles).c_str(),
+                           CounterToJSON(sCounters.nInstructions).c_str(), osIPC.c_str(),
+                           CounterToJSON(sCounters.nCacheMisses).c_str(),
+                           CounterToJSON(sCounters.nBranchMisses).c_str(),
+                           i + 1 < ELIMINATE_STAGE_COUNT ? "," : "") > 0;
+    }
+
+    bOK &= VSIFPrintfL(fp, "  },\n  \"memory\": {\n    \"estimated_bytes\": {\n") > 0;
+
+    for (int i = 0; i < ELIMINATE_MEMORY_COUNT; i++)
+    {
+        bOK &= VSIFPrintfL(fp, "      \"%s\": " CPL_FRMT_GIB "%s\n",
+                           apszMemoryCategoryNames[i], psStats->anMemoryBytes[i],
+                           i + 1 < ELIMINATE_MEMORY_COUNT ? "," : "") > 0;
+    }
+
+    GIntBig nEstimated = EstimatedMemoryBytes(psStats);
+    GIntBig nMeasured = MeasuredMemoryBytes(psStats);
+
+    bOK &= VSIFPrintfL(fp,
+                       "    },\n"
+                       "    \"estimated_total_bytes\": " CPL_FRMT_GIB ",\n"
+                       "    \"rss_bytes\": {\"start\": %s",
+                       nEstimated, CounterToJSON(psStats->nStartRSSBytes).c_str()) > 0;
+
+    for (int i = 0; i < ELIMINATE_STAGE_COUNT; i++)
+    {
+        bOK &= VSIFPrintfL(fp, ", \"%s\": %s", apszStageNames[i], CounterToJSON(psStats->anRSSBytes[i]).c_str()) > 0;
+    }
+
+    bOK &= VSIFPrintfL(fp,
+                       "},\n"
+                       "    \"peak_rss_bytes\": %s,\n"
+                       "    \"estimated_bytes_per_million_features\": %s,\n"
+                       "    \"measured_bytes_per_million_features\": %s\n"
+                       "  }\n}\n",
+                       CounterToJSON(psStats->nPeakRSSBytes).c_str(),
+                       CounterToJSON(PerMillionFeatures(psStats, nEstimated)).c_str(),
+                       CounterToJSON(PerMillionFeatures(psStats, nMeasured)).c_str()) > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
+
+static CPLString FormatBytes(GIntBig nBytes)
+{
+    if (nBytes < 0)
+    {
+        return "unknown";
+    }
+    return CPLSPrintf("%.1f MB", nBytes / (1024.0 * 1024.0));
+}
+
+void EliminateStatsPrintMemory(const EliminateStats *psStats, FILE *fp)
+{
+    GIntBig nEstimated = EstimatedMemoryBytes(psStats);
+
+    fprintf(fp, "Estimated memory use:\n");
+    for (int i = 0; i < ELIMINATE_MEMORY_COUNT; i++)
+    {
+        double dfShare = nEstimated > 0 ? 100.0 * psStats->anMemoryBytes[i] / nEstimated : 0.0;
+        fprintf(fp, "  %-20s %12s  %5.1f%%\n", apszMemoryCategoryNames[i],
+                FormatBytes(psStats->anMemoryBytes[i]).c_str(), dfShare);
+    }
+    fprintf(fp, "  %-20s %12s\n", "total", FormatBytes(nEstimated).c_str());
+
+    fprintf(fp, "Resident set size:\n");
+    fprintf(fp, "  %-20s %12s\n", "start", FormatBytes(psStats->nStartRSSBytes).c_str());
+    for (int i = 0; i < ELIMINATE_STAGE_COUNT; i++)
+    {
+        fprintf(fp, "  %-20s %12s\n", CPLSPrintf("after %s", apszStageNames[i]),
+                FormatBytes(psStats->anRSSBytes[i]).c_str());
+    }
+    fprintf(fp, "  %-20s %12s\n", "peak", FormatBytes(psStats->nPeakRSSBytes).c_str());
+
+    fprintf(fp, "Projected per million features: %s estimated, %s measured\n",
+            FormatBytes(PerMillionFeatures(psStats, nEstimated)).c_str(),
+            FormatBytes(PerMillionFeatures(psStats, MeasuredMemoryBytes(psStats))).c_str());
+}
+
+StatsCollector::StatsCollector(bool bEnabled) :
+    m_bEnabled(bEnabled), m_poTrace(nullptr), m_tStart(std::chrono::steady_clock::now()), m_tStageStart(m_tStart),
+    m_dfCPUStart(bEnabled ? processCPUSeconds() : 0.0)
+{
+    memset(&m_sStats, 0, sizeof(m_sStats));
+    m_sStats.nThreads = 1;
+    for (EliminateCounterStats &sCounters : m_sStats.asCounters)
+    {
+        sCounters.nCycles = -1;
+        sCounters.nInstructions = -1;
+        sCounters.nCacheMisses = -1;
+        sCounters.nBranchMisses = -1;
+    }
+    m_sStats.nStartRSSBytes = bEnabled ? currentRSSBytes() : -1;
+    for (GIntBig &nRSS : m_sStats.anRSSBytes)
+    {
+        nRSS = -1;
+    }
+    m_sStats.nPeakRSSBytes = -1;
+}
+
+void StatsCollector::endStage(EliminateStage eStage)
+{
+    if (m_bEnabled)
+    {
+        std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+        std::chrono::duration<double> dfElapsed = tNow - m_tStageStart;
+        m_sStats.adfStageSeconds[eStage] += dfElapsed.count();
+        m_tStageStart = tNow;
+        m_sStats.anRSSBytes[eStage] = currentRSSBytes();
+    }
+}
+
+static void AddCount(GIntBig &nTotal, GIntBig nCount)
+{
+    if (nCount >= 0)
+    {
+        nTotal = nTotal < 0 ? nCount : nTotal + nCount;
+    }
+}
+
+void StatsCollector::merge(const StatsCollector &oOther)
+{
+    if (!m_bEnabled)
+    {
+        return;
+    }
+
+    for (int i = 0; i < ELIMINATE_PHASE_COUNT; i++)
+    {
+        m_sStats.asPhases[i].dfWallSeconds += oOther.m_sStats.asPhases[i].dfWallSeconds;
+        m_sStats.asPhases[i].dfCPUSeconds += oOther.m_sStats.asPhases[i].dfCPUSeconds;
+        m_sStats.asPhases[i].nCalls += oOther.m_sStats.asPhases[i].nCalls;
+    }
+    for (int i = 0; i < ELIMINATE_STAGE_COUNT; i++)
+    {
+        AddCount(m_sStats.asCounters[i].nCycles, oOther.m_sStats.asCounters[i].nCycles);
+        AddCount(m_sStats.asCounters[i].nInstructions, oOther.m_sStats.asCounters[i].nInstructions);
+        AddCount(m_sStats.asCounters[i].nCacheMisses, oOther.m_sStats.asCounters[i].nCacheMisses);
+        AddCount(m_sStats.asCounters[i].nBranchMisses, oOther.m_sStats.asCounters[i].nBranchMisses);
+    }
+    for (int i = 0; i < ELIMINATE_MEMORY_COUNT; i++)
+    {
+        m_sStats.anMemoryBytes[i] += oOther.m_sStats.anMemoryBytes[i];
+    }
+    m_sStats.nFeaturesRead += oOther.m_sStats.nFeaturesRead;
+    m_sStats.nFeaturesWritten += oOther.m_sStats.nFeaturesWritten;
+    m_sStats.nCandidates += oOther.m_sStats.nCandidates;
+    m_sStats.nIndexHits += oOther.m_sStats.nIndexHits;
+    m_sStats.nNeighbors += oOther.m_sStats.nNeighbors;
+    m_sStats.nGroups += oOther.m_sStats.nGroups;
+    m_sStats.nFeaturesMerged += oOther.m_sStats.nFeaturesMerged;
+}
+
+void StatsCollector::finish(EliminateStats *psStats)
+{
+    if (!m_bEnabled)
+    {
+        return;
+    }
+
+    std::chrono::duration<double> dfElapsed = std::chrono::steady_clock::now() - m_tStart;
+    m_sStats.dfWallSeconds = dfElapsed.count();
+    m_sStats.dfCPUSeconds = processCPUSeconds() - m_dfCPUStart;
+    m_sStats.nPeakRSSBytes = peakRSSBytes();
+
+    if (psStats != nullptr)
+    {
+        *psStats = m_sStats;
+    }
+}
+
+InterruptWatch::InterruptWatch(GDALProgressFunc pfnProgress, void *pProgressData) :
+    m_pfnProgress(pfnProgress), m_pProgressData(pProgressData), m_bInterrupted(false)
+{
+}
+
+int CPL_STDCALL InterruptWatch::Progress(double dfComplete, const char *pszMessage, void *pProgressData)
+{
+    InterruptWatch *poWatch = static_cast<InterruptWatch *>(pProgressData);
+    if (poWatch->m_pfnProgress != nullptr && !poWatch->m_pfnProgress(dfComplete, pszMessage, poWatch->m_pProgressData))
+    {
+        poWatch->m_bInterrupted = true;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+
+static double ClockSeconds(clockid_t nClock)
+{
+    struct timespec sTime;
+    if (clock_gettime(nClock, &sTime) != 0)
+    {
+        return 0.0;
+    }
+    return sTime.tv_sec + sTime.tv_nsec * 1e-9;
+}
+
+double StatsCollector::threadCPUSeconds()
+{
+    return ClockSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+double StatsCollector::processCPUSeconds()
+{
+    return ClockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+#else
+
+// No per-thread clock available, so fall back to process time for both.
+//
+double StatsCollector::threadCPUSeconds()
+{
+    return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+double StatsCollector::processCPUSeconds()
+{
+    return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+#endif
+
+#if defined(__linux__)
+
+GIntBig StatsCollector::currentRSSBytes()
+{
+    // The second field of statm is the resident set size in pages.
+    VSILFILE *fp = VSIFOpenL("/proc/self/statm", "rb");
+    if (fp == nullptr)
+    {
+        return -1;
+    }
+    char szBuffer[128] = {};
+    VSIFReadL(szBuffer, 1, sizeof(szBuffer) - 1, fp);
+    VSIFCloseL(fp);
+
+    long long nSize = 0;
+    long long nResident = 0;
+    if (sscanf(szBuffer, "%lld %lld", &nSize, &nResident) != 2)
+    {
+        return -1;
+    }
+    return static_cast<GIntBig>(nResident) * sysconf(_SC_PAGESIZE);
+}
+
+#else
+
+GIntBig StatsCollector::currentRSSBytes()
+{
+    return -1;
+}
+
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+GIntBig StatsCollector::peakRSSBytes()
+{
+    struct rusage sUsage;
+    if (getrusage(RUSAGE_SELF, &sUsage) != 0)
+    {
+        return -1;
+    }
+#if defined(__APPLE__)
+    return static_cast<GIntBig>(sUsage.ru_maxrss);
+#else
+    return static_cast<GIntBig>(sUsage.ru_maxrss) * 1024;
+#endif
+}
+
+#else
+
+GIntBig StatsCollector::peakRSSBytes()
+{
+    return -1;
+}
+
+#endif
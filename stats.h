@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include "gdal.h"
+
+CPL_C_START
+
+typedef enum
+{
+    ELIMINATE_PHASE_READ = 0,
+    ELIMINATE_PHASE_GEOS_EXPORT,
+    ELIMINATE_PHASE_PREPARE,
+    ELIMINATE_PHASE_INDEX,
+    ELIMINATE_PHASE_QUERY,
+    ELIMINATE_PHASE_TOUCHES,
+    ELIMINATE_PHASE_INTERSECTION,
+    ELIMINATE_PHASE_UNION,
+    ELIMINATE_PHASE_GEOS_IMPORT,
+    ELIMINATE_PHASE_WRITE,
+    ELIMINATE_PHASE_COUNT
+} EliminatePhase;
+
+typedef struct
+{
+    double dfWallSeconds;
+    double dfCPUSeconds;
+    GIntBig nCalls;
+} EliminatePhaseStats;
+
+/* The coarse stages that hardware counters are sampled around. Explode reads
+ * and writes in a single pass, which is reported as the write stage.
+ */
+typedef enum
+{
+    ELIMINATE_STAGE_READ = 0,
+    ELIMINATE_STAGE_NEIGHBORS,
+    ELIMINATE_STAGE_WRITE,
+    ELIMINATE_STAGE_COUNT
+} EliminateStage;
+
+/* Counts are -1 when the counter was not requested or is unavailable. They
+ * cover the worker threads of a stage as well as the calling thread.
+ */
+typedef struct
+{
+    GIntBig nCycles;
+    GIntBig nInstructions;
+    GIntBig nCacheMisses;
+    GIntBig nBranchMisses;
+} EliminateCounterStats;
+
+/* Where the memory held during an eliminate run goes. The sizes are
+ * estimates built from coordinate and item counts, not allocator totals.
+ */
+typedef enum
+{
+    ELIMINATE_MEMORY_FEATURES = 0,
+    ELIMINATE_MEMORY_GEOS_GEOMETRIES,
+    ELIMINATE_MEMORY_PREPARED_GEOMETRIES,
+    ELIMINATE_MEMORY_INDEX,
+    ELIMINATE_MEMORY_NEIGHBORS,
+    ELIMINATE_MEMORY_COUNT
+} EliminateMemoryCategory;
+
+/* Filled in by the functions that take an EliminateStats pointer, such as
+ * EliminatePolygonsEx() and ExplodeEx(), when it is non-null. Phase times
+ * are summed over every call made in that phase; the top level times cover
+ * the whole run.
+ */
+typedef struct
+{
+    EliminatePhaseStats asPhases[ELIMINATE_PHASE_COUNT];
+    EliminateCounterStats asCounters[ELIMINATE_STAGE_COUNT];
+    /* Wall time of each stage, as seen by the calling thread. */
+    double adfStageSeconds[ELIMINATE_STAGE_COUNT];
+    GIntBig anMemoryBytes[ELIMINATE_MEMORY_COUNT];
+    /* Resident set size at the start of the run and at the end of each
+     * stage, and the peak for the process so far. -1 where the platform
+     * can't tell us.
+     */
+    GIntBig nStartRSSBytes;
+    GIntBig anRSSBytes[ELIMINATE_STAGE_COUNT];
+    GIntBig nPeakRSSBytes;
+    double dfWallSeconds;
+    double dfCPUSeconds;
+    int nThreads;
+    GIntBig nFeaturesRead;
+    GIntBig nFeaturesWritten;
+    GIntBig nCandidates;
+    GIntBig nIndexHits;
+    GIntBig nNeighbors;
+    GIntBig nGroups;
+    GIntBig nFeaturesMerged;
+    /* Set if the run was cancelled, or timed out, before it finished, in
+     * which case the rest covers only what was done until then.
+     */
+    int bInterrupted;
+} EliminateStats;
+
+const char *EliminatePhaseName(EliminatePhase ePhase);
+const char *EliminateStageName(EliminateStage eStage);
+const char *EliminateMemoryCategoryName(EliminateMemoryCategory eCategory);
+OGRErr EliminateStatsWriteJSON(const EliminateStats *psStats, const char *pszFilename);
+/* As above, also recording how the destination was written, given as
+ * name=value pairs, in a "write_settings" object.
+ */
+OGRErr EliminateStatsWriteJSONEx(const EliminateStats *psStats, const char *pszFilename, CSLConstList papszWriteSettings);
+
+/* Writes a human readable breakdown of the memory stats, including the
+ * projected requirement per million input features.
+ */
+void EliminateStatsPrintMemory(const EliminateStats *psStats, FILE *fp);
+
+CPL_C_END
+
+#endif // STATS_H_INCLUDED
@@ -0,0 +1,175 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef STATSCOLLECTOR_H_INCLUDED
+#define STATSCOLLECTOR_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+
+#include "stats.h"
+#include "trace.h"
+
+// The library's C++ side of stats.h, which is the only one of the two that
+// is installed.
+//
+// Accumulates an EliminateStats for one thread of work. Everything is a
+// no-op unless the collector was enabled, so the library can leave the
+// calls in place unconditionally. When given a trace buffer, each timed
+// phase is also recorded on the timeline.
+//
+class StatsCollector
+{
+    bool m_bEnabled;
+    Tracer::Buffer *m_poTrace;
+    EliminateStats m_sStats;
+    std::chrono::steady_clock::time_point m_tStart;
+    std::chrono::steady_clock::time_point m_tStageStart;
+    double m_dfCPUStart;
+
+public:
+    explicit StatsCollector(bool bEnabled);
+
+    bool enabled() const
+    {
+        return m_bEnabled;
+    }
+
+    EliminateStats &stats()
+    {
+        return m_sStats;
+    }
+
+    void setTrace(Tracer::Buffer *poTrace)
+    {
+        m_poTrace = poTrace;
+    }
+
+    Tracer::Buffer *trace() const
+    {
+        return m_poTrace;
+    }
+
+    void add(GIntBig EliminateStats::*pnCounter, GIntBig nCount = 1)
+    {
+        if (m_bEnabled)
+        {
+            m_sStats.*pnCounter += nCount;
+        }
+    }
+
+    void addMemory(EliminateMemoryCategory eCategory, GIntBig nBytes)
+    {
+        if (m_bEnabled)
+        {
+            m_sStats.anMemoryBytes[eCategory] += nBytes;
+        }
+    }
+
+    // Records the wall time since the previous stage ended, or since the
+    // collector was created, and the resident set size.
+    void endStage(EliminateStage eStage);
+
+    void merge(const StatsCollector &oOther);
+
+    // Records the run totals and copies the result out, if requested.
+    void finish(EliminateStats *psStats);
+
+    static double threadCPUSeconds();
+    static double processCPUSeconds();
+
+    // Both return -1 if unknown. The peak is over the life of the process.
+    static GIntBig currentRSSBytes();
+    static GIntBig peakRSSBytes();
+
+    class Scope
+    {
+        StatsCollector &m_oCollector;
+        EliminatePhase m_ePhase;
+        std::chrono::steady_clock::time_point m_tStart;
+        double m_dfCPUStart;
+
+    public:
+        Scope(StatsCollector &oCollector, EliminatePhase ePhase) :
+            m_oCollector(oCollector), m_ePhase(ePhase), m_dfCPUStart(0.0)
+        {
+            if (m_oCollector.m_bEnabled)
+            {
+                m_dfCPUStart = threadCPUSeconds();
+            }
+            if (m_oCollector.m_bEnabled || m_oCollector.m_poTrace != nullptr)
+            {
+                m_tStart = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Scope()
+        {
+            if (m_oCollector.m_bEnabled || m_oCollector.m_poTrace != nullptr)
+            {
+                std::chrono::steady_clock::time_point tEnd = std::chrono::steady_clock::now();
+                if (m_oCollector.m_bEnabled)
+                {
+                    std::chrono::duration<double> dfElapsed = tEnd - m_tStart;
+                    EliminatePhaseStats &sPhase = m_oCollector.m_sStats.asPhases[m_ePhase];
+                    sPhase.dfWallSeconds += dfElapsed.count();
+                    sPhase.dfCPUSeconds += threadCPUSeconds() - m_dfCPUStart;
+                    sPhase.nCalls++;
+                }
+                if (m_oCollector.m_poTrace != nullptr)
+                {
+                    m_oCollector.m_poTrace->add(EliminatePhaseName(m_ePhase), m_tStart, tEnd);
+                }
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+};
+
+// Passes progress on to the caller's callback, noting whether it asked to
+// stop, so that the stats of a cancelled or timed out run can be written
+// and say so. Progress() may be called from any thread.
+//
+class InterruptWatch
+{
+    GDALProgressFunc m_pfnProgress;
+    void *m_pProgressData;
+    std::atomic<bool> m_bInterrupted;
+
+public:
+    InterruptWatch(GDALProgressFunc pfnProgress, void *pProgressData);
+
+    InterruptWatch(const InterruptWatch &) = delete;
+    InterruptWatch &operator=(const InterruptWatch &) = delete;
+
+    static int CPL_STDCALL Progress(double dfComplete, const char *pszMessage, void *pProgressData);
+
+    bool interrupted() const
+    {
+        return m_bInterrupted;
+    }
+};
+
+#endif // STATSCOLLECTOR_H_INCLUDED
@@ -0,0 +1,50 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "threaderrors.h"
+
+
+void CPL_STDCALL ThreadErrors::Handler(CPLErr eErrClass, CPLErrorNum nErrorNum, const char *pszMessage)
+{
+    ThreadErrors *poErrors = static_cast<ThreadErrors *>(CPLGetErrorHandlerUserData());
+    poErrors->m_asErrors.push_back({eErrClass, nErrorNum, pszMessage});
+}
+
+ThreadErrors::Scope::Scope(ThreadErrors &oErrors)
+{
+    CPLPushErrorHandlerEx(ThreadErrors::Handler, &oErrors);
+}
+
+ThreadErrors::Scope::~Scope()
+{
+    CPLPopErrorHandler();
+}
+
+void ThreadErrors::replay() const
+{
+    for (const error_t &sError : m_asErrors)
+    {
+        CPLError(sError.eErrClass, sError.nErrorNum, "%s", sError.osMessage.c_str());
+    }
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef THREADERRORS_H_INCLUDED
+#define THREADERRORS_H_INCLUDED
+
+#include <vector>
+
+#include "cpl_error.h"
+#include "cpl_string.h"
+
+// CPLError handlers are per thread, so an error raised on one of our
+// worker threads goes to the process default handler rather than to the
+// one the caller installed around its call. Workers collect their errors
+// instead, and the calling thread raises them again once the workers have
+// finished, so each call's errors reach that call's handler.
+//
+class ThreadErrors
+{
+    struct error_t
+    {
+        CPLErr eErrClass;
+        CPLErrorNum nErrorNum;
+        CPLString osMessage;
+    };
+
+    std::vector<error_t> m_asErrors;
+
+    static void CPL_STDCALL Handler(CPLErr eErrClass, CPLErrorNum nErrorNum, const char *pszMessage);
+
+public:
+    // Collects the errors raised on the current thread while in scope.
+    class Scope
+    {
+    public:
+        explicit Scope(ThreadErrors &oErrors);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Raises the collected errors, in order, on the current thread.
+    void replay() const;
+};
+
+#endif // THREADERRORS_H_INCLUDED
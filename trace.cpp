@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "trace.h"
+
+
+Tracer::Tracer(size_t nMaxEventsPerThread) :
+    m_tOrigin(clock_t::now()), m_nMaxEventsPerThread(nMaxEventsPerThread)
+{
+}
+
+Tracer::Buffer *Tracer::createBuffer(const char *pszThreadName)
+{
+    std::lock_guard<std::mutex> oLock(m_oMutex);
+    int nTID = static_cast<int>(m_lstBuffers.size()) + 1;
+    m_lstBuffers.emplace_back(nTID, pszThreadName, m_nMaxEventsPerThread);
+    return &m_lstBuffers.back();
+}
+
+bool Tracer::write(const char *pszFilename)
+{
+    std::lock_guard<std::mutex> oLock(m_oMutex);
+
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return false;
+    }
+
+    // Timestamps are in microseconds from the creation of the tracer.
+    //
+    auto toMicroseconds = [this](clock_t::time_point t) {
+        return std::chrono::duration<double, std::micro>(t - m_tOrigin).count();
+    };
+
+    bool bOK = VSIFPrintfL(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n") > 0;
+    bool bFirst = true;
+
+    for (const Buffer &oBuffer : m_lstBuffers)
+    {
+        char *pszEscaped = CPLEscapeString(oBuffer.m_osThreadName.c_str(), -1, CPLES_BackslashQuotable);
+        bOK &= VSIFPrintfL(fp,
+                           "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                           bFirst ? "" : ",\n", oBuffer.m_nTID, pszEscaped) > 0;
+        CPLFree(pszEscaped);
+        bFirst = false;
+
+        for (const Buffer::event_t &sEvent : oBuffer.m_asEvents)
+        {
+            bOK &= VSIFPrintfL(fp,
+                               ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                               sEvent.pszName, oBuffer.m_nTID, toMicroseconds(sEvent.tStart),
+                               toMicroseconds(sEvent.tEnd) - toMicroseconds(sEvent.tStart)) > 0;
+        }
+
+        if (oBuffer.m_nDropped > 0)
+        {
+            CPLError(CE_Warning, CPLE_AppDefined,
+                     "Trace buffer for thread '%s' was full; " CPL_FRMT_GIB " events dropped.",
+                     oBuffer.m_osThreadName.c_str(), oBuffer.m_nDropped);
+        }
+    }
+
+    bOK &= VSIFPrintfL(fp, "\n]}\n") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cpl_port.h"
+
+// Records a timeline of the run in the Chrome trace event format, which
+// can be loaded into chrome://tracing or Perfetto. Each thread records into
+// a buffer of its own, so recording never takes a lock; the buffers are
+// only gathered when the file is written.
+//
+class Tracer
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    class Buffer
+    {
+        friend class Tracer;
+
+        struct event_t
+        {
+            const char *pszName;
+            clock_t::time_point tStart;
+            clock_t::time_point tEnd;
+        };
+
+        int m_nTID;
+        std::string m_osThreadName;
+        size_t m_nMaxEvents;
+        GIntBig m_nDropped;
+        std::vector<event_t> m_asEvents;
+
+    public:
+        Buffer(int nTID, const char *pszThreadName, size_t nMaxEvents) :
+            m_nTID(nTID), m_osThreadName(pszThreadName),
+            m_nMaxEvents(nMaxEvents), m_nDropped(0)
+        {
+        }
+
+        // The name must outlive the tracer; in practice it is a literal.
+        void add(const char *pszName, clock_t::time_point tStart, clock_t::time_point tEnd)
+        {
+            if (m_asEvents.size() < m_nMaxEvents)
+            {
+                m_asEvents.push_back({pszName, tStart, tEnd});
+            }
+            else
+            {
+                m_nDropped++;
+            }
+        }
+    };
+
+    // Records a span that isn't one of the timed phases, such as a whole
+    // merge group. Does nothing given a null buffer.
+    class Scope
+    {
+        Buffer *m_poBuffer;
+        const char *m_pszName;
+        clock_t::time_point m_tStart;
+
+    public:
+        Scope(Buffer *poBuffer, const char *pszName) :
+            m_poBuffer(poBuffer), m_pszName(pszName)
+        {
+            if (m_poBuffer != nullptr)
+            {
+                m_tStart = clock_t::now();
+            }
+        }
+
+        ~Scope()
+        {
+            if (m_poBuffer != nullptr)
+            {
+                m_poBuffer->add(m_pszName, m_tStart, clock_t::now());
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    static constexpr size_t DEFAULT_MAX_EVENTS = 1 << 22;
+
+private:
+    std::mutex m_oMutex;
+    std::list<Buffer> m_lstBuffers;
+    clock_t::time_point m_tOrigin;
+    size_t m_nMaxEventsPerThread;
+
+public:
+    explicit Tracer(size_t nMaxEventsPerThread = DEFAULT_MAX_EVENTS);
+
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    // Each thread must take its own buffer. The buffer lives as long as
+    // the tracer.
+    Buffer *createBuffer(const char *pszThreadName);
+
+    // Must only be called once all recording threads have finished.
+    bool write(const char *pszFilename);
+};
+
+#endif // TRACE_H_INCLUDED
@@ -0,0 +1,282 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <cmath>
+#include <map>
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "verify.h"
+
+
+static const struct
+{
+    const char *pszName;
+    const char *pszDescription;
+} asKinds[Verifier::KIND_COUNT] = {
+    {"missing_neighbor", "Touching neighbor not found"},
+    {"extra_neighbor", "Neighbor found that does not touch"},
+    {"boundary_length", "Shared boundary length differs"},
+    {"merge_target", "Merged into a different neighbor"},
+    {"geometry", "Merged geometry differs"},
+};
+
+static CPLString DescribeCreature(const FeatureCreature *poCreature)
+{
+    return poCreature != nullptr ? CPLString(CPLSPrintf(CPL_FRMT_GIB, poCreature->feature()->GetFID())) : CPLString("none");
+}
+
+Verifier::Verifier(GEOSContextHandle_t hGEOSCtxt, double dfTolerance, size_t nSample, size_t nCandidates, size_t nGroups) :
+    m_hGEOSCtxt(hGEOSCtxt), m_dfTolerance(dfTolerance),
+    m_nCandidateStride(nSample == 0 ? 1 : std::max<size_t>(1, nCandidates / nSample)),
+    m_nGroupStride(nSample == 0 ? 1 : std::max<size_t>(1, nGroups / nSample)),
+    m_nFeaturesChecked(0), m_nGroupsChecked(0)
+{
+}
+
+const char *Verifier::kindName(Kind eKind)
+{
+    return asKinds[eKind].pszName;
+}
+
+void Verifier::add(Kind eKind, GIntBig nFID, const char *pszDetail)
+{
+    m_asDiscrepancies.push_back({eKind, nFID, pszDetail});
+}
+
+void Verifier::verifyNeighbors(FeatureCreature *poCreature, GEOSSTRtree *poSTRTree, EliminateMergeType eMergeType,
+                               FeatureCreature *poChosen)
+{
+    m_nFeaturesChecked++;
+
+    GIntBig nFID = poCreature->feature()->GetFID();
+    GEOSGeometry *poGeometry = poCreature->geometry();
+
+    std::list<FeatureCreature *> lstpoHits;
+    FeatureCreature::query_t query = {poCreature, &lstpoHits};
+    GEOSSTRtree_query_r(m_hGEOSCtxt, poSTRTree, poGeometry, FeatureCreature::query_t::callback, &query);
+
+    std::list<FeatureCreature::neighbor_t> lstReference;
+    for (auto poHit : lstpoHits)
+    {
+        if (GEOSTouches_r(m_hGEOSCtxt, poGeometry, poHit->geometry()) != 1)
+        {
+            continue;
+        }
+
+        double dfLength = 0.0;
+        GEOSGeometry *poIntersection = GEOSIntersection_r(m_hGEOSCtxt, poGeometry, poHit->geometry());
+        if (poIntersection != nullptr)
+        {
+            GEOSLength_r(m_hGEOSCtxt, poIntersection, &dfLength);
+            GEOSGeom_destroy_r(m_hGEOSCtxt, poIntersection);
+        }
+        lstReference.push_back({poHit, dfLength});
+    }
+
+    std::map<FeatureCreature *, double> oActual;
+    for (const auto &sNeighbor : poCreature->neighbors())
+    {
+        oActual[sNeighbor.poCreature] = sNeighbor.dfBoundaryLength;
+    }
+
+    for (const auto &sReference : lstReference)
+    {
+        auto oIter = oActual.find(sReference.poCreature);
+        if (oIter == oActual.end())
+        {
+            add(MISSING_NEIGHBOR, nFID, CPLSPrintf("neighbor %s", DescribeCreature(sReference.poCreature).c_str()));
+            continue;
+        }
+        if (std::fabs(oIter->second - sReference.dfBoundaryLength) > m_dfTolerance)
+        {
+            add(BOUNDARY_LENGTH, nFID, CPLSPrintf("boundary with %s is %.17g, reference %.17g",
+                                                  DescribeCreature(sReference.poCreature).c_str(),
+                                                  oIter->second, sReference.dfBoundaryLength));
+        }
+        oActual.erase(oIter);
+    }
+
+    for (const auto &oExtra : oActual)
+    {
+        add(EXTRA_NEIGHBOR, nFID, CPLSPrintf("neighbor %s", DescribeCreature(oExtra.first).c_str()));
+    }
+
+    FeatureCreature::neighbor_t::comp_t comp = FeatureCreature::neighbor_t::comparator(eMergeType);
+    auto itrReference = std::min_element(lstReference.begin(), lstReference.end(), comp);
+    FeatureCreature *poReference = itrReference != lstReference.end() ? itrReference->poCreature : nullptr;
+    if (poReference == poChosen)
+    {
+        return;
+    }
+
+    // Neighbors that are equally good by the merge criterion are a tie,
+    // which either path may break its own way.
+    if (poReference != nullptr && poChosen != nullptr)
+    {
+        auto itrChosen = std::find_if(lstReference.begin(), lstReference.end(),
+                                      [poChosen](const FeatureCreature::neighbor_t &sNeighbor) { return sNeighbor.poCreature == poChosen; });
+        if (itrChosen != lstReference.end())
+        {
+            double dfDifference = eMergeType == ELIMINATE_MERGE_LONGEST_BOUNDARY ?
+                                  itrChosen->dfBoundaryLength - itrReference->dfBoundaryLength :
+                                  poChosen->area() - poReference->area();
+            if (std::fabs(dfDifference) <= m_dfTolerance)
+            {
+                return;
+            }
+        }
+    }
+
+    add(MERGE_TARGET, nFID, CPLSPrintf("merged into %s, reference %s",
+                                       DescribeCreature(poChosen).c_str(), DescribeCreature(poReference).c_str()));
+}
+
+void Verifier::verifyUnion(FeatureCreature *poCreature, const std::list<FeatureCreature *> &lstpoCreaturesToMerge,
+                           const OGRGeometry *poOutput)
+{
+    m_nGroupsChecked++;
+
+    GIntBig nFID = poCreature->feature()->GetFID();
+
+    // Start again from the features as read, rather than the GEOS
+    // geometries the run already holds.
+    std::vector<GEOSGeometry *> vecGeometries;
+    vecGeometries.push_back(poCreature->feature()->GetGeometryRef()->exportToGEOS(m_hGEOSCtxt));
+    for (auto poCreatureToMerge : lstpoCreaturesToMerge)
+    {
+        vecGeometries.push_back(poCreatureToMerge->feature()->GetGeometryRef()->exportToGEOS(m_hGEOSCtxt));
+    }
+    vecGeometries.erase(std::remove(vecGeometries.begin(), vecGeometries.end(), nullptr), vecGeometries.end());
+
+    GEOSGeometry *poCollection = GEOSGeom_createCollection_r(m_hGEOSCtxt, GEOS_GEOMETRYCOLLECTION, vecGeometries.data(), vecGeometries.size());
+    GEOSGeometry *poReference = poCollection != nullptr ? GEOSUnaryUnion_r(m_hGEOSCtxt, poCollection) : nullptr;
+    GEOSGeometry *poActual = poOutput != nullptr ? poOutput->exportToGEOS(m_hGEOSCtxt) : nullptr;
+
+    if (poReference == nullptr)
+    {
+        add(GEOMETRY, nFID, "reference union failed");
+    }
+    else if (poActual == nullptr)
+    {
+        add(GEOMETRY, nFID, "no merged geometry");
+    }
+    else
+    {
+        double dfDistance = 0.0;
+        double dfActualArea = 0.0;
+        double dfReferenceArea = 0.0;
+        if (GEOSHausdorffDistance_r(m_hGEOSCtxt, poActual, poReference, &dfDistance) != 1 || dfDistance > m_dfTolerance)
+        {
+            add(GEOMETRY, nFID, CPLSPrintf("Hausdorff distance %.17g from reference", dfDistance));
+        }
+        else if (GEOSArea_r(m_hGEOSCtxt, poActual, &dfActualArea) == 1 && GEOSArea_r(m_hGEOSCtxt, poReference, &dfReferenceArea) == 1 &&
+                 std::fabs(dfActualArea - dfReferenceArea) > m_dfTolerance * std::max(1.0, dfReferenceArea))
+        {
+            add(GEOMETRY, nFID, CPLSPrintf("area %.17g, reference %.17g", dfActualArea, dfReferenceArea));
+        }
+    }
+
+    if (poActual != nullptr)
+    {
+        GEOSGeom_destroy_r(m_hGEOSCtxt, poActual);
+    }
+    if (poReference != nullptr)
+    {
+        GEOSGeom_destroy_r(m_hGEOSCtxt, poReference);
+    }
+    if (poCollection != nullptr)
+    {
+        GEOSGeom_destroy_r(m_hGEOSCtxt, poCollection);
+    }
+}
+
+void Verifier::report() const
+{
+    CPLDebug("ELIMINATE", "Verified " CPL_FRMT_GIB " feature(s) and " CPL_FRMT_GIB " merge group(s).",
+             m_nFeaturesChecked, m_nGroupsChecked);
+
+    for (int i = 0; i < KIND_COUNT; i++)
+    {
+        size_t nCount = 0;
+        CPLString osFIDs;
+        for (const auto &sDiscrepancy : m_asDiscrepancies)
+        {
+            if (sDiscrepancy.eKind != i)
+            {
+                continue;
+            }
+            if (nCount < MAX_REPORTED)
+            {
+                osFIDs += CPLSPrintf("%s" CPL_FRMT_GIB, nCount > 0 ? ", " : "", sDiscrepancy.nFID);
+            }
+            else if (nCount == MAX_REPORTED)
+            {
+                osFIDs += ", ...";
+            }
+            nCount++;
+        }
+
+        if (nCount > 0)
+        {
+            CPLError(CE_Warning, CPLE_AppDefined, "%s: %d feature(s) (FID %s).",
+                     asKinds[i].pszDescription, static_cast<int>(nCount), osFIDs.c_str());
+        }
+    }
+}
+
+bool Verifier::write(const char *pszFilename) const
+{
+    VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+    if (fp == nullptr)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot create %s.", pszFilename);
+        return false;
+    }
+
+    bool bOK = VSIFPrintfL(fp, "{\n  \"features_checked\": " CPL_FRMT_GIB ",\n  \"groups_checked\": " CPL_FRMT_GIB
+                           ",\n  \"tolerance\": %.17g,\n  \"discrepancies\": [",
+                           m_nFeaturesChecked, m_nGroupsChecked, m_dfTolerance) > 0;
+    for (size_t i = 0; i < m_asDiscrepancies.size(); i++)
+    {
+        const discrepancy_t &sDiscrepancy = m_asDiscrepancies[i];
+        char *pszEscapedDetail = CPLEscapeString(sDiscrepancy.osDetail.c_str(), -1, CPLES_BackslashQuotable);
+        bOK &= VSIFPrintfL(fp, "%s\n    {\"kind\": \"%s\", \"fid\": " CPL_FRMT_GIB ", \"detail\": \"%s\"}",
+                           i > 0 ? "," : "", kindName(sDiscrepancy.eKind), sDiscrepancy.nFID,
+                           pszEscapedDetail) > 0;
+        CPLFree(pszEscapedDetail);
+    }
+    bOK &= VSIFPrintfL(fp, "%s]\n}\n", m_asDiscrepancies.empty() ? "" : "\n  ") > 0;
+
+    if (VSIFCloseL(fp) != 0 || !bOK)
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Failed writing %s.", pszFilename);
+        return false;
+    }
+
+    return true;
+}
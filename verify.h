@@ -0,0 +1,122 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef VERIFY_H_INCLUDED
+#define VERIFY_H_INCLUDED
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "cpl_port.h"
+
+#include "geos_c.h"
+
+#include "featurecreature.h"
+
+// Checks the neighbors, merge targets and merged geometries produced by a
+// run against the plain reference computation: unprepared GEOS touches and
+// intersection for each index hit, and a unary union of the features as
+// read. Any faster path must agree with it to within the tolerance.
+// Discrepancies are kept by FID and summarized at the end, as diagnostics
+// are. Runs on the calling thread only.
+//
+class Verifier
+{
+public:
+    enum Kind
+    {
+        MISSING_NEIGHBOR = 0,
+        EXTRA_NEIGHBOR,
+        BOUNDARY_LENGTH,
+        MERGE_TARGET,
+        GEOMETRY,
+        KIND_COUNT
+    };
+
+    struct discrepancy_t
+    {
+        Kind eKind;
+        GIntBig nFID;
+        std::string osDetail;
+    };
+
+    static constexpr double DEFAULT_TOLERANCE = 1e-6;
+    static constexpr size_t MAX_REPORTED = 16;
+
+private:
+    GEOSContextHandle_t m_hGEOSCtxt;
+    double m_dfTolerance;
+    size_t m_nCandidateStride;
+    size_t m_nGroupStride;
+    GIntBig m_nFeaturesChecked;
+    GIntBig m_nGroupsChecked;
+    std::vector<discrepancy_t> m_asDiscrepancies;
+
+    void add(Kind eKind, GIntBig nFID, const char *pszDetail);
+
+public:
+    // With nSample 0 everything is checked, otherwise about nSample of the
+    // nCandidates candidates, and nSample of the nGroups merge groups.
+    Verifier(GEOSContextHandle_t hGEOSCtxt, double dfTolerance, size_t nSample, size_t nCandidates, size_t nGroups);
+
+    Verifier(const Verifier &) = delete;
+    Verifier &operator=(const Verifier &) = delete;
+
+    // i counts candidates in plan order.
+    bool candidateSampled(size_t i) const
+    {
+        return i % m_nCandidateStride == 0;
+    }
+
+    // i counts merge groups in the order they are output.
+    bool groupSampled(size_t i) const
+    {
+        return i % m_nGroupStride == 0;
+    }
+
+    // poChosen is the target the run picked, or null if it picked none.
+    void verifyNeighbors(FeatureCreature *poCreature, GEOSSTRtree *poSTRTree, EliminateMergeType eMergeType,
+                         FeatureCreature *poChosen);
+
+    void verifyUnion(FeatureCreature *poCreature, const std::list<FeatureCreature *> &lstpoCreaturesToMerge,
+                     const OGRGeometry *poOutput);
+
+    bool empty() const
+    {
+        return m_asDiscrepancies.empty();
+    }
+
+    size_t count() const
+    {
+        return m_asDiscrepancies.size();
+    }
+
+    void report() const;
+    bool write(const char *pszFilename) const;
+
+    static const char *kindName(Kind eKind);
+};
+
+#endif // VERIFY_H_INCLUDED
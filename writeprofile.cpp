@@ -0,0 +1,229 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include <utility>
+
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "gdal_priv.h"
+
+#include "writeprofile.h"
+
+
+enum WriteSettingKind
+{
+    WRITE_SETTING_DSCO,
+    WRITE_SETTING_LCO,
+    WRITE_SETTING_CONFIG,
+    WRITE_SETTING_TRANSACTION
+};
+
+struct write_setting_t
+{
+    const char *pszDriver;
+    WriteSettingKind eKind;
+    const char *pszName;
+    const char *pszValue;
+};
+
+// The "fast" profile. SQLite based drivers spend most of their time in
+// fsync and the journal, and pay for a transaction per feature unless told
+// otherwise. FlatGeobuf sorts everything it wrote to build its index when
+// the file is closed. Parquet flushes a row group every 64K rows by
+// default.
+static const write_setting_t asFastSettings[] =
+{
+    { "GPKG", WRITE_SETTING_CONFIG, "OGR_SQLITE_SYNCHRONOUS", "OFF" },
+    { "GPKG", WRITE_SETTING_CONFIG, "OGR_SQLITE_JOURNAL", "MEMORY" },
+    { "GPKG", WRITE_SETTING_CONFIG, "OGR_SQLITE_CACHE", "512" },
+    { "GPKG", WRITE_SETTING_TRANSACTION, nullptr, nullptr },
+    { "SQLite", WRITE_SETTING_CONFIG, "OGR_SQLITE_SYNCHRONOUS", "OFF" },
+    { "SQLite", WRITE_SETTING_CONFIG, "OGR_SQLITE_JOURNAL", "MEMORY" },
+    { "SQLite", WRITE_SETTING_CONFIG, "OGR_SQLITE_CACHE", "512" },
+    { "SQLite", WRITE_SETTING_TRANSACTION, nullptr, nullptr },
+    { "PostgreSQL", WRITE_SETTING_CONFIG, "PG_USE_COPY", "YES" },
+    { "PostgreSQL", WRITE_SETTING_TRANSACTION, nullptr, nullptr },
+    { "FlatGeobuf", WRITE_SETTING_LCO, "SPATIAL_INDEX", "NO" },
+    { "Parquet", WRITE_SETTING_LCO, "ROW_GROUP_SIZE", "262144" },
+    { "Parquet", WRITE_SETTING_LCO, "COMPRESSION", "SNAPPY" },
+};
+
+bool WriteProfile::load(const char *pszProfile, const char *pszDriver)
+{
+    if (pszProfile == nullptr || EQUAL(pszProfile, "default"))
+    {
+        return true;
+    }
+
+    if (!EQUAL(pszProfile, "fast"))
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Unknown write profile '%s'.", pszProfile);
+        return false;
+    }
+
+    m_osName = "fast";
+
+    for (const write_setting_t &sSetting : asFastSettings)
+    {
+        if (!EQUAL(sSetting.pszDriver, pszDriver))
+        {
+            continue;
+        }
+
+        switch (sSetting.eKind)
+        {
+            case WRITE_SETTING_DSCO:
+                m_aosDatasetOptions.SetNameValue(sSetting.pszName, sSetting.pszValue);
+                break;
+            case WRITE_SETTING_LCO:
+                m_aosLayerOptions.SetNameValue(sSetting.pszName, sSetting.pszValue);
+                break;
+            case WRITE_SETTING_CONFIG:
+                // Anything the user set, on the command line with --config
+                // or in the environment, wins.
+                if (CPLGetConfigOption(sSetting.pszName, nullptr) == nullptr)
+                {
+                    m_aosConfigOptions.SetNameValue(sSetting.pszName, sSetting.pszValue);
+                }
+                break;
+            case WRITE_SETTING_TRANSACTION:
+                m_bTransaction = true;
+                break;
+        }
+    }
+
+    return true;
+}
+
+void WriteProfile::addDatasetOptions(CSLConstList papszOptions)
+{
+    m_aosDatasetOptions.Assign(CSLMerge(m_aosDatasetOptions.StealList(), papszOptions), TRUE);
+}
+
+void WriteProfile::addLayerOptions(CSLConstList papszOptions)
+{
+    m_aosLayerOptions.Assign(CSLMerge(m_aosLayerOptions.StealList(), papszOptions), TRUE);
+}
+
+void WriteProfile::begin(GDALDatasetH hDstDS)
+{
+    if (m_bTransaction)
+    {
+        // Without bForce, drivers that could only emulate a transaction by
+        // copying the whole dataset refuse, which is what we want.
+        CPLPushErrorHandler(CPLQuietErrorHandler);
+        m_bInTransaction = GDALDatasetStartTransaction(hDstDS, FALSE) == OGRERR_NONE;
+        m_bTransactionStarted = m_bInTransaction;
+        CPLPopErrorHandler();
+        CPLErrorReset();
+    }
+}
+
+OGRErr WriteProfile::end(GDALDatasetH hDstDS)
+{
+    if (!m_bInTransaction)
+    {
+        return OGRERR_NONE;
+    }
+
+    m_bInTransaction = false;
+    OGRErr eErr = GDALDatasetCommitTransaction(hDstDS);
+    if (eErr != OGRERR_NONE)
+    {
+        GDALDatasetRollbackTransaction(hDstDS);
+    }
+    return eErr;
+}
+
+CPLStringList WriteProfile::settings() const
+{
+    CPLStringList aosSettings;
+    aosSettings.SetNameValue("PROFILE", m_osName);
+    aosSettings.SetNameValue("TRANSACTION", m_bTransactionStarted ? "YES" : "NO");
+
+    const std::pair<const char *, const CPLStringList *> asLists[] =
+    {
+        { "DSCO.", &m_aosDatasetOptions },
+        { "LCO.", &m_aosLayerOptions },
+        { "CONFIG.", &m_aosConfigOptions }
+    };
+
+    for (const auto &sList : asLists)
+    {
+        for (int i = 0; i < sList.second->size(); i++)
+        {
+            char *pszKey = nullptr;
+            const char *pszValue = CPLParseNameValue((*sList.second)[i], &pszKey);
+            if (pszKey != nullptr && pszValue != nullptr)
+            {
+                aosSettings.SetNameValue(CPLSPrintf("%s%s", sList.first, pszKey), pszValue);
+            }
+            CPLFree(pszKey);
+        }
+    }
+
+    return aosSettings;
+}
+
+WriteProfile::ConfigScope::ConfigScope(const WriteProfile &oProfile)
+{
+    for (int i = 0; i < oProfile.m_aosConfigOptions.size(); i++)
+    {
+        char *pszKey = nullptr;
+        const char *pszValue = CPLParseNameValue(oProfile.m_aosConfigOptions[i], &pszKey);
+        if (pszKey != nullptr && pszValue != nullptr)
+        {
+            const char *pszPrevious = CPLGetThreadLocalConfigOption(pszKey, nullptr);
+            if (pszPrevious != nullptr)
+            {
+                m_aosPrevious.SetNameValue(pszKey, pszPrevious);
+            }
+            else
+            {
+                m_aosUnset.AddString(pszKey);
+            }
+            CPLSetThreadLocalConfigOption(pszKey, pszValue);
+        }
+        CPLFree(pszKey);
+    }
+}
+
+WriteProfile::ConfigScope::~ConfigScope()
+{
+    for (int i = 0; i < m_aosUnset.size(); i++)
+    {
+        CPLSetThreadLocalConfigOption(m_aosUnset[i], nullptr);
+    }
+
+    for (int i = 0; i < m_aosPrevious.size(); i++)
+    {
+        char *pszKey = nullptr;
+        const char *pszValue = CPLParseNameValue(m_aosPrevious[i], &pszKey);
+        if (pszKey != nullptr)
+        {
+            CPLSetThreadLocalConfigOption(pszKey, pszValue);
+        }
+        CPLFree(pszKey);
+    }
+}
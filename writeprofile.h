@@ -0,0 +1,94 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2023, Len Norton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef WRITEPROFILE_H_INCLUDED
+#define WRITEPROFILE_H_INCLUDED
+
+#include "cpl_string.h"
+#include "gdal.h"
+
+// Dataset and layer creation options, configuration options and whether to
+// write in a single transaction, chosen for a destination driver. The
+// "fast" profile trades durability if the process dies midway, or some
+// compression or indexing of the output, for write throughput. Options
+// given explicitly always override the profile's.
+class WriteProfile
+{
+public:
+    WriteProfile() = default;
+    WriteProfile(const WriteProfile &) = delete;
+    WriteProfile &operator=(const WriteProfile &) = delete;
+
+    // pszProfile is "fast", or "default" (or null) for the driver's own
+    // defaults. Fails on any other name.
+    bool load(const char *pszProfile, const char *pszDriver);
+
+    void addDatasetOptions(CSLConstList papszOptions);
+    void addLayerOptions(CSLConstList papszOptions);
+
+    CSLConstList datasetOptions() const { return m_aosDatasetOptions.List(); }
+    CSLConstList layerOptions() const { return m_aosLayerOptions.List(); }
+
+    // Starts a transaction on the destination if the profile asks for one
+    // and the driver supports it natively.
+    void begin(GDALDatasetH hDstDS);
+    // Commits whatever begin() started, even if the run failed or was
+    // cancelled, so the destination keeps what was written, as it would
+    // without a transaction. Only if the commit itself fails, which leaves
+    // the dataset unusable, is the transaction rolled back.
+    OGRErr end(GDALDatasetH hDstDS);
+
+    // Everything that was applied, as name=value pairs for the stats:
+    // PROFILE, TRANSACTION, and the options prefixed DSCO., LCO. and
+    // CONFIG.
+    CPLStringList settings() const;
+
+    // Sets the profile's configuration options on the current thread for
+    // as long as it lives.
+    class ConfigScope
+    {
+    public:
+        explicit ConfigScope(const WriteProfile &oProfile);
+        ~ConfigScope();
+
+        ConfigScope(const ConfigScope &) = delete;
+        ConfigScope &operator=(const ConfigScope &) = delete;
+
+    private:
+        CPLStringList m_aosPrevious;
+        CPLStringList m_aosUnset;
+    };
+
+private:
+    CPLString m_osName = "default";
+    CPLStringList m_aosDatasetOptions;
+    CPLStringList m_aosLayerOptions;
+    CPLStringList m_aosConfigOptions;
+    bool m_bTransaction = false;
+    bool m_bInTransaction = false;
+    // Whether begin() actually started one, for settings().
+    bool m_bTransactionStarted = false;
+};
+
+#endif // WRITEPROFILE_H_INCLUDED